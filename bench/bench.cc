@@ -0,0 +1,168 @@
+/* gdt_bench
+ * =========
+ *
+ * Headless micro benchmarks for GDT's CPU side hot paths. No window,
+ * graphics context or audio device is created, so this runs anywhere
+ * the library builds. Run it from the repository root so the example
+ * resources can be found:
+ *
+ *     ./build/bench/gdt_bench [--filter substring] [--min-time seconds] [--out file.json]
+ *
+ * Results are written as JSON, one entry per case, with the time per
+ * operation, throughput and heap allocations per operation.
+ */
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+#include "bench.hh"
+#include "utils/memory.hh"
+
+#ifndef MEMORY_TRACKING_IS_ENABLED
+
+namespace {
+std::atomic<std::uint64_t> alloc_count{0};
+std::atomic<std::uint64_t> alloc_bytes{0};
+}
+
+void* operator new(std::size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
+
+namespace gdt::bench {
+
+#ifdef MEMORY_TRACKING_IS_ENABLED
+// gdt::memory already replaces operator new, so count through it
+alloc_stats allocations()
+{
+    alloc_stats a = {0, 0};
+    for (int t = 0; t < memory::TAG_COUNT; t++) {
+        memory::stats s = memory::get(memory::tag(t));
+        a.count += s.allocations;
+        a.bytes += s.allocated_bytes;
+    }
+    return a;
+}
+#else
+alloc_stats allocations()
+{
+    return {alloc_count.load(std::memory_order_relaxed),
+            alloc_bytes.load(std::memory_order_relaxed)};
+}
+#endif
+
+suite::suite(std::string filter, double min_time) : _filter(filter), _min_time(min_time)
+{
+}
+
+bool suite::wants(const std::string& name) const
+{
+    return _filter.empty() || name.find(_filter) != std::string::npos;
+}
+
+void suite::report(result r)
+{
+    std::cerr << r.name << ": " << r.ns_per_op << " ns/op, " << r.allocs_per_op
+              << " allocs/op" << std::endl;
+    _results.push_back(r);
+}
+
+void suite::write_json(std::ostream& os) const
+{
+    os << "{\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < _results.size(); i++) {
+        const result& r = _results[i];
+        os << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\""
+           << ", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op
+           << ", \"ops_per_sec\": " << r.ops_per_sec
+           << ", \"items_per_sec\": " << r.items_per_sec
+           << ", \"allocs_per_op\": " << r.allocs_per_op
+           << ", \"bytes_per_op\": " << r.bytes_per_op << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string out;
+    double min_time = 0.25;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out = argv[++i];
+        }
+        else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--filter substring] [--min-time seconds] [--out file.json]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    // Engine logs go to std::cout, keep them out of the JSON output.
+    std::streambuf* stdout_buf = std::cout.rdbuf(nullptr);
+    std::ostream json(stdout_buf);
+
+    try {
+        gdt::bench::suite s(filter, min_time);
+        gdt::bench::math_benchmarks(s);
+        gdt::bench::asset_benchmarks(s);
+        gdt::bench::animation_benchmarks(s);
+        gdt::bench::timeline_benchmarks(s);
+        gdt::bench::tween_benchmarks(s);
+        gdt::bench::easing_benchmarks(s);
+        gdt::bench::text_benchmarks(s);
+        gdt::bench::physics_benchmarks(s);
+        gdt::bench::profiler_benchmarks(s);
+        gdt::bench::job_benchmarks(s);
+        gdt::bench::logger_benchmarks(s);
+        gdt::bench::transform_benchmarks(s);
+        gdt::bench::hierarchy_benchmarks(s);
+        gdt::bench::ecs_benchmarks(s);
+        gdt::bench::driven_benchmarks(s);
+        gdt::bench::instance_pool_benchmarks(s);
+        gdt::bench::aabb_tree_benchmarks(s);
+        gdt::bench::culling_benchmarks(s);
+        gdt::bench::render_queue_benchmarks(s);
+
+        if (out.empty()) {
+            s.write_json(json);
+        }
+        else {
+            std::ofstream f(out);
+            s.write_json(f);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#ifndef GDT_BENCH_HEADER_INCLUDED
+#define GDT_BENCH_HEADER_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gdt::bench {
+
+/**
+ * Process wide allocation counters, maintained by the global operator new
+ * replacement in bench.cc, or by gdt::memory when it tracks allocations.
+ */
+struct alloc_stats {
+    std::uint64_t count;
+    std::uint64_t bytes;
+};
+
+alloc_stats allocations();
+
+/**
+ * Keep the compiler from optimizing away a value we only compute
+ * for the sake of measuring it.
+ */
+template <typename T>
+inline void keep(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct result {
+    std::string name;
+    std::uint64_t iterations;
+    double ns_per_op;
+    double ops_per_sec;
+    double items_per_sec;
+    double allocs_per_op;
+    double bytes_per_op;
+};
+
+/**
+ * A suite runs named cases and collects their results.
+ * Each case is a callable performing a single operation. The suite
+ * keeps doubling the number of iterations until a batch runs for at
+ * least the minimal time, and reports that batch.
+ *
+ *     s.run("math/mat4_mul", [&]() { c = a * b; });
+ *     s.run("easing/cubic_1024", [&]() { ... }, 1024);
+ *
+ * The optional items argument is the number of items each operation
+ * processes, used to report throughput.
+ */
+class suite {
+  public:
+    suite(std::string filter, double min_time);
+
+    template <typename F>
+    void run(const std::string& name, F&& op, std::uint64_t items = 1);
+
+    bool wants(const std::string& name) const;
+    void write_json(std::ostream& os) const;
+
+  private:
+    void report(result r);
+
+    std::string _filter;
+    double _min_time;
+    std::vector<result> _results;
+};
+
+void math_benchmarks(suite& s);
+void asset_benchmarks(suite& s);
+void animation_benchmarks(suite& s);
+void timeline_benchmarks(suite& s);
+void tween_benchmarks(suite& s);
+void easing_benchmarks(suite& s);
+void text_benchmarks(suite& s);
+void physics_benchmarks(suite& s);
+void profiler_benchmarks(suite& s);
+void job_benchmarks(suite& s);
+void logger_benchmarks(suite& s);
+void transform_benchmarks(suite& s);
+void hierarchy_benchmarks(suite& s);
+void ecs_benchmarks(suite& s);
+void driven_benchmarks(suite& s);
+void instance_pool_benchmarks(suite& s);
+void aabb_tree_benchmarks(suite& s);
+void culling_benchmarks(suite& s);
+void render_queue_benchmarks(suite& s);
+
+//------------------------------------------------------------------------------------------------
+// IMPLEMENTATIONS
+//------------------------------------------------------------------------------------------------
+
+template <typename F>
+void suite::run(const std::string& name, F&& op, std::uint64_t items)
+{
+    if (!wants(name)) return;
+    using clock = std::chrono::steady_clock;
+    op();
+    std::uint64_t n = 1;
+    while (true) {
+        alloc_stats a0 = allocations();
+        auto t0 = clock::now();
+        for (std::uint64_t i = 0; i < n; i++) {
+            op();
+        }
+        auto t1 = clock::now();
+        alloc_stats a1 = allocations();
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+        if (secs >= _min_time || n >= (1ull << 40)) {
+            result r;
+            r.name = name;
+            r.iterations = n;
+            r.ns_per_op = secs * 1e9 / n;
+            r.ops_per_sec = n / secs;
+            r.items_per_sec = r.ops_per_sec * items;
+            r.allocs_per_op = double(a1.count - a0.count) / n;
+            r.bytes_per_op = double(a1.bytes - a0.bytes) / n;
+            report(r);
+            return;
+        }
+        n *= 2;
+    }
+}
+}
+
+#endif  // GDT_BENCH_HEADER_INCLUDED
@@ -0,0 +1,896 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "bench.hh"
+#include "core/aabb_tree.hh"
+#include "core/animation.hh"
+#include "core/arena.hh"
+#include "core/culling.hh"
+#include "core/drivers.hh"
+#include "core/easing.hh"
+#include "core/ecs.hh"
+#include "core/font.hh"
+#include "core/hierarchy.hh"
+#include "core/jobs.hh"
+#include "core/loader.hh"
+#include "core/math.hh"
+#include "core/render_queue.hh"
+#include "core/soa_transforms.hh"
+#include "core/timeline.hh"
+#include "core/tween.hh"
+#include "utils/logger.hh"
+#include "utils/profiler.hh"
+
+namespace gdt::bench {
+
+using namespace gdt::math;
+
+void math_benchmarks(suite& s)
+{
+    mat4 a = mat4::world(vec3(1, 2, 3), vec3(1, 1, 1), quat(0.3f, vec3(0, 1, 0)));
+    mat4 b = mat4::world(vec3(3, 2, 1), vec3(2, 2, 2), quat(0.7f, vec3(1, 0, 0)));
+    mat4 c;
+    s.run("math/mat4_mul", [&]() {
+        c = a * b;
+        keep(c);
+    });
+    s.run("math/mat4_inverse", [&]() {
+        c = a.inverse();
+        keep(c);
+    });
+    s.run("math/mat4_world", [&]() {
+        c = mat4::world(vec3(1, 2, 3), vec3(1, 1, 1), quat(0.3f, vec3(0, 1, 0)));
+        keep(c);
+    });
+    s.run("math/mat4_as_quat_dual", [&]() {
+        auto qd = a.as_quat_dual();
+        keep(qd);
+    });
+
+    quat q0(0.3f, vec3(0, 1, 0));
+    quat q1(1.3f, vec3(1, 0, 0));
+    float t = 0;
+    s.run("math/quat_slerp", [&]() {
+        t = t < 1 ? t + 0.001f : 0;
+        quat q = quat::slerp(q0, q1, t);
+        keep(q);
+    });
+
+    vec3 v(1, 2, 3);
+    s.run("math/vec3_normalize_cross", [&]() {
+        vec3 n = v.cross(vec3(0, 1, 0)).normalize();
+        keep(n);
+    });
+}
+
+void asset_benchmarks(suite& s)
+{
+    s.run("loader/read_smd_crate", []() {
+        auto m = read_smd("res/examples/crate2.smd");
+        keep(m);
+    });
+    s.run("loader/read_smd_imrod", []() {
+        auto m = read_smd("res/examples/imrod.smd");
+        keep(m);
+    });
+    s.run("loader/read_skeleton_imrod", []() {
+        auto sk = read_skeleton("res/examples/imrod.smd");
+        keep(sk);
+    });
+    s.run("loader/read_animation_imrod", []() {
+        auto frames = read_animation("res/examples/imrod.ani");
+        keep(frames);
+    });
+
+    if (!s.wants("mesh/generate_tangents_imrod")) return;
+    auto model = read_smd("res/examples/imrod.smd");
+    std::uint64_t vertices = 0;
+    for (auto& m : model->meshes) vertices += m->vertices.size();
+    s.run("mesh/generate_tangents_imrod", [&]() { model->generate_tangents(); }, vertices);
+}
+
+void animation_benchmarks(suite& s)
+{
+    if (!s.wants("animation/")) return;
+    auto sk = read_skeleton("res/examples/imrod.smd");
+    auto frames = read_animation("res/examples/imrod.ani");
+    if (frames.size() < 2) return;
+
+    float t = 0;
+    s.run("animation/interpolate_imrod", [&]() {
+        t = t < 1 ? t + 0.01f : 0;
+        frame f = animation::interpolate(frames[0], frames[1], t);
+        keep(f);
+    }, sk.n_bones());
+
+    // the same through the frame arena, as animixer::bind does it
+    frame_arena arena(nullptr);
+    s.run("animation/interpolate_imrod_arena", [&]() {
+        t = t < 1 ? t + 0.01f : 0;
+        arena.begin_frame();
+        transient_frame f;
+        animation::interpolate(frames[0], frames[1], t, f);
+        keep(f);
+    }, sk.n_bones());
+
+    frame f = frames[0];
+    s.run("animation/bake_transforms_imrod", [&]() {
+        f.bake_transforms();
+        keep(f);
+    }, sk.n_bones());
+}
+
+namespace {
+
+// A frame longer than many spans has to end each of them exactly once,
+// in order and at full progress, and never report progress past the end.
+void check_timeline_hitch()
+{
+    timeline t;
+    std::vector<int> ended;
+    bool clamped = true;
+    for (int i = 0; i < 100; i++) {
+        t.span(0.01f + 0.001f * (i % 7), [&ended, &clamped, i](float elapsed, float progress) {
+            if (progress < 0 || progress > 1) clamped = false;
+            if (progress == 1) ended.push_back(i);
+        });
+    }
+    for (int run = 0; run < 2; run++) {
+        ended.clear();
+        t.restart();
+        t.update(0.005f);
+        t.update(10.0f);
+        t.update(10.0f);
+        bool in_order = ended.size() == 100;
+        for (int i = 0; in_order && i < 100; i++) in_order = ended[i] == i;
+        if (!in_order || !clamped || !t.is_done()) {
+            throw std::runtime_error("timeline: a hitch did not end every span once, in order");
+        }
+    }
+}
+}
+
+void timeline_benchmarks(suite& s)
+{
+    check_timeline_hitch();
+
+    core_context ctx;
+    ctx.elapsed = 1.0f / 60;
+
+    timeline endless;
+    float sink = 0;
+    endless.span(1e9f, [&sink](float elapsed, float progress) { sink += progress; });
+    s.run("timeline/update", [&]() {
+        endless.update(ctx);
+        keep(sink);
+    });
+
+    timeline sequence;
+    sequence.reserve(4);
+    s.run("timeline/build_and_run", [&]() {
+        sequence.clear();
+        sequence.wait(0.1f)
+            .span(0.2f, [&sink](float elapsed, float progress) { sink += progress; })
+            .once([&sink](float elapsed, float progress) { sink += 1; })
+            .span(0.3f, [&sink](float elapsed, float progress) { sink -= progress; });
+        while (!sequence.is_done()) sequence.update(ctx);
+        keep(sink);
+    });
+
+    // a single 2 second hitch has to run through all 100 spans
+    timeline hitch;
+    for (int i = 0; i < 100; i++) {
+        hitch.span(0.01f, [&sink](float elapsed, float progress) { sink += progress; });
+    }
+    s.run("timeline/hitch_100_spans", [&]() {
+        hitch.restart();
+        hitch.update(2.0f);
+        keep(sink);
+    }, 100);
+
+    // 10k short sequences, each restarting as soon as it's done
+    static const int N = 10000;
+    timeline_group group;
+    auto start = [&group, &sink](int i) {
+        group.add()
+            .wait(0.01f * (i % 10))
+            .span(0.1f, [&sink](float elapsed, float progress) { sink += progress; })
+            .span(0.2f, [&sink](float elapsed, float progress) { sink -= progress; });
+    };
+    for (int i = 0; i < N; i++) start(i);
+    s.run("timeline/group_10k", [&]() {
+        group.update(ctx);
+        for (int i = group.size(); i < N; i++) start(i);
+        keep(sink);
+    }, N);
+}
+
+void tween_benchmarks(suite& s)
+{
+    if (!s.wants("tween/")) return;
+    static const int N = 100000;
+    static const easing_kind kinds[] = {EASE_LINEAR, EASE_CUBIC_IN_OUT, EASE_SINE_OUT,
+                                        EASE_ELASTIC_OUT, EASE_BOUNCE_OUT};
+    std::vector<float> floats(N);
+    std::vector<vec3> positions(N);
+    std::vector<quat> rotations(N);
+    tween_pool tweens;
+    for (int i = 0; i < N; i++) {
+        easing_kind kind = kinds[i % 5];
+        // long enough that none of them finish while measuring
+        float duration = 1e6f + i;
+        switch (i % 3) {
+            case 0: tweens.to(&floats[i], 0.0f, 1.0f, duration, kind); break;
+            case 1: tweens.to(&positions[i], vec3(0, 0, 0), vec3(1, 2, 3), duration, kind); break;
+            case 2:
+                tweens.to(&rotations[i], quat(0, vec3(0, 1, 0)), quat(1.5f, vec3(0, 1, 0)),
+                          duration, kind);
+                break;
+        }
+    }
+    core_context ctx;
+    ctx.elapsed = 1.0f / 60;
+    s.run("tween/update_100k", [&]() {
+        tweens.update(ctx);
+        keep(floats);
+    }, N);
+
+    // short tweens restarting from their completion callbacks
+    struct restart {
+        tween_pool* tweens;
+        float value;
+        static void again(void* user)
+        {
+            auto* r = static_cast<restart*>(user);
+            r->tweens->to(&r->value, 0.0f, 1.0f, 0.05f, EASE_QUADRATIC_OUT, again, r);
+        }
+    };
+    tween_pool churn;
+    std::vector<restart> restarts(10000, restart{&churn, 0});
+    for (auto& r : restarts) restart::again(&r);
+    s.run("tween/update_10k_restarting", [&]() {
+        churn.update(ctx);
+        keep(restarts);
+    }, restarts.size());
+}
+
+void easing_benchmarks(suite& s)
+{
+    static const int N = 1024;
+    std::vector<float> in(N), out(N);
+    for (int i = 0; i < N; i++) in[i] = float(i) / (N - 1);
+
+    struct {
+        const char* name;
+        float (*fn)(float);
+        easing_kind kind;
+    } kinds[] = {{"cubic_ease_in_out", cubic_ease_in_out, EASE_CUBIC_IN_OUT},
+                 {"sine_ease_in_out", sine_ease_in_out, EASE_SINE_IN_OUT},
+                 {"elastic_ease_out", elastic_ease_out, EASE_ELASTIC_OUT},
+                 {"bounce_ease_out", bounce_ease_out, EASE_BOUNCE_OUT}};
+    for (auto& k : kinds) {
+        std::string name = k.name;
+        s.run("easing/" + name, [&]() {
+            for (int i = 0; i < N; i++) out[i] = interpolate(0, 10, in[i], k.fn);
+            keep(out);
+        }, N);
+        s.run("easing/ease_n/" + name, [&]() {
+            ease_n(k.kind, in.data(), out.data(), N);
+            keep(out);
+        }, N);
+        if (s.wants("easing/lut/" + name)) {
+            easing_lut lut(k.kind);
+            s.run("easing/lut/" + name, [&]() {
+                lut.ease_n(in.data(), out.data(), N);
+                keep(out);
+            }, N);
+        }
+    }
+}
+
+void text_benchmarks(suite& s)
+{
+    if (!s.wants("text/layout_paragraph")) return;
+    font_metrics metrics("res/fonts/sdf.fnt");
+    const char* text =
+        "The quick brown fox jumps over the lazy dog.\n"
+        "Pack my box with five dozen liquor jugs!\n"
+        "GDT - the C++ Game Development Templates library";
+    std::uint64_t chars = strlen(text);
+    frame_vector<gdt::vertex> vs;
+    frame_vector<uint32_t> triangles;
+    s.run("text/layout_paragraph", [&]() {
+        vs.clear();
+        triangles.clear();
+        metrics.layout(text, 512, 512, vs, triangles);
+        keep(vs);
+    }, chars);
+}
+
+void profiler_benchmarks(suite& s)
+{
+    if (!s.wants("profiler/frame_64_zones")) return;
+    // sites are used directly so this runs with PROFILER_IS_ENABLED off too
+    static const profiler::site outer("bench outer", __FILE__, __LINE__);
+    static const profiler::site inner("bench inner", __FILE__, __LINE__);
+    const int N = 64;
+    s.run("profiler/frame_64_zones", [&]() {
+        {
+            profiler::scope o(outer);
+            for (int i = 0; i < N - 1; i++) {
+                profiler::scope z(inner);
+            }
+        }
+        profiler::frame();
+    }, N);
+}
+
+// Jobs starting counters from the workers while other jobs queue work
+// after those same counters, so run_after races counters starting over.
+// Jobs left waiting on a finished generation hang the final waits.
+struct job_chains {
+    static constexpr int COUNTERS = 8;
+    static constexpr int STARTERS = 64;
+    job_system* jobs;
+    job_counter started;
+    job_counter shared[COUNTERS];
+    job_counter after[COUNTERS];
+    std::atomic<int> ran{0};
+
+    void start(int i)
+    {
+        jobs->run(shared[i % COUNTERS], [this]() { ran.fetch_add(1); });
+        jobs->run_after(shared[(i + 1) % COUNTERS], after[i % COUNTERS],
+                        [this]() { ran.fetch_add(1); });
+    }
+
+    void run()
+    {
+        for (int i = 0; i < STARTERS; i++) jobs->run(started, [this, i]() { start(i); });
+        jobs->wait(started);
+        for (int i = 0; i < COUNTERS; i++) {
+            jobs->wait(shared[i]);
+            jobs->wait(after[i]);
+        }
+        if (ran.load() != STARTERS * 2) throw std::runtime_error("job_chains: lost a job");
+    }
+};
+
+void job_benchmarks(suite& s)
+{
+    if (!s.wants("jobs/")) return;
+    auto frames = read_animation("res/examples/imrod.ani");
+    if (frames.empty()) return;
+    // a crowd of characters, each baking its own pose
+    std::vector<frame> crowd(256, frames[0]);
+
+    for (int workers : {0, 1, 3}) {
+        job_system jobs(workers);
+        std::string suffix = "/workers_" + std::to_string(workers);
+        const int N = 1000;
+        s.run("jobs/schedule_empty_1k" + suffix, [&]() {
+            job_counter c;
+            for (int i = 0; i < N; i++) jobs.run(c, []() {});
+            jobs.wait(c);
+        }, N);
+        s.run("jobs/parallel_for_empty_100k" + suffix, [&]() {
+            jobs.parallel_for(0, 100000, [](int i) { keep(i); });
+        }, 100000);
+        s.run("jobs/bake_crowd_256" + suffix, [&]() {
+            jobs.parallel_for(0, int(crowd.size()), [&](int i) { crowd[i].bake_transforms(); });
+            keep(crowd);
+        }, crowd.size());
+        s.run("jobs/run_after_from_workers_64" + suffix, [&]() {
+            job_chains chains;
+            chains.jobs = &jobs;
+            chains.run();
+        }, job_chains::STARTERS);
+    }
+}
+
+void logger_benchmarks(suite& s)
+{
+    if (!s.wants("logger/")) return;
+    // measures the calling thread, the background one writes to nowhere
+    // until the sinks set up before are back
+    auto sinks = logger::take_sinks();
+    logger::severity level = logger::level();
+    logger::set_level(logger::INFO);
+    int id = 0;
+    float x = 1.5f;
+    s.run("logger/filtered", [&]() {
+        LOG_DEBUG << "body " << id << " at " << x;
+        LOG_BINARY(logger::DEBUG, "body {} at {}", id, x);
+    });
+    // bursts that fit in the ring, the flush includes the background
+    // thread's share on machines with few cores
+    const int N = 4000;
+    s.run("logger/text_4k", [&]() {
+        for (int i = 0; i < N; i++) LOG_INFO << "body " << id++ << " at " << x;
+        logger::flush();
+    }, N);
+    s.run("logger/binary_4k", [&]() {
+        for (int i = 0; i < N; i++) LOG_BINARY(logger::INFO, "body {} at {}", id++, x);
+        logger::flush();
+    }, N);
+    logger::set_level(level);
+    // what the benches logged goes nowhere, not to the sinks put back
+    logger::flush();
+    for (auto& sink : sinks) logger::add_sink(std::move(sink));
+}
+
+void transform_benchmarks(suite& s)
+{
+    const int count = 10000;
+    std::vector<mat4> out(count);
+    std::vector<vec3> positions(count);
+    soa_transforms soa;
+    for (int i = 0; i < count; i++) {
+        positions[i] = vec3(i % 100, i / 100, 0);
+        soa.add(positions[i], quat(0.001f * i, vec3(0, 1, 0)), vec3(1, 1, 1));
+    }
+    s.run("transforms/world_10k",
+          [&]() {
+              for (int i = 0; i < count; i++) {
+                  out[i] = mat4::world(positions[i], vec3(1, 1, 1), soa.rotation(i)).transpose();
+              }
+              keep(out[0]);
+          },
+          count);
+    s.run("transforms/compose_10k_scalar",
+          [&]() {
+              soa.mark_dirty(0, count);
+              soa.compose(out.data(), 1);
+              keep(out[0]);
+          },
+          count);
+    s.run("transforms/compose_10k",
+          [&]() {
+              soa.mark_dirty(0, count);
+              soa.compose(out.data());
+              keep(out[0]);
+          },
+          count);
+    int next = 0;
+    s.run("transforms/compose_10k_1pct_dirty",
+          [&]() {
+              for (int i = 0; i < count / 100; i++) {
+                  next = (next + 7919) % count;
+                  soa.set_position(next, positions[next]);
+              }
+              soa.compose(out.data());
+              keep(out[0]);
+          },
+          count / 100);
+}
+
+void hierarchy_benchmarks(suite& s)
+{
+    if (!s.wants("hierarchy/")) return;
+    // 1000 objects of 100 nodes each, three levels deep
+    const int roots = 1000;
+    transform_hierarchy h(roots * 100);
+    std::vector<int> tops;
+    for (int r = 0; r < roots; r++) {
+        int top = h.add(transform_hierarchy::NONE, mat4::translation(vec3(r, 0, 0)));
+        tops.push_back(top);
+        for (int c = 0; c < 9; c++) {
+            int child = h.add(top, mat4::translation(vec3(0, c, 0)));
+            for (int g = 0; g < 10; g++) h.add(child, mat4::translation(vec3(0, 0, g)));
+        }
+    }
+    h.update();
+
+    for (int workers : {0, 1, 3}) {
+        job_system jobs(workers);
+        std::string suffix = "/workers_" + std::to_string(workers);
+        float t = 0;
+        s.run("hierarchy/update_100k_all_moving" + suffix, [&]() {
+            t += 0.01f;
+            for (int top : tops) h.set_local(top, mat4::translation(vec3(top, t, 0)));
+            h.update(&jobs);
+            keep(h.world(0));
+        }, h.size());
+        int next = 0;
+        s.run("hierarchy/update_100k_1pct_moving" + suffix, [&]() {
+            for (int i = 0; i < roots / 100; i++) {
+                next = (next + 7) % roots;
+                h.set_local(tops[next], mat4::translation(vec3(next, 1, 0)));
+            }
+            h.update(&jobs);
+            keep(h.world(0));
+        }, h.size());
+    }
+}
+
+namespace {
+
+// just enough of a graphics backend and an entity for gdt::instances
+struct instance_buffers {
+    std::vector<std::unique_ptr<mat4[]>> buffers;
+
+    void create_instance_buffer(mat4** d, int c)
+    {
+        buffers.emplace_back(new mat4[c]);
+        *d = buffers.back().get();
+    }
+    void update_instance_buffer(mat4* data, int count)
+    {
+        keep(data[count - 1]);
+    }
+};
+
+struct instancing_context : core_context {
+    instance_buffers* graphics;
+};
+
+struct crate : is_entity<crate>, is_drawable<crate>, is_drivable<crate> {
+    crate(const instancing_context& ctx)
+    {
+    }
+};
+
+// Moves its transform at a constant velocity, and all of a driven's
+// drivers at once through update_all, the way batching drivers do.
+template <typename DRIVABLE>
+struct drifting_driver {
+    using initializer = vec3;
+    static int batches;
+
+    mat4* transform;
+    vec3 velocity;
+
+    drifting_driver(const core_context&, mat4* t, DRIVABLE*, vec3 v) : transform(t), velocity(v)
+    {
+    }
+
+    void update()
+    {
+        transform->wx += velocity.x;
+        transform->wy += velocity.y;
+        transform->wz += velocity.z;
+    }
+
+    static void update_all(span<drifting_driver> drivers)
+    {
+        batches++;
+        for (drifting_driver& d : drivers) {
+            d.transform->wx += d.velocity.x;
+            d.transform->wy += d.velocity.y;
+            d.transform->wz += d.velocity.z;
+        }
+    }
+};
+
+template <typename DRIVABLE>
+int drifting_driver<DRIVABLE>::batches = 0;
+
+struct position {
+    vec3 p;
+};
+
+struct velocity {
+    vec3 v;
+};
+}
+
+void ecs_benchmarks(suite& s)
+{
+    if (!s.wants("ecs/")) return;
+    const int count = 10000;
+    const float dt = 1.0f / 60;
+    instance_buffers buffers;
+    instancing_context ctx;
+    ctx.elapsed = dt;
+    ctx.graphics = &buffers;
+    auto velocity_of = [](int i) { return vec3(i % 7, i % 5, i % 3) * 0.1f; };
+
+    // what scenes do today: drivers moving the instances of a driven
+    auto crates = std::make_unique<driven<instances<crate, count>, direct_driver>>(ctx);
+    std::vector<vec3> positions(count), velocities(count);
+    for (int i = 0; i < count; i++) velocities[i] = velocity_of(i);
+    s.run("ecs/driven_instances_10k", [&]() {
+        for (int i = 0; i < count; i++) {
+            positions[i] += velocities[i] * dt;
+            crates->get_driver_ptr(i)->translate(positions[i]);
+        }
+        crates->get_transformable_ptr()->update(ctx);
+    }, count);
+
+    crate asset(ctx);
+    ecs::world w;
+    for (int i = 0; i < count; i++) {
+        w.create(position{vec3(0, 0, 0)}, velocity{velocity_of(i)}, ecs::transform(),
+                 ecs::renderable<crate>{&asset});
+    }
+    auto move = [dt](position& p, const velocity& v, ecs::transform& t) {
+        p.p += v.v * dt;
+        t.matrix.wx = p.p.x;
+        t.matrix.wy = p.p.y;
+        t.matrix.wz = p.p.z;
+    };
+    ecs::draw_batch<crate> batch(&asset);
+    s.run("ecs/each_10k", [&]() {
+        w.each<position, const velocity, ecs::transform>(move);
+    }, count);
+    s.run("ecs/draw_batch_collect_10k", [&]() {
+        batch.collect(ctx, w);
+    }, count);
+
+    ecs::world driven_world;
+    for (int i = 0; i < count; i++) {
+        mat4 unused;
+        driven_world.create(position{vec3(0, 0, 0)}, velocity{velocity_of(i)}, ecs::transform(),
+                            direct_driver<crate>(ctx, &unused, &asset, mat4::id()));
+    }
+    s.run("ecs/direct_drivers_10k", [&]() {
+        driven_world.each<position, const velocity, ecs::transform, direct_driver<crate>>(
+            [dt](position& p, const velocity& v, ecs::transform& t, direct_driver<crate>& d) {
+                p.p += v.v * dt;
+                d.retarget(&t.matrix);
+                d.translate(p.p);
+            });
+    }, count);
+
+    for (int workers : {1, 3}) {
+        job_system jobs(workers);
+        std::string suffix = "/workers_" + std::to_string(workers);
+        s.run("ecs/par_each_10k" + suffix, [&]() {
+            w.par_each<position, const velocity, ecs::transform>(&jobs, move);
+        }, count);
+    }
+}
+
+void driven_benchmarks(suite& s)
+{
+    if (!s.wants("driven/")) return;
+    const int count = 10000;
+    instance_buffers buffers;
+    instancing_context ctx;
+    ctx.elapsed = 1.0f / 60;
+    ctx.graphics = &buffers;
+    auto crates = std::make_unique<driven<instances<crate, count>, direct_driver>>(ctx);
+    for (int i = 0; i < count; i++) {
+        crates->get_driver_ptr(i)->translate(vec3(i % 100, i / 100, 0));
+    }
+    s.run("driven/update_10k", [&]() {
+        crates->update(ctx);
+    }, count);
+
+    auto drifting = std::make_unique<driven<instances<crate, count>, drifting_driver>>(
+        ctx, [](int i) { return vec3(i % 3, 1, 0); });
+    drifting->update(ctx);
+    const mat4& last = *drifting->get_transformable_ptr()->get_transform_ptr(count - 1);
+    if (drifting_driver<crate>::batches != 1 || last.wy != 1) {
+        throw std::runtime_error("driven: update didn't go through the drivers' update_all");
+    }
+    s.run("driven/update_all_10k", [&]() {
+        drifting->update(ctx);
+    }, count);
+}
+
+void instance_pool_benchmarks(suite& s)
+{
+    if (!s.wants("instance_pool/")) return;
+    // 10k bullets in flight, the oldest tenth of them replaced every frame
+    const int count = 10000;
+    const int churn = count / 10;
+    instance_buffers buffers;
+    instancing_context ctx;
+    ctx.graphics = &buffers;
+    instance_pool<crate> bullets(ctx, count);
+    std::vector<instance_pool<crate>::handle> live(count);
+    for (int i = 0; i < count; i++) {
+        live[i] = bullets.spawn(mat4::translation(vec3(i % 100, i / 100, 0)).transpose());
+    }
+    int oldest = 0;
+    s.run("instance_pool/churn_1k_of_10k", [&]() {
+        for (int i = 0; i < churn; i++) {
+            int k = (oldest + i) % count;
+            bullets.kill(live[k]);
+            live[k] = bullets.spawn(mat4::translation(vec3(0, 0, 0)).transpose());
+        }
+        oldest = (oldest + churn) % count;
+        bullets.update(ctx);
+    }, churn);
+    if (bullets.size() != count || bullets.kill(instance_pool<crate>::handle())) {
+        throw std::runtime_error("instance_pool: churn lost track of its instances");
+    }
+    s.run("instance_pool/move_10k", [&]() {
+        for (auto h : live) bullets.get(h)->wx += 0.1f;
+        bullets.update(ctx);
+    }, count);
+}
+
+void aabb_tree_benchmarks(suite& s)
+{
+    if (!s.wants("aabb_tree/")) return;
+    // 10k crates scattered over a 400 x 400 field, 20 high
+    const int count = 10000;
+    aabb local(vec3(-1, -1, -1), vec3(1, 1, 1));
+    std::vector<mat4> transforms(count);
+    std::vector<aabb> boxes(count);
+    std::vector<int> proxies(count);
+    aabb_tree tree;
+    srand(1);
+    for (int i = 0; i < count; i++) {
+        vec3 p = vec3::random(400, 20, 400);
+        transforms[i] = mat4::translation(p).transpose();
+        boxes[i] = local.transformed(mat4::translation(p));
+        proxies[i] = tree.add(boxes[i], i);
+    }
+    frustum view(mat4::perspective(1.0f, 0.5f, 150.0f, 9.0f / 16) *
+                 mat4::view_look_at(vec3(0, 10, 0), vec3(50, 0, 50), vec3(0, 1, 0)));
+
+    s.run("aabb_tree/frustum_10k_brute_force", [&]() {
+        int visible = 0;
+        for (const aabb& b : boxes) visible += view.intersects(b);
+        keep(visible);
+    }, count);
+    s.run("aabb_tree/frustum_10k", [&]() {
+        int visible = 0;
+        tree.query(view, [&](int) { visible++; });
+        keep(visible);
+    }, count);
+    ray pick(vec3(0, 10, 0), vec3(1, -0.05f, 1));
+    s.run("aabb_tree/raycast_closest_10k", [&]() {
+        int hit = -1;
+        tree.raycast(pick, 1000, [&](int proxy, float t) {
+            hit = proxy;
+            return t;
+        });
+        keep(hit);
+    }, count);
+    std::vector<int> near;
+    s.run("aabb_tree/nearest_8_of_10k", [&]() {
+        tree.nearest(vec3(10, 0, 10), 8, near);
+        keep(near[0]);
+    }, count);
+    float t = 0;
+    s.run("aabb_tree/move_instances_10k", [&]() {
+        t += 0.01f;
+        for (int i = 0; i < count; i++) transforms[i].wx += sinf(t + i) * 0.2f;
+        tree.move_instances(proxies.data(), local, transforms.data(), count);
+    }, count);
+    s.run("aabb_tree/move_1pct_of_10k", [&]() {
+        t += 0.01f;
+        for (int i = 0; i < count / 100; i++) {
+            int j = (i * 7919 + int(t * 100)) % count;
+            transforms[j].wz += 0.5f;
+            tree.move(proxies[j], local.transformed(transforms[j].transpose()));
+        }
+    }, count / 100);
+    s.run("aabb_tree/rebuild_10k", [&]() { tree.rebuild(); }, count);
+}
+
+void culling_benchmarks(suite& s)
+{
+    if (!s.wants("culling/")) return;
+    // the aabb_tree field of crates, culled the way pipelines do it
+    const int count = 10000;
+    aabb local(vec3(-1, -1, -1), vec3(1, 1, 1));
+    std::vector<mat4> transforms(count);
+    srand(1);
+    for (int i = 0; i < count; i++) {
+        transforms[i] = mat4::translation(vec3::random(400, 20, 400)).transpose();
+    }
+    instance_culler culler;
+    culler.set_frustum(frustum(mat4::perspective(1.0f, 0.5f, 150.0f, 9.0f / 16) *
+                               mat4::view_look_at(vec3(0, 10, 0), vec3(50, 0, 50),
+                                                  vec3(0, 1, 0))));
+    s.run("culling/instances_10k", [&]() {
+        keep(culler.cull(local, transforms.data(), count));
+    }, count);
+    // nothing culled, nothing to compact
+    aabb huge(vec3(-1000, -1000, -1000), vec3(1000, 1000, 1000));
+    s.run("culling/instances_10k_all_visible", [&]() {
+        keep(culler.cull(huge, transforms.data(), count));
+    }, count);
+}
+
+// Stands in for a graphics backend and its pipelines, counting the state
+// they are asked to change.
+struct queue_graphics {
+    int uses = 0;
+    int binds = 0;
+    int draws = 0;
+    int culled_draws = 0;
+};
+
+struct queue_material {
+    int texture;
+};
+
+struct queue_pipeline {
+    using material = queue_material;
+    queue_graphics* g;
+
+    const queue_pipeline& use(const graphics_context<queue_graphics>& ctx) const
+    {
+        ctx.graphics->uses++;
+        return *this;
+    }
+    const queue_pipeline& set_material(const material& m) const
+    {
+        g->binds++;
+        return *this;
+    }
+    const queue_pipeline& draw(const mat4& what, culling c = culling::none) const
+    {
+        g->draws++;
+        if (c != culling::none) g->culled_draws++;
+        return *this;
+    }
+};
+
+void render_queue_benchmarks(suite& s)
+{
+    if (!s.wants("render_queue/")) return;
+    // 10k draws of 64 materials over 4 pipelines, in the order a scene
+    // walking its objects would submit them, 1 in 8 translucent and 1 in
+    // 4 frustum culled
+    const int count = 10000;
+    queue_graphics g;
+    graphics_context<queue_graphics> ctx{&g};
+    std::vector<queue_pipeline> pipelines(4, queue_pipeline{&g});
+    std::vector<queue_material> materials(64);
+    std::vector<mat4> objects(count);
+    std::vector<float> depths(count);
+    srand(1);
+    for (float& d : depths) d = float(rand() % 1000) / 10;
+    render_queue<queue_graphics> queue;
+    auto submit_all = [&]() {
+        for (int i = 0; i < count; i++) {
+            const queue_pipeline& p = pipelines[(i * 7) % 4];
+            auto o = i % 8 ? render_queue<queue_graphics>::order::opaque
+                           : render_queue<queue_graphics>::order::translucent;
+            if (i % 4) {
+                queue.submit(i % 2, p, &materials[(i * 13) % 64], objects[i], depths[i], o);
+            } else {
+                queue.submit(i % 2, p, &materials[(i * 13) % 64], objects[i], culling::frustum,
+                             depths[i], o);
+            }
+        }
+    };
+
+    submit_all();
+    queue.execute(ctx);
+    auto st = queue.get_stats();
+    std::cerr << "render_queue: " << st.draws << " draws, " << st.unsorted_pipeline_changes
+              << " pipeline and " << st.unsorted_material_changes
+              << " material changes as submitted, " << st.pipeline_changes << " and "
+              << st.material_changes << " sorted" << std::endl;
+    if (g.culled_draws != count / 4) {
+        throw std::runtime_error("render_queue: draws lost their culling");
+    }
+
+    std::vector<sort_entry> entries(count), scratch(count), keys(count);
+    for (int i = 0; i < count; i++) {
+        keys[i] = {render_queue<queue_graphics>::make_key(i % 2, (i * 7) % 4, (i * 13) % 64,
+                                                          depths[i],
+                                                          render_queue<queue_graphics>::order::opaque),
+                   uint32_t(i)};
+    }
+    s.run("render_queue/radix_sort_10k", [&]() {
+        entries = keys;
+        radix_sort(entries.data(), scratch.data(), count);
+        keep(entries[0]);
+    }, count);
+    s.run("render_queue/std_sort_10k", [&]() {
+        entries = keys;
+        std::sort(entries.begin(), entries.end(),
+                  [](const sort_entry& a, const sort_entry& b) { return a.key < b.key; });
+        keep(entries[0]);
+    }, count);
+    s.run("render_queue/submit_execute_10k", [&]() {
+        queue.clear();
+        submit_all();
+        queue.execute(ctx);
+    }, count);
+}
+}
@@ -0,0 +1,55 @@
+#include <vector>
+
+#include "bench.hh"
+#include "core/bounds.hh"
+#include "core/jobs.hh"
+#include "core/loader.hh"
+
+#ifdef PHYSICS_IS_BULLET
+#include "backends/bullet/bullet.hh"
+#endif
+
+namespace gdt::bench {
+
+void physics_benchmarks(suite& s)
+{
+#ifdef PHYSICS_IS_BULLET
+    // Same setup as the physics_instancing example: 200 crates dropped
+    // on a floor, stepped at 60Hz.
+    if (!s.wants("physics/bullet_crates_200_step")) return;
+    static const int N = 200;
+    physics::bullet::backend world;
+    auto model = read_smd("res/examples/crate2.smd");
+    math::aabb bounds;
+    for (auto& m : model->meshes) {
+        for (auto& v : m->vertices) bounds.expand(v.position);
+    }
+    auto shape = world.make_box_shape(bounds.extents());
+    auto floor = world.make_wall(math::vec3(0, 1, 0), math::vec3(0, -1, 0));
+    std::vector<physics::bullet::bullet_rigid_body> bodies;
+    std::vector<math::mat4> transforms(N);
+    srand(1);
+    for (int j = 0; j < N; j++) {
+        math::vec3 pos = math::vec3::random(100, 400, 100) + math::vec3(0, 350, 0);
+        bodies.push_back(world.make_rigid_body(shape, pos, math::quat(0, 0, 0, 1), 2));
+    }
+
+    core_context ctx;
+    ctx.elapsed = 1.0f / 60;
+    s.run("physics/bullet_crates_200_step", [&]() {
+        world.update(ctx);
+        for (int j = 0; j < N; j++) bodies[j].update_transform(&transforms[j]);
+        keep(transforms);
+    }, N);
+
+    // syncing crate transforms back from the physics world, fanned out
+    for (int workers : {0, 1, 3}) {
+        job_system jobs(workers);
+        s.run("physics/bullet_crates_200_sync/workers_" + std::to_string(workers), [&]() {
+            jobs.parallel_for(0, N, [&](int j) { bodies[j].update_transform(&transforms[j]); });
+            keep(transforms);
+        }, N);
+    }
+#endif
+}
+}
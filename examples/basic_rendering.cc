@@ -3,7 +3,7 @@
  *
  * In this examples we'll go through the basics of setting up a GDT
  * application that renders a moon in a fixed position from using a
- * fixed camera.
+ * fixed camera, with two rings of crates around it.
  */
 #include "gdt.h"
 
@@ -13,11 +13,10 @@
  * We'll use an SDL platform backend with an OpenGL graphics
  * backend only.
  */
-#include "backends/sdl/sdl.hh"
-#include "backends/opengl/opengl.hh"
+#include "example_backends.hh"
 
-using my_app = gdt::application<gdt::platform::sdl::backend_for_opengl,
-                                gdt::graphics::opengl::backend, 
+using my_app = gdt::application<examples::platform,
+                                examples::graphics,
                                 gdt::no_audio,
                                 gdt::no_physics,
                                 gdt::no_networking,
@@ -65,11 +64,58 @@ class moon : public my_app::asset<moon>,
     }
 };
 
+/* Crate asset class
+ * -----------------
+ *
+ * The crates are built just like the moon, only we'll load one crate
+ * and draw it many times over.
+ */
+class crate : public my_app::asset<crate>,
+              public my_app::drawable<crate> {
+
+  private:
+    my_app::texture _diffuse_map, _normal_map, _specular_map;
+    my_app::material _material;
+
+  public:
+    crate(const my_app::context& ctx)
+        : my_app::drawable<crate>(ctx, "res/examples/crate2.smd"),
+          _diffuse_map(ctx, "res/examples/crate2_d.png"),
+          _normal_map(ctx, "res/examples/crate2_n.png"),
+          _specular_map(ctx, "res/examples/crate2_s.png"),
+          _material(ctx, &_diffuse_map, &_normal_map, &_specular_map)
+    {
+    }
+
+    const my_app::material& get_material() const
+    {
+        return _material;
+    }
+};
+
+/* Placing the crates
+ * ------------------
+ *
+ * References draw an asset kept elsewhere, and take a callback that
+ * returns the transform of each instance. This one lays count small
+ * crates out in a ring.
+ */
+static std::function<gdt::math::mat4(int)> ring(float radius, int count)
+{
+    return [radius, count](int j) {
+        float a = 2.0f * float(M_PI) * float(j) / float(count);
+        return gdt::math::mat4::world({radius * cosf(a), 0, radius * sinf(a)},
+                                      {0.3f, 0.3f, 0.3f}, {0, 0, 0, 1})
+            .transpose();
+    };
+}
+
 /* Our space_scene
  * ---------------
  *
  * space_scene is a subclass of our application type scene class.
- * We will store our moon asset and a basic camera as members of the scene.
+ * We will store our moon asset, the crates and a basic camera as members of
+ * the scene.
  * We will also override the required methods to update and render the scene.
  *
  * Note how we use gtd::instance to extend both our moon asset and the camera
@@ -77,16 +123,23 @@ class moon : public my_app::asset<moon>,
  */
 class space_scene : public my_app::scene {
     gdt::instance<moon> _moon;
+    crate _crate;
+    gdt::references<crate, 8> _inner_crates;
+    gdt::references<crate, 12> _outer_crates;
     gdt::instance<gdt::camera> _camera;
     my_app::forward_pipeline _pipeline;
+    my_app::render_queue _queue;
 
   public:
 
-    /* When constructing the scene, we will also construct our moon asset
-     * and the camera instance
+    /* When constructing the scene, we will also construct our moon asset,
+     * the crates and the camera instance
      */
     space_scene(const my_app::context& ctx, gdt::screen* screen)
         : _moon(ctx, gdt::pos::origin),
+          _crate(ctx),
+          _inner_crates(ctx, ring(6, 8), &_crate),
+          _outer_crates(ctx, ring(9, 12), &_crate),
           _camera(ctx, gdt::pos::look_at({10, 0, -20}, {0, 0, 0}), screen),
           _pipeline(ctx)
     {
@@ -113,14 +166,32 @@ class space_scene : public my_app::scene {
         my_app::render_pass(ctx)
             .target(my_app::graphics::screen_buffer)
             .clear({0, 0, 0, 1});
-        /* Then we use a forward rendering pipeline, set the material to our
-         * moon material, the camera and then invoke a single draw call
-         * to draw the moon on the screen.
+        /* Then, rather than drawing right away, we submit our draws to
+         * a render queue, each with the pipeline and material it needs.
+         * The queue sorts them by both before drawing, so the two crate
+         * rings share a single material change even though the moon
+         * was submitted in between. The crates are culled against the
+         * camera when their draws are issued.
          */
-        _pipeline.use(ctx)
-            .set_material(_moon.get_drawable().get_material())
-            .set_camera(_camera)
-            .draw(_moon);
+        _queue.clear();
+        _queue.submit(0, _pipeline, &_crate.get_material(), _inner_crates,
+                      gdt::culling::frustum);
+        _queue.submit(0, _pipeline, &_moon.get_drawable().get_material(), _moon);
+        _queue.submit(0, _pipeline, &_crate.get_material(), _outer_crates,
+                      gdt::culling::frustum);
+        /* The camera is set on the pipeline once, and the queue issues
+         * the draws.
+         */
+        _pipeline.use(ctx).set_camera(_camera);
+        _queue.execute(ctx);
+    }
+
+    /* The queue counts the pipeline and material changes it made this
+     * frame, and how many drawing in submission order would have taken.
+     */
+    void imgui(const my_app::context& ctx) override
+    {
+        _queue.imgui();
     }
 };
 
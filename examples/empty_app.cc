@@ -6,11 +6,10 @@
  */
 #include "gdt.h"
 
-#include "backends/sdl/sdl.hh"
-#include "backends/opengl/opengl.hh"
+#include "example_backends.hh"
 
-using my_app = gdt::application<gdt::platform::sdl::backend_for_opengl,
-                                gdt::graphics::opengl::backend,
+using my_app = gdt::application<examples::platform,
+                                examples::graphics,
                                 gdt::no_audio,
                                 gdt::no_physics,
                                 gdt::no_networking,
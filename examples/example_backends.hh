@@ -0,0 +1,41 @@
+/* examples / example_backends.hh
+ * ===============================
+ *
+ * The platform and graphics backends the examples run on. Normally
+ * that's a window, SDL or GLFW when EXAMPLE_USES_GLFW is defined, with
+ * OpenGL. Built with EXAMPLES_ARE_HEADLESS, the same examples run on the
+ * headless platform with null graphics instead.
+ */
+#ifndef GDT_EXAMPLE_BACKENDS_HEADER_INCLUDED
+#define GDT_EXAMPLE_BACKENDS_HEADER_INCLUDED
+
+#ifdef EXAMPLES_ARE_HEADLESS
+#include "backends/headless/headless.hh"
+#include "backends/null/null.hh"
+#else
+#ifdef EXAMPLE_USES_GLFW
+#include "backends/glfw/glfw_opengl.hh"
+#else
+#include "backends/sdl/sdl.hh"
+#endif
+#include "backends/opengl/opengl.hh"
+#endif
+
+namespace examples {
+
+#if defined(EXAMPLES_ARE_HEADLESS)
+using platform = gdt::platform::headless::backend;
+template <typename PLATFORM>
+using graphics = gdt::graphics::null::backend<PLATFORM>;
+#elif defined(EXAMPLE_USES_GLFW)
+using platform = gdt::platform::glfw::backend_for_opengl;
+template <typename PLATFORM>
+using graphics = gdt::graphics::opengl::backend<PLATFORM>;
+#else
+using platform = gdt::platform::sdl::backend_for_opengl;
+template <typename PLATFORM>
+using graphics = gdt::graphics::opengl::backend<PLATFORM>;
+#endif
+}
+
+#endif  // GDT_EXAMPLE_BACKENDS_HEADER_INCLUDED
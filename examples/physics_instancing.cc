@@ -16,15 +16,15 @@
  *
  */
 
-#include "backends/glfw/glfw_opengl.hh"
-#include "backends/opengl/opengl.hh"
+#define EXAMPLE_USES_GLFW
+#include "example_backends.hh"
 #include "backends/bullet/bullet.hh"
 
 #include <algorithm>
 
 using my_app =
-    gdt::application<gdt::platform::glfw::backend_for_opengl,
-                     gdt::graphics::opengl::backend,
+    gdt::application<examples::platform,
+                     examples::graphics,
                      gdt::no_audio,
                      gdt::physics::bullet::backend,
                      gdt::no_networking,
@@ -131,7 +131,7 @@ class deferred_renderer : public my_app::renderer<deferred_renderer>,
          * We begin by setting up our geometery pass, targeting `_g_buffer`,
          * and clearing it.
          */
-        my_app::render_pass(ctx).target(_g_buffer).clear();
+        my_app::render_pass(ctx, "g-buffer").target(_g_buffer).clear();
         ctx.graphics->cull_on();
 
         /* We delegate the cmds callback provided by the user to the graphics
@@ -150,7 +150,7 @@ class deferred_renderer : public my_app::renderer<deferred_renderer>,
          * designed to take an input buffer (`_g_buffer` in our case) and manipulate
          * it by rendering a quad.
          */
-        my_app::render_pass(ctx)
+        my_app::render_pass(ctx, "lighting")
             .target(_buffer)
             .clear()
             .filter(_light_pipeline)
@@ -159,7 +159,7 @@ class deferred_renderer : public my_app::renderer<deferred_renderer>,
 
         /* Finally, we can use the FXAA pipeline for anti-aliasing.
          */
-        my_app::render_pass(ctx)
+        my_app::render_pass(ctx, "fxaa")
             .target(my_app::graphics::screen_buffer)
             .clear()
             .filter(_fxaa_pipeline)
@@ -240,15 +240,25 @@ class physics_scene : public my_app::scene {
         _active_camera_driver = _camera2.get_driver_ptr();
     }
 
-    /* Our frame update code involves updating the `_crates` instances,
-     * the camera controller and the physics backend, as well as checking
-     * for user input. Finally, we call `render` to draw the frame.
+    /* The application runs in fixed update mode (see `main` below), so
+     * the physics backend steps at a steady 60Hz, no matter how fast or
+     * slow frames are. After each step, the crates sample their rigid
+     * bodies.
      */
-    void update(const my_app::context& ctx) override
+    void fixed_update(const my_app::context& ctx) override
     {
-        _crates.update(ctx);
-        _wsad.update(ctx, _active_camera_driver);
         ctx.physics->update(ctx);
+        _crates.fixed_update(ctx);
+    }
+
+    /* Our frame update code involves blending the `_crates` transforms
+     * between the last two physics steps, updating the camera controller
+     * and checking for user input. Finally, we call `render` to draw the frame.
+     */
+    void update(const my_app::context& ctx, float alpha) override
+    {
+        _crates.interpolate(ctx, alpha);
+        _wsad.update(ctx, _active_camera_driver);
         if (ctx.get_platform()->is_key_pressed(gdt::key::N1)) {
             activate_camera1();
         }
@@ -261,6 +271,11 @@ class physics_scene : public my_app::scene {
         render(ctx);
     }
 
+    void update(const my_app::context& ctx) override
+    {
+        update(ctx, 1.0f);
+    }
+
     /* We'll use the deferred renderer we've built to draw each frame.
      * First, we'll provide a configuration callback to setup the deferred
      * rendering pipelines.
@@ -268,7 +283,7 @@ class physics_scene : public my_app::scene {
      */
     void render(const my_app::context& ctx) override
     {
-        _renderer.configure(ctx, [this, ctx](auto& geom_pipeline, auto& light_pipeline) {
+        _renderer.configure(ctx, [this, &ctx](auto& geom_pipeline, auto& light_pipeline) {
             geom_pipeline.use(ctx)
                 .set_camera(*_active_camera_instance);
             light_pipeline.use(ctx)
@@ -276,11 +291,11 @@ class physics_scene : public my_app::scene {
                 .set_lights(this->_lights);
         });
 
-        _renderer.record(ctx, [this, ctx](auto& geom_pipeline, auto& light_pipeline) {
+        _renderer.record(ctx, [this, &ctx](auto& geom_pipeline, auto& light_pipeline) {
             geom_pipeline.use(ctx)
                 .set_imgui_overrides()
                 .set_material(_crates.get_drawable().get_material())
-                .draw(_crates);
+                .draw(_crates, gdt::culling::frustum);
         });
     }
 
@@ -296,13 +311,17 @@ class physics_scene : public my_app::scene {
         _active_camera_instance->entity_ptr()->imgui();
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                     1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        ImGui::Text("Crates: %d visible, %d culled", ctx.graphics->visible_instances(),
+                    ctx.graphics->culled_instances());
     }
 };
 
 int main()
 {
     try {
-        my_app().run<physics_scene>();
+        auto app = std::make_unique<my_app>();
+        app->set_fixed_update(60);
+        app->run<physics_scene>();
     }
     catch (const std::exception& e) {
         LOG_ERROR << e.what();
@@ -14,11 +14,10 @@
  * We'll use SDL as the platform backend with OpenGL as the graphics backend:
  */
 
-#include "backends/sdl/sdl.hh"
-#include "backends/opengl/opengl.hh"
+#include "example_backends.hh"
 
-using my_app = gdt::application<gdt::platform::sdl::backend_for_opengl,
-                                gdt::graphics::opengl::backend,
+using my_app = gdt::application<examples::platform,
+                                examples::graphics,
                                 gdt::no_audio,
                                 gdt::no_physics,
                                 gdt::no_networking,
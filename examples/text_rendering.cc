@@ -73,7 +73,7 @@ class text_scene : public my_app::scene {
 
     void render(const my_app::context& ctx) override
     {
-        _renderer.record(ctx, [this, ctx](auto& shader) {
+        _renderer.record(ctx, [this, &ctx](auto& shader) {
             shader.use(ctx)
                 .set_scale(_text_scale * _tweak)
                 .set_color({0,0,0,1})
@@ -1,6 +1,7 @@
 #ifndef GDT_BLUEPRINTS_GRAPHICS_INCLUDED
 #define GDT_BLUEPRINTS_GRAPHICS_INCLUDED
 
+#include "bounds.hh"
 #include "checks.hh"
 #include "context.hh"
 #include "math.hh"
@@ -18,6 +19,7 @@ struct surface {
     int n_triangles;
     math::vec3 max_v;
     math::vec3 min_v;
+    math::aabb bounds;
 
     surface(const graphics_context<typename GRAPHICS::backend> &ctx, mesh *m)
     {
@@ -28,19 +30,9 @@ struct surface {
 
     void calc_bounds(const mesh *m)
     {
-        float max_x, min_x, max_y, min_y, max_z, min_z;
-        max_x = min_x = max_y = min_y = max_z = min_z = 0;
-        for (const auto &v : m->vertices) {
-            math::vec3 p = v.position;
-            max_x = std::max(max_x, p.x);
-            max_y = std::max(max_y, p.y);
-            max_z = std::max(max_z, p.z);
-            min_x = std::min(min_x, p.x);
-            min_y = std::min(min_y, p.y);
-            min_z = std::min(min_z, p.z);
-        }
-        max_v = math::vec3(max_x, max_y, max_z);
-        min_v = math::vec3(min_x, min_y, min_z);
+        bounds = m->calc_bounds();
+        max_v = bounds.max;
+        min_v = bounds.min;
     }
 
     template <typename PIPELINE>
@@ -81,6 +73,54 @@ class backend {
     }
     virtual void clear_screen() const = 0;
     virtual void update_frame() = 0;
+
+    /**
+     * Number of draw calls issued, and triangles drawn, since the frame
+     * started. Backends count them as they go and reset the counts in
+     * update_frame().
+     */
+    int draw_calls() const { return _draw_calls; }
+    int64_t triangles() const { return _triangles; }
+    void count_draw_call(int64_t triangles = 0) const
+    {
+        _draw_calls++;
+        _triangles += triangles;
+    }
+
+    /**
+     * Instances drawn, and left out, by draws culling them since the
+     * frame started. See gdt::instance_culler.
+     */
+    int visible_instances() const { return _visible_instances; }
+    int culled_instances() const { return _culled_instances; }
+    void count_culling(int visible, int culled) const
+    {
+        _visible_instances += visible;
+        _culled_instances += culled;
+    }
+
+    /**
+     * GPU timing hooks, for gdt::profiler. render_pass::target starts
+     * a pass zone and pipeline::use a pipeline zone inside it. Each lasts
+     * until the next one of its kind starts, a new pass ends the pipeline
+     * zone too, or until the application calls end_gpu_zones once the
+     * scene is rendered. Backends that can time the GPU hide these.
+     */
+    void begin_gpu_pass(uint32_t site)
+    {
+    }
+    void begin_gpu_pipeline(uint32_t site)
+    {
+    }
+    void end_gpu_zones()
+    {
+    }
+
+  protected:
+    mutable int _draw_calls = 0;
+    mutable int64_t _triangles = 0;
+    mutable int _visible_instances = 0;
+    mutable int _culled_instances = 0;
 };
 };
 #endif  // GDT_BLUEPRINTS_GRAPHICS_INCLUDED
@@ -36,6 +36,14 @@ class backend {
     virtual bool is_key_pressed(key k) const = 0;
     virtual bool is_button_pressed() const = 0;
     virtual void get_mouse(int *x, int *y) const = 0;
+    /**
+     * Look up an OpenGL function by name, for extensions. nullptr on
+     * platforms without an OpenGL context.
+     */
+    virtual void *gl_proc_address([[maybe_unused]] const char *name) const
+    {
+        return nullptr;
+    }
     gdt::screen & screen() { return _screen; }
     const gdt::screen & c_screen() const { return _screen; }
     std::function<void(int w, int h)> on_resize_callback;
@@ -2,6 +2,8 @@
 #define GDT_BULLET_HEADER_INCLUDED
 #include <btBulletDynamicsCommon.h>
 #include "backends/blueprints/physics.hh"
+#include "utils/memory.hh"
+#include "utils/profiler.hh"
 
 namespace gdt::physics::bullet {
 
@@ -14,6 +16,15 @@ static math::vec3 bt_to_vec3(btVector3 v)
     return math::vec3(v.getX(), v.getY(), v.getZ());
 }
 
+static void* bt_allocate(size_t size)
+{
+    return memory::allocate(size, memory::PHYSICS);
+}
+static void bt_deallocate(void* p)
+{
+    memory::deallocate(p);
+}
+
 class ClosestNotMe : public btCollisionWorld::ClosestRayResultCallback {
   public:
     ClosestNotMe(btRigidBody* me, btVector3 a, btVector3 b)
@@ -210,6 +221,9 @@ class backend
 
     backend()
     {
+        // before Bullet allocates anything, whatever it allocates
+        // later is freed with the same functions
+        btAlignedAllocSetCustom(bt_allocate, bt_deallocate);
         broadphase = std::make_unique<btDbvtBroadphase>();
         collisionConfiguration = std::make_unique<btDefaultCollisionConfiguration>();
         dispatcher = std::make_unique<btCollisionDispatcher>(collisionConfiguration.get());
@@ -279,7 +293,17 @@ class backend
 
     void update(const core_context& ctx) override
     {
-        dynamicsWorld->stepSimulation(ctx.elapsed, 10);
+        PROFILE_SCOPE("physics step");
+        memory::scope tag(memory::PHYSICS);
+        uint64_t start = profiler::now();
+        if (ctx.fixed_step > 0) {
+            // the application already runs us at a fixed rate,
+            // so take exactly one step of the same size
+            dynamicsWorld->stepSimulation(ctx.elapsed, 1, ctx.fixed_step);
+        } else {
+            dynamicsWorld->stepSimulation(ctx.elapsed, 10);
+        }
+        PROFILE_COUNTER("physics step ms", (profiler::now() - start) / 1000000.0f);
     }
 
     virtual ~backend()
@@ -170,6 +170,11 @@ void backend_for_opengl::update_window()
 {
     glfwSwapBuffers(s_pWindow);
 }
+void *backend_for_opengl::gl_proc_address(const char *name) const
+{
+    return reinterpret_cast<void *>(glfwGetProcAddress(name));
+}
+
 void backend_for_opengl::imgui_frame() {
    glActiveTexture(GL_TEXTURE0);
    glUseProgram(0);
@@ -13,6 +13,7 @@ public:
 
     void update_window() override;
     void imgui_frame();
+    void *gl_proc_address(const char *name) const override;
 };
 
 };
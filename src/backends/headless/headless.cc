@@ -0,0 +1,178 @@
+#include "headless.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "imgui/imgui.h"
+#include "logger.hh"
+
+namespace gdt::platform::headless {
+
+backend::backend(int w, int h)
+{
+    _screen.w = w;
+    _screen.h = h;
+    if (const char* frames = std::getenv("GDT_HEADLESS_FRAMES")) {
+        _frame_limit = std::max(0, std::atoi(frames));
+    }
+    // nobody is going to move the windows around
+    ImGui::GetIO().IniFilename = nullptr;
+    LOG_DEBUG << "headless platform, " << w << "x" << h << ", frame limit " << _frame_limit;
+}
+
+backend::~backend()
+{
+    ImGui::Shutdown();
+}
+
+bool backend::process_events()
+{
+    if (_frame_limit > 0 && _frame >= _frame_limit) return false;
+    while (_next < _script.size() && _script[_next].frame <= _frame) {
+        // a copy, the callback may script more events
+        input_event e = _script[_next++];
+        switch (e.kind) {
+            case input_event::KEY_DOWN:
+                _keys[e.key] = true;
+                if (on_key_callback) on_key_callback(e.key);
+                break;
+            case input_event::KEY_UP:
+                _keys[e.key] = false;
+                break;
+            case input_event::MOUSE_MOVE:
+                _motion_x += e.x;
+                _motion_y += e.y;
+                break;
+            case input_event::BUTTON_DOWN:
+                _button = true;
+                break;
+            case input_event::BUTTON_UP:
+                _button = false;
+                break;
+        }
+    }
+    _frame++;
+    return true;
+}
+
+void backend::create_window()
+{
+}
+
+void backend::update_window()
+{
+}
+
+void backend::update_keyboard()
+{
+}
+
+bool backend::capture_mouse() const
+{
+    return true;
+}
+
+void backend::release_mouse() const
+{
+}
+
+void backend::update_mouse()
+{
+    _mouse_x = _motion_x;
+    _mouse_y = _motion_y;
+    _motion_x = _motion_y = 0;
+}
+
+bool backend::is_key_pressed(key k) const
+{
+    return _keys[k];
+}
+
+void backend::get_mouse(int* x, int* y) const
+{
+    *x = _mouse_x;
+    *y = _mouse_y;
+}
+
+bool backend::is_button_pressed() const
+{
+    return _button;
+}
+
+void backend::imgui_frame()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    auto now = std::chrono::steady_clock::now();
+    if (!_imgui_ready) {
+        // the atlas has to be built before the first frame even if
+        // nothing ever draws it
+        unsigned char* pixels;
+        int w, h;
+        io.Fonts->GetTexDataAsAlpha8(&pixels, &w, &h);
+        _last_imgui_frame = now;
+        _imgui_ready = true;
+    }
+    float dt = std::chrono::duration<float>(now - _last_imgui_frame).count();
+    _last_imgui_frame = now;
+    io.DisplaySize = ImVec2(_screen.w, _screen.h);
+    io.DeltaTime = dt > 0 ? dt : 1.0f / 60.0f;
+    io.MousePos = ImVec2(-1, -1);
+    ImGui::NewFrame();
+}
+
+std::string backend::read_file(std::string filename)
+{
+    std::ifstream f(filename, std::ios::binary);
+    std::stringstream buf;
+    buf << f.rdbuf();
+    return buf.str();
+}
+
+backend& backend::set_frame_limit(int frames)
+{
+    _frame_limit = frames;
+    return *this;
+}
+
+backend& backend::script(input_event e)
+{
+    if (e.kind <= input_event::KEY_UP && (e.key < 0 || e.key > key::SPACE)) {
+        throw std::runtime_error("scripted key out of range");
+    }
+    // events at or before the frames already gone by are all due, so
+    // they are kept sorted only from the next one on
+    auto from = _script.begin() + _next;
+    auto at = std::upper_bound(from, _script.end(), e.frame,
+                               [](int f, const input_event& o) { return f < o.frame; });
+    _script.insert(at, e);
+    return *this;
+}
+
+backend& backend::key_down(int frame, key k)
+{
+    return script({frame, input_event::KEY_DOWN, k, 0, 0});
+}
+
+backend& backend::key_up(int frame, key k)
+{
+    return script({frame, input_event::KEY_UP, k, 0, 0});
+}
+
+backend& backend::mouse_move(int frame, int dx, int dy)
+{
+    return script({frame, input_event::MOUSE_MOVE, 0, dx, dy});
+}
+
+backend& backend::button_down(int frame)
+{
+    return script({frame, input_event::BUTTON_DOWN, 0, 0, 0});
+}
+
+backend& backend::button_up(int frame)
+{
+    return script({frame, input_event::BUTTON_UP, 0, 0, 0});
+}
+}
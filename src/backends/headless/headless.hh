@@ -0,0 +1,103 @@
+#ifndef GDT_HEADLESS_HEADER_INCLUDED
+#define GDT_HEADLESS_HEADER_INCLUDED
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "platform.hh"
+
+namespace gdt::platform::headless {
+
+/**
+ * A platform without a window, a keyboard or a mouse. Input comes from
+ * a script of events, each one applied at the start of a given frame,
+ * and frames run back to back with no vsync to wait for:
+ *
+ *     auto app = std::make_unique<my_server>();
+ *     app->get_platform()
+ *         .key_down(10, gdt::key::W)
+ *         .key_up(70, gdt::key::W)
+ *         .mouse_move(80, 200, 0)
+ *         .set_frame_limit(600);
+ *     app->run<my_scene>();
+ *
+ * The application quits after the frame limit, or runs until told to
+ * quit if there's none. The limit can also come from the
+ * GDT_HEADLESS_FRAMES environment variable, so the same binary can
+ * run a soak test or a short smoke test.
+ *
+ * Key events reach application::on_key with gdt::key values.
+ * The mouse is relative, like SDL's: get_mouse returns the motion
+ * scripted for the current frame.
+ *
+ * Pair it with gdt::graphics::null::backend, which doesn't need a GL
+ * context either.
+ */
+class backend : public blueprints::platform::backend {
+  public:
+    struct input_event {
+        enum kind_t { KEY_DOWN, KEY_UP, MOUSE_MOVE, BUTTON_DOWN, BUTTON_UP };
+        int frame;
+        kind_t kind;
+        int key;
+        int x;
+        int y;
+    };
+
+    backend(int w = 1280, int h = 720);
+    virtual ~backend();
+    bool process_events() override;
+    void create_window() override;
+    void update_window() override;
+    void update_keyboard() override;
+    bool capture_mouse() const override;
+    void release_mouse() const override;
+    void update_mouse() override;
+    bool is_key_pressed(key k) const override;
+    void get_mouse(int* x, int* y) const override;
+    bool is_button_pressed() const override;
+    void imgui_frame();
+    static std::string read_file(std::string filename);
+
+    /**
+     * Stop after this many frames, 0 to run until the application quits.
+     */
+    backend& set_frame_limit(int frames);
+
+    /**
+     * Number of frames processed so far.
+     */
+    int frame() const
+    {
+        return _frame;
+    }
+
+    /**
+     * Add an event to the script. Events may be added in any order,
+     * and even while running; events for frames already gone by are
+     * applied on the next frame.
+     */
+    backend& script(input_event e);
+    backend& key_down(int frame, key k);
+    backend& key_up(int frame, key k);
+    backend& mouse_move(int frame, int dx, int dy);
+    backend& button_down(int frame);
+    backend& button_up(int frame);
+
+  private:
+    std::vector<input_event> _script;
+    size_t _next = 0;
+    int _frame = 0;
+    int _frame_limit = 0;
+    bool _keys[key::SPACE + 1] = {};
+    bool _button = false;
+    int _mouse_x = 0;
+    int _mouse_y = 0;
+    int _motion_x = 0;
+    int _motion_y = 0;
+    bool _imgui_ready = false;
+    std::chrono::steady_clock::time_point _last_imgui_frame;
+};
+};
+#endif  // GDT_HEADLESS_HEADER_INCLUDED
@@ -0,0 +1,398 @@
+#ifndef GDT_NULL_GRAPHICS_HEADER_INCLUDED
+#define GDT_NULL_GRAPHICS_HEADER_INCLUDED
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "backends/blueprints/graphics.hh"
+#include "core/assets.hh"
+#include "core/math.hh"
+#include "core/mesh.hh"
+#include "core/screen.hh"
+#include "utils/memory.hh"
+
+namespace gdt::graphics::null {
+
+template <typename GRAPHICS>
+struct null_color_buffer {
+    static int counter;
+    unsigned int tex = 0;
+    int unit;
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    null_color_buffer([[maybe_unused]] const graphics_context<GRAPHICS> &ctx) : unit(counter++)
+    {
+    }
+    virtual ~null_color_buffer()
+    {
+    }
+    virtual void create(unsigned int w, unsigned int h)
+    {
+        width = w;
+        height = h;
+    }
+};
+
+template <typename GRAPHICS>
+int null_color_buffer<GRAPHICS>::counter = 0;
+
+template <typename GRAPHICS>
+struct null_texture : null_color_buffer<GRAPHICS> {
+    // Only the size is read, from the PNG header, there's no point in
+    // decoding pixels nobody will sample.
+    null_texture(const graphics_context<GRAPHICS> &ctx, std::string filename)
+        : null_color_buffer<GRAPHICS>(ctx)
+    {
+        unsigned char *img;
+        if (asset_cache::take_image(filename, &img, &this->width, &this->height)) {
+            free(img);
+            return;
+        }
+        unsigned char header[24];
+        std::ifstream f(filename, std::ios::binary);
+        if (!f.read(reinterpret_cast<char *>(header), sizeof(header))) {
+            LOG_WARNING << "cannot read texture " << filename;
+            return;
+        }
+        auto be32 = [&header](int at) {
+            return (uint32_t(header[at]) << 24) | (uint32_t(header[at + 1]) << 16) |
+                   (uint32_t(header[at + 2]) << 8) | uint32_t(header[at + 3]);
+        };
+        this->width = be32(16);
+        this->height = be32(20);
+    }
+};
+
+template <typename GRAPHICS>
+class null_base_buffer {
+  protected:
+    unsigned int _w = 0, _h = 0;
+
+  public:
+    virtual ~null_base_buffer()
+    {
+    }
+    unsigned int width() const
+    {
+        return _w;
+    }
+    unsigned int height() const
+    {
+        return _h;
+    }
+    void bind() const
+    {
+    }
+    void copy_depth_from([[maybe_unused]] const null_base_buffer<GRAPHICS> &b) const
+    {
+    }
+    virtual void resize(unsigned int w, unsigned int h)
+    {
+        _w = w;
+        _h = h;
+    }
+};
+
+template <typename GRAPHICS>
+class null_depth_frame_buffer : public null_base_buffer<GRAPHICS> {
+  public:
+    std::vector<null_color_buffer<GRAPHICS> *> _attachments;
+
+    null_depth_frame_buffer([[maybe_unused]] const graphics_context<GRAPHICS> &ctx,
+                            unsigned int w, unsigned int h)
+    {
+        this->_w = w;
+        this->_h = h;
+    }
+    void attachments(std::vector<null_color_buffer<GRAPHICS> *> attachments, unsigned int w,
+                     unsigned int h)
+    {
+        for (auto *b : attachments) b->create(w, h);
+        _attachments = attachments;
+    }
+    void resize(unsigned int w, unsigned int h) override
+    {
+        null_base_buffer<GRAPHICS>::resize(w, h);
+        for (auto *b : _attachments) b->create(w, h);
+    }
+};
+
+template <typename GRAPHICS>
+class null_back_buffer : public null_depth_frame_buffer<GRAPHICS> {
+  public:
+    null_color_buffer<GRAPHICS> _color_buffer;
+
+    null_back_buffer(const graphics_context<GRAPHICS> &ctx, unsigned int w, unsigned int h)
+        : null_depth_frame_buffer<GRAPHICS>(ctx, w, h), _color_buffer(ctx)
+    {
+        this->attachments({&_color_buffer}, w, h);
+    }
+};
+
+class null_render_pass_clear_cmd {
+  public:
+    void apply([[maybe_unused]] math::vec4 c = {0.9, 0.9, 0.9, 0.0}) const
+    {
+    }
+};
+
+template <typename GRAPHICS>
+class null_pipeline : public blueprints::graphics::pipeline<GRAPHICS> {
+  private:
+    mutable GRAPHICS *_graphics = nullptr;
+
+  public:
+    using sampler = int;
+    using uniform = int;
+    using attrib = int;
+
+    null_pipeline([[maybe_unused]] std::string fragment, [[maybe_unused]] std::string vertex)
+    {
+    }
+    null_pipeline([[maybe_unused]] std::string name)
+    {
+    }
+    virtual ~null_pipeline()
+    {
+    }
+    null_pipeline(const null_pipeline &) = delete;
+    null_pipeline &operator=(const null_pipeline &) = delete;
+
+    void use(const graphics_context<GRAPHICS> &ctx) const
+    {
+        _graphics = ctx.graphics;
+    }
+    void unuse([[maybe_unused]] const graphics_context<GRAPHICS> &ctx) const
+    {
+        _graphics = nullptr;
+    }
+
+    sampler add_sampler([[maybe_unused]] std::string id) const
+    {
+        return 0;
+    }
+    uniform add_uniform([[maybe_unused]] std::string id) const
+    {
+        return 0;
+    }
+    attrib add_attrib([[maybe_unused]] std::string id) const
+    {
+        return 0;
+    }
+
+    void bind_sampler([[maybe_unused]] sampler id,
+                      [[maybe_unused]] const null_color_buffer<GRAPHICS> *t) const
+    {
+    }
+    void bind_uniform([[maybe_unused]] uniform id, [[maybe_unused]] gdt::math::mat4 mat) const
+    {
+    }
+    void bind_uniform([[maybe_unused]] uniform id, [[maybe_unused]] gdt::math::vec4 v) const
+    {
+    }
+    void bind_uniform([[maybe_unused]] uniform id, [[maybe_unused]] gdt::math::vec3 v) const
+    {
+    }
+    void bind_uniform([[maybe_unused]] uniform id, [[maybe_unused]] gdt::math::vec2 v) const
+    {
+    }
+    void bind_uniform([[maybe_unused]] uniform id,
+                      [[maybe_unused]] std::vector<gdt::math::vec4> v) const
+    {
+    }
+    void bind_uniform([[maybe_unused]] uniform id, [[maybe_unused]] gdt::math::vec4 *v,
+                      [[maybe_unused]] int c) const
+    {
+    }
+    void bind_uniform([[maybe_unused]] uniform id, [[maybe_unused]] float v) const
+    {
+    }
+    void bind_float_attrib([[maybe_unused]] attrib id, [[maybe_unused]] int count,
+                           [[maybe_unused]] int stride, [[maybe_unused]] void *ptr) const
+    {
+    }
+    void bind_input([[maybe_unused]] const null_render_pass_clear_cmd &cmd) const
+    {
+    }
+    void disable_attrib([[maybe_unused]] attrib id) const
+    {
+    }
+    void bind_instances_data([[maybe_unused]] attrib id) const
+    {
+    }
+
+  protected:
+    graphics_context<GRAPHICS> adhoc_context() const
+    {
+        return graphics_context<GRAPHICS>{_graphics};
+    }
+};
+
+template <typename GRAPHICS>
+class null_filter_pipeline : public null_pipeline<GRAPHICS>, public screen::subscriber {
+  public:
+    null_filter_pipeline([[maybe_unused]] const graphics_context<GRAPHICS> &ctx,
+                         std::string frag)
+        : null_pipeline<GRAPHICS>(frag)
+    {
+    }
+    using null_pipeline<GRAPHICS>::bind_input;
+    void bind_input([[maybe_unused]] const null_back_buffer<GRAPHICS> &gb) const
+    {
+    }
+    void on_screen_resize([[maybe_unused]] unsigned int w, [[maybe_unused]] unsigned int h) override
+    {
+    }
+};
+
+template <typename GRAPHICS>
+struct null_surface : blueprints::graphics::surface<GRAPHICS, null_surface<GRAPHICS>> {
+    null_surface(const graphics_context<typename GRAPHICS::backend> &ctx, mesh *m)
+        : blueprints::graphics::surface<GRAPHICS, null_surface<GRAPHICS>>(ctx, m)
+    {
+        this->calc_bounds(m);
+        this->n_vertices = m->vertices.size();
+        this->n_triangles = m->triangles.size() / 3;
+    }
+
+    template <typename PIPELINE>
+    void draw_instanced(const GRAPHICS &backend, const PIPELINE &shader,
+                        [[maybe_unused]] const math::mat4 *transforms, int count) const
+    {
+        shader.bind_instances();
+        shader.enable_vertex_attributes();
+        backend.count_draw_call(int64_t(this->n_triangles) * count);
+        shader.disable_all_vertex_attribs();
+    }
+};
+
+template <typename GRAPHICS>
+class null_text : public blueprints::graphics::text<GRAPHICS> {
+  public:
+    null_text(const graphics_context<GRAPHICS> &ctx, const font<GRAPHICS> &f, const char *text)
+        : blueprints::graphics::text<GRAPHICS>(ctx, f, text)
+    {
+        frame_vector<gdt::vertex> vs;
+        frame_vector<uint32_t> triangles;
+        f.layout(text, f.get_atlas_width(), f.get_atlas_height(), vs, triangles);
+        _n_triangles = triangles.size() / 3;
+    }
+
+    void draw(const graphics_context<GRAPHICS> &ctx, const text_pipeline<GRAPHICS> &shader,
+              const gdt::math::mat4 *transform) const override
+    {
+        shader.set_transform(transform[0]);
+        shader.enable_vertex_attributes();
+        ctx.graphics->count_draw_call(_n_triangles);
+        shader.disable_all_vertex_attribs();
+    }
+
+  private:
+    std::uint32_t _n_triangles;
+};
+
+/**
+ * The null graphics backend has the same types and methods as the OpenGL
+ * backend, without a single GL call. Meshes, fonts and textures still
+ * load, pipelines still get their uniforms and draws are still issued,
+ * they just don't go anywhere. What's left is the CPU side of a frame,
+ * and the number of draw calls and triangles it submitted.
+ *
+ * Together with the headless platform, it runs scenes on build servers,
+ * as dedicated game servers or in benchmarks:
+ *
+ *     using my_server = gdt::application<gdt::platform::headless::backend,
+ *                                        gdt::graphics::null::backend,
+ *                                        gdt::no_audio,
+ *                                        gdt::physics::bullet::backend,
+ *                                        gdt::no_networking,
+ *                                        gdt::context>;
+ */
+template <typename PLATFORM>
+class backend : public blueprints::graphics::backend<backend<PLATFORM>>, screen::subscriber {
+  private:
+    std::vector<std::unique_ptr<math::mat4[]>> _instance_bufs;
+
+  public:
+    using pipeline = null_pipeline<backend>;
+    using filter_pipeline = null_filter_pipeline<backend>;
+    using base_pipeline = null_pipeline<backend>;
+    using cbackend = backend<PLATFORM>;
+    using surface = null_surface<cbackend>;
+    using texture = null_texture<cbackend>;
+    using frame_buffer = null_base_buffer<cbackend>;
+    using back_buffer = null_back_buffer<cbackend>;
+    using depth_enabled_frame_buffer = null_depth_frame_buffer<cbackend>;
+    using rgb16_buffer = null_color_buffer<cbackend>;
+    using rgba_buffer = null_color_buffer<cbackend>;
+    using text = null_text<cbackend>;
+
+    static const null_render_pass_clear_cmd clear;
+    static const null_base_buffer<backend> screen_buffer;
+
+    backend([[maybe_unused]] PLATFORM *p, screen *screen)
+    {
+        screen->subscribe(this);
+    }
+
+    void clear_screen() const override
+    {
+    }
+    void update_frame() override
+    {
+        this->_draw_calls = 0;
+        this->_triangles = 0;
+        this->_visible_instances = 0;
+        this->_culled_instances = 0;
+    }
+    void blend_on() const
+    {
+    }
+    void blend_off() const
+    {
+    }
+    void cull_on() const
+    {
+    }
+    void cull_off() const
+    {
+    }
+    void on_screen_resize([[maybe_unused]] unsigned int w, [[maybe_unused]] unsigned int h) override
+    {
+    }
+
+    template <typename CMDS, typename... SHADER>
+    void process_cmds(const CMDS &cmds, const SHADER &... s)
+    {
+        cmds(s...);
+    }
+
+    void create_instance_buffer(math::mat4 **d, int c)
+    {
+        memory::scope tag(memory::INSTANCES);
+        _instance_bufs.emplace_back(new math::mat4[c]);
+        *d = _instance_bufs.back().get();
+    }
+    void update_instance_buffer([[maybe_unused]] math::mat4 *data, [[maybe_unused]] int count)
+    {
+    }
+
+    void render_quad()
+    {
+        this->count_draw_call(2);
+    }
+};
+
+template <typename PLATFORM>
+const null_render_pass_clear_cmd backend<PLATFORM>::clear;
+
+template <typename PLATFORM>
+const null_base_buffer<backend<PLATFORM>> backend<PLATFORM>::screen_buffer;
+}
+#endif  // GDT_NULL_GRAPHICS_HEADER_INCLUDED
@@ -1,5 +1,6 @@
 #include "backends/openal/openal.hh"
 #include "checks.hh"
+#include "memory.hh"
 
 #define AL_CHECK(WHAT)                                      \
   WHAT;                                                     \
@@ -39,6 +40,7 @@ int backend::sound_impl::get_sound_file_type(string filepath) {
 
 int backend::sound_impl::load(string path) {
   LOG_DEBUG << "loading " << path;
+  memory::scope tag(memory::AUDIO);
   invalid_file= false;
   filepath = path;
 
@@ -15,6 +15,7 @@
 #include "opengl_shaders.hh"
 #include "opengl_surface.hh"
 #include "opengl_text.hh"
+#include "opengl_timer.hh"
 
 namespace gdt::graphics::opengl {
 /**
@@ -24,6 +25,7 @@ template <typename PLATFORM>
 class backend : public blueprints::graphics::backend<backend<PLATFORM>>, screen::subscriber {
   private:
     std::vector<math::mat4 *> _instance_bufs;
+    opengl_gpu_timer _gpu_timer;
 
   public:
     using pipeline = opengl_pipeline<backend, PLATFORM>;
@@ -45,6 +47,9 @@ class backend : public blueprints::graphics::backend<backend<PLATFORM>>, screen:
     backend(PLATFORM *p, screen *screen)
     {
         screen->subscribe(this);
+#ifdef PROFILER_IS_ENABLED
+        _gpu_timer.init(p);
+#endif
     }
 
     virtual ~backend()
@@ -88,16 +93,37 @@ class backend : public blueprints::graphics::backend<backend<PLATFORM>>, screen:
 
     void update_frame() override
     {
+        this->_draw_calls = 0;
+        this->_triangles = 0;
+        this->_visible_instances = 0;
+        this->_culled_instances = 0;
+        _gpu_timer.frame();
     }
 
-    template <typename... SHADER>
-    void process_cmds(std::function<void(const SHADER &...)> cmds, const SHADER &... s)
+    void begin_gpu_pass(uint32_t site)
+    {
+        _gpu_timer.begin_pass(site);
+    }
+
+    void begin_gpu_pipeline(uint32_t site)
+    {
+        _gpu_timer.begin_pipeline(site);
+    }
+
+    void end_gpu_zones()
+    {
+        _gpu_timer.end_zones();
+    }
+
+    template <typename CMDS, typename... SHADER>
+    void process_cmds(const CMDS &cmds, const SHADER &... s)
     {
         cmds(s...);
     }
 
     void create_instance_buffer(math::mat4 **d, int c)
     {
+        memory::scope tag(memory::INSTANCES);
         *d = new math::mat4[c];
         _instance_bufs.push_back(*d);
     }
@@ -130,6 +156,7 @@ class backend : public blueprints::graphics::backend<backend<PLATFORM>>, screen:
         }
         glBindVertexArray(quadVAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        this->count_draw_call(2);
         glBindVertexArray(0);
         glDisableVertexAttribArray(0);
         glDisableVertexAttribArray(1);
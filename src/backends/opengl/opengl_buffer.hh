@@ -1,9 +1,13 @@
 #ifndef BRICKS_OPENGL_OPENGL_BUFFER_HH_INCLUDED
 #define BRICKS_OPENGL_OPENGL_BUFFER_HH_INCLUDED
 
+#include <memory>
 #include <vector>
 
+#include "arena.hh"
+#include "assets.hh"
 #include "loader.hh"
+#include "memory.hh"
 
 namespace gdt::graphics::opengl {
 
@@ -14,6 +18,7 @@ struct opengl_color_buffer {
     GLint unit;
     unsigned int width;
     unsigned int height;
+    int64_t gpu_bytes = 0;
 
     opengl_color_buffer(const graphics_context<B> &ctx);
 
@@ -22,6 +27,14 @@ struct opengl_color_buffer {
     virtual void create(unsigned int w, unsigned int h)
     {
     }
+
+    // estimated texture memory, for gdt::memory
+    void account(int64_t bytes)
+    {
+        memory::gpu_free(memory::TEXTURES, gpu_bytes);
+        gpu_bytes = bytes;
+        memory::gpu_alloc(memory::TEXTURES, gpu_bytes);
+    }
 };
 
 template <typename GRAPHICS>
@@ -41,6 +54,7 @@ struct opengl_rgba_buffer : opengl_color_buffer<GRAPHICS> {
         GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
         this->width = w;
         this->height = h;
+        this->account(int64_t(w) * h * 4);
     }
 };
 
@@ -60,6 +74,7 @@ struct opengl_rgb16_buffer : opengl_color_buffer<GRAPHICS> {
         GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
         this->width = w;
         this->height = h;
+        this->account(int64_t(w) * h * 6);
     }
 };
 
@@ -69,6 +84,7 @@ int opengl_color_buffer<B>::counter = 0;
 template <typename B>
 struct opengl_texture : opengl_color_buffer<B> {
     opengl_texture(const graphics_context<B> &ctx, std::string filename);
+    ~opengl_texture();
     void create_texture(const char *filename);
 };
 
@@ -87,10 +103,17 @@ opengl_texture<B>::opengl_texture(const graphics_context<B> &ctx, std::string fi
     create_texture(filename.c_str());
 }
 
+template <typename B>
+opengl_texture<B>::~opengl_texture()
+{
+    upload_queue::cancel(this);
+}
+
 template <typename B>
 opengl_color_buffer<B>::~opengl_color_buffer()
 {
     GL_CHECK(glDeleteTextures(1, &tex));
+    memory::gpu_free(memory::TEXTURES, gpu_bytes);
 }
 
 template <typename B>
@@ -98,17 +121,21 @@ void opengl_texture<B>::create_texture(const char *filename)
 {
     unsigned char *img;
     unsigned int ww, hh;
-    GL_CHECK(glBindTexture(GL_TEXTURE_2D, this->tex));
-    if (load_png_for_texture(&img, &ww, &hh, filename)) {
-        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CHECK(
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, ww, hh, 0, GL_RGBA, GL_UNSIGNED_BYTE, img));
-        free(img);
+    if (asset_cache::take_image(filename, &img, &ww, &hh) ||
+        load_png_for_texture(&img, &ww, &hh, filename)) {
         this->width = ww;
         this->height = hh;
+        std::unique_ptr<unsigned char, void (*)(void *)> pixels(img, free);
+        upload_queue::submit(size_t(ww) * hh * 4, [this, pixels = std::move(pixels)]() {
+            GL_CHECK(glBindTexture(GL_TEXTURE_2D, this->tex));
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+            GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+            GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, this->width, this->height, 0,
+                                  GL_RGBA, GL_UNSIGNED_BYTE, pixels.get()));
+            this->account(int64_t(this->width) * this->height * 4);
+        }, this);
     }
 }
 
@@ -192,7 +219,8 @@ class opengl_frame_buffer : public opengl_base_buffer<GRAPHICS> {
     void attachments(std::vector<opengl_color_buffer<GRAPHICS> *> attachments, unsigned int w,
                      unsigned int h)
     {
-        std::vector<GLuint> attach_ids;
+        frame_vector<GLuint> attach_ids;
+        attach_ids.reserve(attachments.size());
         for (auto *b : attachments) {
             b->create(w, h);
             attach_ids.push_back(this->attach(*b));
@@ -208,6 +236,15 @@ class opengl_frame_buffer : public opengl_base_buffer<GRAPHICS> {
 template <typename GRAPHICS>
 class opengl_depth_frame_buffer : public opengl_frame_buffer<GRAPHICS> {
     GLuint rbo_depth;
+    int64_t _depth_bytes = 0;
+
+    // a 24 bit depth buffer usually takes 32 bits per pixel
+    void account(unsigned int w, unsigned int h)
+    {
+        memory::gpu_free(memory::TEXTURES, _depth_bytes);
+        _depth_bytes = int64_t(w) * h * 4;
+        memory::gpu_alloc(memory::TEXTURES, _depth_bytes);
+    }
 
   public:
     opengl_depth_frame_buffer(const graphics_context<GRAPHICS> &ctx, unsigned int w,
@@ -217,6 +254,7 @@ class opengl_depth_frame_buffer : public opengl_frame_buffer<GRAPHICS> {
         GL_CHECK(glGenRenderbuffers(1, &rbo_depth));
         GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, rbo_depth));
         GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, w, h));
+        account(w, h);
         GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
                                            rbo_depth));
         GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
@@ -227,12 +265,14 @@ class opengl_depth_frame_buffer : public opengl_frame_buffer<GRAPHICS> {
         GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, this->_buffer));
         GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, rbo_depth));
         GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, w, h));
+        account(w, h);
         GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
     }
     virtual ~opengl_depth_frame_buffer()
     {
         LOG_DEBUG << "cleaning up frame buffer";
         GL_CHECK(glDeleteRenderbuffers(1, &rbo_depth));
+        memory::gpu_free(memory::TEXTURES, _depth_bytes);
     }
 };
 
@@ -21,6 +21,7 @@ class opengl_pipeline : public blueprints::graphics::pipeline<GRAPHICS> {
 
   private:
     mutable GRAPHICS * _graphics;
+    uint32_t _gpu_site = 0;
     void check_shader(GLuint shader) const;
     void check_program(GLuint program) const;
     void load_shaders(GLuint *shader, std::string buf, GLint shader_type);
@@ -177,6 +178,12 @@ opengl_pipeline<GRAPHICS, PLATFORM>::opengl_pipeline(std::string fragment, std::
     GL_CHECK(glAttachShader(this->shader_program, this->shader_vert));
     GL_CHECK(glAttachShader(this->shader_program, this->shader_frag));
     GL_CHECK(glLinkProgram(this->shader_program));
+#ifdef PROFILER_IS_ENABLED
+    // timed on the GPU under the shader's name, "res/shaders/fxaa.frag" as "fxaa"
+    size_t slash = fragment.find_last_of('/');
+    std::string name = fragment.substr(slash == std::string::npos ? 0 : slash + 1);
+    _gpu_site = profiler::site_id(name.substr(0, name.find('.')));
+#endif
 }
 
 template <typename GRAPHICS, typename PLATFORM>
@@ -247,6 +254,9 @@ void opengl_pipeline<GRAPHICS, PLATFORM>::use(const graphics_context<GRAPHICS> &
 {
     GL_CHECK(glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *)&this->last_program));
     GL_CHECK(glUseProgram(this->shader_program));
+#ifdef PROFILER_IS_ENABLED
+    ctx.graphics->begin_gpu_pipeline(_gpu_site);
+#endif
     // This is our opportunity to store the graphics backend for any consecutive
     // calls to this pipeline;
     _graphics = ctx.graphics;
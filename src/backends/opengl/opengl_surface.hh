@@ -9,6 +9,10 @@ struct opengl_surface : blueprints::graphics::surface<GRAPHICS, opengl_surface<G
     GLuint triangle_vbo;
     GLuint transform_vbo;
     GLuint world_vbo;
+    int64_t gpu_bytes;
+    // transform_vbo only grows, so a changing instance count doesn't
+    // reallocate it every frame
+    mutable int64_t transform_capacity = 0;
     opengl_surface(const graphics_context<typename GRAPHICS::backend> &ctx, mesh *m);
     virtual ~opengl_surface();
 
@@ -20,8 +24,15 @@ struct opengl_surface : blueprints::graphics::surface<GRAPHICS, opengl_surface<G
     {
         GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, this->transform_vbo));
         shader.bind_instances();
-        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(math::mat4) * count, transforms,
-                              GL_DYNAMIC_DRAW));
+        int64_t bytes = int64_t(sizeof(math::mat4)) * count;
+        if (bytes > transform_capacity) {
+            int64_t grown = std::max(bytes, transform_capacity * 2);
+            memory::gpu_alloc(memory::INSTANCES, grown - transform_capacity);
+            transform_capacity = grown;
+        }
+        // orphan the old storage rather than wait for draws still using it
+        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, transform_capacity, nullptr, GL_DYNAMIC_DRAW));
+        GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, transforms));
 
         GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, this->vertex_vbo));
         shader.enable_vertex_attributes();
@@ -29,6 +40,7 @@ struct opengl_surface : blueprints::graphics::surface<GRAPHICS, opengl_surface<G
         GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->triangle_vbo));
         GL_CHECK(glDrawElementsInstanced(GL_TRIANGLES, this->n_triangles * 3, GL_UNSIGNED_INT,
                                          (void *)0, count));
+        backend.count_draw_call(int64_t(this->n_triangles) * count);
 
         shader.disable_all_vertex_attribs();
         // IMGUI
@@ -45,6 +57,8 @@ opengl_surface<GRAPHICS>::~opengl_surface()
     glDeleteBuffers(1, &triangle_vbo);
     glDeleteBuffers(1, &transform_vbo);
     glDeleteBuffers(1, &world_vbo);
+    memory::gpu_free(memory::MESHES, gpu_bytes);
+    memory::gpu_free(memory::INSTANCES, transform_capacity);
 }
 
 template <typename GRAPHICS>
@@ -81,6 +95,9 @@ opengl_surface<GRAPHICS>::opengl_surface(
                  &m->triangles[0], GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gpu_bytes = int64_t(sizeof(float)) * this->n_vertices * vertex_size +
+                int64_t(sizeof(uint32_t)) * this->n_triangles * 3;
+    memory::gpu_alloc(memory::MESHES, gpu_bytes);
 }
 }
 
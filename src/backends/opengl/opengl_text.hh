@@ -4,6 +4,7 @@
 #include "backends/blueprints/graphics.hh"
 #include "core/context.hh"
 #include "core/font.hh"
+#include "utils/memory.hh"
 
 namespace gdt::graphics::opengl {
 
@@ -24,6 +25,7 @@ class opengl_text : public gdt::blueprints::graphics::text<GRAPHICS> {
     GLuint _vertex_vbo;
     GLuint _triangle_vbo;
     std::uint32_t _n_triangles;
+    int64_t _gpu_bytes;
 };
 
 template <typename GRAPHICS>
@@ -34,85 +36,27 @@ opengl_text<GRAPHICS>::opengl_text(const graphics_context<GRAPHICS>& ctx,
     GL_CHECK(glGenBuffers(1, &this->_vertex_vbo));
     GL_CHECK(glGenBuffers(1, &this->_triangle_vbo));
 
-    std::vector<gdt::vertex> vs;
-    std::vector<uint32_t> triangles;
+    frame_vector<gdt::vertex> vs;
+    frame_vector<uint32_t> triangles;
 
-    const char* p;
-    int32_t xpos, ypos;
-    xpos = ypos = 0;
-    uint32_t tid = 0;
-    float zpos = 0;
-    int prev = -1;
-    for (p = text; *p; p++) {
-        if (*p == '\n') {
-            ypos -= f.get_glyph(32).orig_dim.y * 1.5;  // whitespace height X line spacing
-            xpos = 0;
-            continue;
-        }
-        zpos += 0.01;
-        const typename font<GRAPHICS>::glyph_data& m = f.get_glyph(*p);
-        gdt::vertex v1, v2, v3, v4;
+    f.layout(text, f.get_atlas_width(), f.get_atlas_height(), vs, triangles);
 
-        static const float BUF = 0;
-        float offv = m.orig_dim.y - m.dim.y - m.offset.y;
-        xpos += m.offset.x;
-
-        v1.position.x = xpos;
-        v1.position.y = ypos + offv;
-        v1.position.z = zpos;
-        v1.uvs.x = (m.pos.x - BUF) / f.get_atlas_width();
-        v1.uvs.y = 1.0 - (m.pos.y + m.dim.y + BUF) / f.get_atlas_height();
-        vs.push_back(v1);
-
-        v2.position.x = xpos + m.dim.x;
-        v2.position.y = ypos + offv;
-        v2.position.z = zpos;
-        v2.uvs.x = (m.pos.x + m.dim.x + BUF) / f.get_atlas_width();
-        v2.uvs.y = 1.0 - (m.pos.y + m.dim.y + BUF) / f.get_atlas_height();
-        vs.push_back(v2);
-
-        v3.position.x = xpos + m.dim.x;
-        v3.position.y = ypos + m.dim.y + offv;
-        v3.position.z = zpos;
-        v3.uvs.x = (m.pos.x + m.dim.x + BUF) / f.get_atlas_width();
-        v3.uvs.y = 1.0 - (m.pos.y - BUF) / f.get_atlas_height();
-        vs.push_back(v3);
-
-        v4.position.x = xpos;
-        v4.position.y = ypos + m.dim.y + offv;
-        v4.position.z = zpos;
-        v4.uvs.x = (m.pos.x - BUF) / f.get_atlas_width();
-        v4.uvs.y = 1.0 - (m.pos.y - BUF) / f.get_atlas_height();
-        vs.push_back(v4);
-
-        xpos += m.orig_dim.x - m.offset.x - BUF + (prev != -1 ? f.get_kerning(prev, *p) : 0);
-
-        triangles.push_back(tid + 0);
-        triangles.push_back(tid + 1);
-        triangles.push_back(tid + 2);
-        triangles.push_back(tid + 0);
-        triangles.push_back(tid + 2);
-        triangles.push_back(tid + 3);
-
-        tid = tid + 4;
-        prev = *p;
-    }
-
-    float* vb_data = (float*)malloc(sizeof(float) * vs.size() * 18);
+    frame_vector<float> vb_data(vs.size() * 18);
     for (int i = 0; i < vs.size(); i++) {
         vs[i].to_array(&vb_data[(i * 18)]);
     }
 
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, this->_vertex_vbo));
-    GL_CHECK(
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 18 * vs.size(), vb_data, GL_STATIC_DRAW));
-    free(vb_data);
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 18 * vs.size(), vb_data.data(),
+                          GL_STATIC_DRAW));
     GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_triangle_vbo));
     _n_triangles = triangles.size();
     GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * triangles.size(),
                           &triangles[0], GL_STATIC_DRAW));
     GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    _gpu_bytes = int64_t(sizeof(float)) * 18 * vs.size() + int64_t(sizeof(uint32_t)) * triangles.size();
+    memory::gpu_alloc(memory::MESHES, _gpu_bytes);
 }
 
 template <typename GRAPHICS>
@@ -120,6 +64,7 @@ opengl_text<GRAPHICS>::~opengl_text()
 {
     glDeleteBuffers(1, &_vertex_vbo);
     glDeleteBuffers(1, &_triangle_vbo);
+    memory::gpu_free(memory::MESHES, _gpu_bytes);
 }
 
 template <typename GRAPHICS>
@@ -132,6 +77,7 @@ void opengl_text<GRAPHICS>::draw(const graphics_context<GRAPHICS>& ctx,
     shader.enable_vertex_attributes();
     GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_triangle_vbo));
     GL_CHECK(glDrawElements(GL_TRIANGLES, this->_n_triangles, GL_UNSIGNED_INT, (void*)0));
+    ctx.graphics->count_draw_call(this->_n_triangles / 3);
     GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
     shader.disable_all_vertex_attribs();
@@ -0,0 +1,211 @@
+#ifndef BRICKS_OPENGL_OPENGL_TIMER_HH_INCLUDED
+#define BRICKS_OPENGL_OPENGL_TIMER_HH_INCLUDED
+
+#include <GLES3/gl31.h>
+
+#include <cstring>
+#include <vector>
+
+#include "logger.hh"
+#include "utils/profiler.hh"
+
+#ifndef GL_TIMESTAMP_EXT
+#define GL_TIMESTAMP_EXT 0x8E28
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+namespace gdt::graphics::opengl {
+
+/**
+ * Times render passes and pipelines on the GPU for gdt::profiler, using
+ * GL_EXT_disjoint_timer_query, or GL_ARB_timer_query on desktop GL.
+ *
+ * Every zone boundary writes a timestamp query, so zones can nest,
+ * which GL_TIME_ELAPSED queries can't. The results are read back
+ * FRAMES frames later without ever waiting on the GPU: a frame whose
+ * queries aren't done by then is dropped, and so is one the driver
+ * reports as disjoint.
+ */
+class opengl_gpu_timer {
+  public:
+    static const int FRAMES = 4;
+
+    opengl_gpu_timer() = default;
+    ~opengl_gpu_timer()
+    {
+        for (auto &f : _frames) {
+            if (!f.queries.empty()) glDeleteQueries(f.queries.size(), f.queries.data());
+        }
+    }
+    opengl_gpu_timer(const opengl_gpu_timer &) = delete;
+    opengl_gpu_timer &operator=(const opengl_gpu_timer &) = delete;
+
+    /**
+     * Find the timer query entry points, staying off if there are
+     * none.
+     */
+    template <typename PLATFORM>
+    void init(const PLATFORM *p)
+    {
+        if (has_extension("GL_EXT_disjoint_timer_query")) {
+            _query_counter = reinterpret_cast<query_counter_fn>(
+                p->gl_proc_address("glQueryCounterEXT"));
+            _query_result = reinterpret_cast<query_result_fn>(
+                p->gl_proc_address("glGetQueryObjectui64vEXT"));
+            _disjoint = true;
+        } else if (has_extension("GL_ARB_timer_query")) {
+            _query_counter =
+                reinterpret_cast<query_counter_fn>(p->gl_proc_address("glQueryCounter"));
+            _query_result =
+                reinterpret_cast<query_result_fn>(p->gl_proc_address("glGetQueryObjectui64v"));
+        }
+        if (!_query_counter || !_query_result) {
+            LOG_INFO << "no GPU timer queries, render passes won't be timed on the GPU";
+            _query_counter = nullptr;
+            return;
+        }
+        _track = profiler::add_track("gpu");
+        calibrate();
+    }
+
+    void begin_pass(uint32_t site)
+    {
+        if (!_query_counter) return;
+        end_zones();
+        begin(0, site);
+    }
+
+    void begin_pipeline(uint32_t site)
+    {
+        if (!_query_counter) return;
+        end(1);
+        begin(1, site);
+    }
+
+    void end_zones()
+    {
+        if (!_query_counter) return;
+        end(1);
+        end(0);
+    }
+
+    /**
+     * Move on to the next frame, reading back the oldest one.
+     * Called from the backend's update_frame.
+     */
+    void frame()
+    {
+        if (!_query_counter) return;
+        end_zones();
+        _current = (_current + 1) % FRAMES;
+        frame_queries &f = _frames[_current];
+        if (!f.marks.empty()) read(f);
+        f.marks.clear();
+        f.used = 0;
+    }
+
+  private:
+    // core profiles don't have the space separated list of
+    // glGetString(GL_EXTENSIONS), only one string per extension
+    static bool has_extension(const char *name)
+    {
+        GLint n = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for (GLint i = 0; i < n; i++) {
+            const char *ext = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+            if (ext && !strcmp(ext, name)) return true;
+        }
+        return false;
+    }
+
+    using query_counter_fn = void(GL_APIENTRYP)(GLuint id, GLenum target);
+    using query_result_fn = void(GL_APIENTRYP)(GLuint id, GLenum pname, GLuint64 *params);
+
+    static const uint32_t NONE = UINT32_MAX;
+
+    struct mark {
+        uint32_t site;
+        bool begin;
+        GLuint query;
+    };
+
+    struct frame_queries {
+        std::vector<GLuint> queries;
+        size_t used = 0;
+        std::vector<mark> marks;
+    };
+
+    void begin(int level, uint32_t site)
+    {
+        _open[level] = site;
+        _frames[_current].marks.push_back({site, true, timestamp()});
+    }
+
+    void end(int level)
+    {
+        if (_open[level] == NONE) return;
+        _frames[_current].marks.push_back({_open[level], false, timestamp()});
+        _open[level] = NONE;
+    }
+
+    GLuint timestamp()
+    {
+        frame_queries &f = _frames[_current];
+        if (f.used == f.queries.size()) {
+            f.queries.resize(std::max<size_t>(32, f.queries.size() * 2));
+            glGenQueries(f.queries.size() - f.used, &f.queries[f.used]);
+        }
+        GLuint q = f.queries[f.used++];
+        _query_counter(q, GL_TIMESTAMP_EXT);
+        return q;
+    }
+
+    // GPU timestamps run on a clock of their own, offset them onto
+    // profiler::now's
+    void calibrate()
+    {
+        GLint64 gpu = 0;
+        glGetInteger64v(GL_TIMESTAMP_EXT, &gpu);
+        _offset = int64_t(profiler::now()) - gpu;
+    }
+
+    void read(const frame_queries &f)
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(f.marks.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+        if (_disjoint) {
+            GLint disjoint = 0;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+            if (disjoint) {
+                calibrate();
+                return;
+            }
+        }
+        for (const mark &m : f.marks) {
+            GLuint64 t = 0;
+            _query_result(m.query, GL_QUERY_RESULT, &t);
+            uint64_t time = int64_t(t) + _offset;
+            if (m.begin) {
+                profiler::track_begin(_track, m.site, time);
+            } else {
+                profiler::track_end(_track, m.site, time);
+            }
+        }
+    }
+
+    query_counter_fn _query_counter = nullptr;
+    query_result_fn _query_result = nullptr;
+    bool _disjoint = false;
+    uint32_t _track = 0;
+    int64_t _offset = 0;
+    frame_queries _frames[FRAMES];
+    int _current = 0;
+    // the open pass and pipeline zones
+    uint32_t _open[2] = {NONE, NONE};
+};
+}
+
+#endif  // BRICKS_OPENGL_OPENGL_TIMER_HH_INCLUDED
@@ -161,6 +161,10 @@ void backend_for_opengl::update_window()
 {
     SDL_GL_SwapWindow(_mainwindow);
 }
+void* backend_for_opengl::gl_proc_address(const char* name) const
+{
+    return SDL_GL_GetProcAddress(name);
+}
 void backend_for_opengl::imgui_frame() {
    glActiveTexture(GL_TEXTURE0);
    glUseProgram(0);
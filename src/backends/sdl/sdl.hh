@@ -76,6 +76,7 @@ class backend_for_opengl : public platform_is_sdl {
     void update_window() override;
     void on_window_resize(SDL_Event const* event) override;
     void imgui_frame();
+    void* gl_proc_address(const char* name) const override;
 };
 };
 #endif  // GDT_SDL_HEADER_INCLUDED
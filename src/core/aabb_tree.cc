@@ -0,0 +1,492 @@
+#include "aabb_tree.hh"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace gdt {
+
+namespace {
+
+// past this share of the tree moving at once, refitting beats reinserting
+const int REFIT_SHARE = 8;
+
+math::aabb combine(const math::aabb &a, const math::aabb &b)
+{
+    return math::aabb(
+        math::vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+        math::vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+}
+
+float area(const math::aabb &b)
+{
+    float dx = b.max.x - b.min.x;
+    float dy = b.max.y - b.min.y;
+    float dz = b.max.z - b.min.z;
+    return 2 * (dx * dy + dy * dz + dz * dx);
+}
+
+bool encloses(const math::aabb &outer, const math::aabb &inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+           outer.min.z <= inner.min.z && outer.max.x >= inner.max.x &&
+           outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+float distance_sqrd(const math::vec3 &p, const math::aabb &b)
+{
+    float dx = std::max(std::max(b.min.x - p.x, 0.0f), p.x - b.max.x);
+    float dy = std::max(std::max(b.min.y - p.y, 0.0f), p.y - b.max.y);
+    float dz = std::max(std::max(b.min.z - p.z, 0.0f), p.z - b.max.z);
+    return dx * dx + dy * dy + dz * dz;
+}
+}
+
+aabb_tree::aabb_tree(float margin) : _margin(margin)
+{
+}
+
+aabb_tree::~aabb_tree()
+{
+    if (_rebuilding) _jobs->wait(_rebuilt);
+}
+
+math::aabb aabb_tree::fatten(const math::aabb &box) const
+{
+    math::vec3 m(_margin, _margin, _margin);
+    return math::aabb(box.min - m, box.max + m);
+}
+
+int aabb_tree::add(const math::aabb &box, int user)
+{
+    int p;
+    if (!_free_proxies.empty()) {
+        p = _free_proxies.back();
+        _free_proxies.pop_back();
+    } else {
+        p = int(_proxies.size());
+        _proxies.push_back({});
+        _is_touched.push_back(0);
+    }
+    int leaf = allocate_node();
+    _nodes[leaf].box = fatten(box);
+    _nodes[leaf].proxy = p;
+    _proxies[p] = {box, leaf, user};
+    insert_leaf(leaf);
+    _count++;
+    touch(p);
+    return p;
+}
+
+void aabb_tree::remove(int p)
+{
+    int leaf = _proxies[p].node;
+    remove_leaf(leaf);
+    free_node(leaf);
+    _proxies[p].node = NONE;
+    _free_proxies.push_back(p);
+    _count--;
+    touch(p);
+}
+
+bool aabb_tree::move(int p, const math::aabb &box)
+{
+    proxy &px = _proxies[p];
+    px.box = box;
+    int leaf = px.node;
+    if (encloses(_nodes[leaf].box, box)) return false;
+    remove_leaf(leaf);
+    _nodes[leaf].box = fatten(box);
+    insert_leaf(leaf);
+    touch(p);
+    return true;
+}
+
+void aabb_tree::move_instances(const int *proxies, const math::aabb &local,
+                               const math::mat4 *transforms, int count)
+{
+    bool refitting = count * REFIT_SHARE > _count;
+    bool grown = false;
+    for (int i = 0; i < count; i++) {
+        math::aabb box = local.transformed(transforms[i].transpose());
+        if (!refitting) {
+            move(proxies[i], box);
+            continue;
+        }
+        proxy &px = _proxies[proxies[i]];
+        px.box = box;
+        if (encloses(_nodes[px.node].box, box)) continue;
+        grow_leaf(px.node, fatten(box));
+        touch(proxies[i]);
+        grown = true;
+    }
+    if (grown) refit(_root);
+}
+
+// Makes a leaf's box the given one, leaving its ancestors to refit.
+void aabb_tree::grow_leaf(int leaf, const math::aabb &box)
+{
+    _nodes[leaf].box = box;
+    for (int n = _nodes[leaf].parent; n != NONE && !_nodes[n].stale; n = _nodes[n].parent) {
+        _nodes[n].stale = true;
+    }
+}
+
+void aabb_tree::refit(int n)
+{
+    node &nd = _nodes[n];
+    if (!nd.stale) return;
+    refit(nd.child1);
+    refit(nd.child2);
+    // refitting may not reallocate, so nd is still good
+    nd.box = combine(_nodes[nd.child1].box, _nodes[nd.child2].box);
+    nd.stale = false;
+}
+
+int aabb_tree::allocate_node()
+{
+    int n;
+    if (_free != NONE) {
+        n = _free;
+        _free = _nodes[n].parent;
+    } else {
+        n = int(_nodes.size());
+        _nodes.push_back({});
+    }
+    _nodes[n].parent = NONE;
+    _nodes[n].child1 = NONE;
+    _nodes[n].child2 = NONE;
+    _nodes[n].height = 0;
+    _nodes[n].proxy = NONE;
+    _nodes[n].stale = false;
+    return n;
+}
+
+void aabb_tree::free_node(int n)
+{
+    _nodes[n].parent = _free;
+    _nodes[n].height = -1;
+    _free = n;
+}
+
+// Puts the leaf next to the node where it adds the least surface to
+// the tree, then rebalances the way back up.
+void aabb_tree::insert_leaf(int leaf)
+{
+    if (_root == NONE) {
+        _root = leaf;
+        _nodes[leaf].parent = NONE;
+        return;
+    }
+
+    math::aabb box = _nodes[leaf].box;
+    int at = _root;
+    while (!_nodes[at].is_leaf()) {
+        const node &n = _nodes[at];
+        float combined = area(combine(n.box, box));
+        // pairing with this node makes a new parent, descending
+        // grows this node's box for sure
+        float here = 2 * combined;
+        float inherited = 2 * (combined - area(n.box));
+        auto descend = [&](int c) {
+            const node &child = _nodes[c];
+            float grown = area(combine(child.box, box));
+            if (!child.is_leaf()) grown -= area(child.box);
+            return grown + inherited;
+        };
+        float cost1 = descend(n.child1);
+        float cost2 = descend(n.child2);
+        if (here < cost1 && here < cost2) break;
+        at = cost1 < cost2 ? n.child1 : n.child2;
+    }
+
+    int sibling = at;
+    int old_parent = _nodes[sibling].parent;
+    int parent = allocate_node();
+    _nodes[parent].parent = old_parent;
+    _nodes[parent].box = combine(box, _nodes[sibling].box);
+    _nodes[parent].height = _nodes[sibling].height + 1;
+    _nodes[parent].child1 = sibling;
+    _nodes[parent].child2 = leaf;
+    _nodes[sibling].parent = parent;
+    _nodes[leaf].parent = parent;
+    if (old_parent == NONE) {
+        _root = parent;
+    } else if (_nodes[old_parent].child1 == sibling) {
+        _nodes[old_parent].child1 = parent;
+    } else {
+        _nodes[old_parent].child2 = parent;
+    }
+
+    for (int n = _nodes[leaf].parent; n != NONE; n = _nodes[n].parent) {
+        n = balance(n);
+        node &nd = _nodes[n];
+        nd.height = 1 + std::max(_nodes[nd.child1].height, _nodes[nd.child2].height);
+        nd.box = combine(_nodes[nd.child1].box, _nodes[nd.child2].box);
+    }
+}
+
+void aabb_tree::remove_leaf(int leaf)
+{
+    if (leaf == _root) {
+        _root = NONE;
+        return;
+    }
+    int parent = _nodes[leaf].parent;
+    int grandparent = _nodes[parent].parent;
+    int sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+    free_node(parent);
+    if (grandparent == NONE) {
+        _root = sibling;
+        _nodes[sibling].parent = NONE;
+        return;
+    }
+    if (_nodes[grandparent].child1 == parent) {
+        _nodes[grandparent].child1 = sibling;
+    } else {
+        _nodes[grandparent].child2 = sibling;
+    }
+    _nodes[sibling].parent = grandparent;
+    for (int n = grandparent; n != NONE; n = _nodes[n].parent) {
+        n = balance(n);
+        node &nd = _nodes[n];
+        nd.height = 1 + std::max(_nodes[nd.child1].height, _nodes[nd.child2].height);
+        nd.box = combine(_nodes[nd.child1].box, _nodes[nd.child2].box);
+    }
+}
+
+// If one child of a is more than a level taller than the other, rotates
+// it up in place of a, handing its shorter child down to a.
+// Returns the node now where a was.
+int aabb_tree::balance(int a)
+{
+    node &na = _nodes[a];
+    if (na.is_leaf() || na.height < 2) return a;
+    int b = na.child1;
+    int c = na.child2;
+    int tilt = _nodes[c].height - _nodes[b].height;
+    if (tilt > 1 || tilt < -1) {
+        // up is the taller child, stay the other one
+        int up = tilt > 1 ? c : b;
+        int stay = tilt > 1 ? b : c;
+        node &nu = _nodes[up];
+        int f = nu.child1;
+        int g = nu.child2;
+        int taller = _nodes[f].height > _nodes[g].height ? f : g;
+        int shorter = taller == f ? g : f;
+
+        nu.child1 = a;
+        nu.parent = na.parent;
+        na.parent = up;
+        if (nu.parent == NONE) {
+            _root = up;
+        } else if (_nodes[nu.parent].child1 == a) {
+            _nodes[nu.parent].child1 = up;
+        } else {
+            _nodes[nu.parent].child2 = up;
+        }
+
+        nu.child2 = taller;
+        if (up == c) {
+            na.child2 = shorter;
+        } else {
+            na.child1 = shorter;
+        }
+        _nodes[shorter].parent = a;
+        na.box = combine(_nodes[stay].box, _nodes[shorter].box);
+        nu.box = combine(na.box, _nodes[taller].box);
+        na.height = 1 + std::max(_nodes[stay].height, _nodes[shorter].height);
+        nu.height = 1 + std::max(na.height, _nodes[taller].height);
+        return up;
+    }
+    return a;
+}
+
+void aabb_tree::nearest(const math::vec3 &p, int k, std::vector<int> &out) const
+{
+    out.clear();
+    if (_root == NONE || k <= 0) return;
+    // nodes to visit, closest first, and the k best found, farthest first,
+    // both heaps kept between calls
+    auto closer = std::greater<heap_entry>();
+    auto farther = std::less<heap_entry>();
+    _open.clear();
+    _best.clear();
+    _open.push_back({distance_sqrd(p, _nodes[_root].box), _root});
+    while (!_open.empty()) {
+        std::pop_heap(_open.begin(), _open.end(), closer);
+        heap_entry e = _open.back();
+        _open.pop_back();
+        // leaf boxes are grown, so node distances never overestimate
+        if (int(_best.size()) == k && e.first > _best.front().first) break;
+        const node &n = _nodes[e.second];
+        if (n.is_leaf()) {
+            float d = distance_sqrd(p, _proxies[n.proxy].box);
+            if (int(_best.size()) == k) {
+                if (d >= _best.front().first) continue;
+                std::pop_heap(_best.begin(), _best.end(), farther);
+                _best.pop_back();
+            }
+            _best.push_back({d, n.proxy});
+            std::push_heap(_best.begin(), _best.end(), farther);
+        } else {
+            _open.push_back({distance_sqrd(p, _nodes[n.child1].box), n.child1});
+            std::push_heap(_open.begin(), _open.end(), closer);
+            _open.push_back({distance_sqrd(p, _nodes[n.child2].box), n.child2});
+            std::push_heap(_open.begin(), _open.end(), closer);
+        }
+    }
+    std::sort_heap(_best.begin(), _best.end(), farther);
+    out.resize(_best.size());
+    for (size_t i = 0; i < _best.size(); i++) out[i] = _best[i].second;
+}
+
+// The summed surface of the inner boxes, relative to the root's.
+float aabb_tree::cost() const
+{
+    if (_root == NONE || _nodes[_root].is_leaf()) return 0;
+    float sum = 0;
+    for (const node &n : _nodes) {
+        if (n.height > 0) sum += area(n.box);
+    }
+    float root = area(_nodes[_root].box);
+    return root > 0 ? sum / root : 0;
+}
+
+float aabb_tree::quality() const
+{
+    return _built_cost > 0 ? cost() / _built_cost : 1;
+}
+
+void aabb_tree::touch(int p)
+{
+    if (!_rebuilding || _is_touched[p]) return;
+    _is_touched[p] = 1;
+    _touched.push_back(p);
+}
+
+void aabb_tree::snapshot()
+{
+    _snapshot.clear();
+    for (const node &n : _nodes) {
+        if (n.height == 0) _snapshot.push_back({n.box, n.box.center(), n.proxy});
+    }
+}
+
+// Builds the tree top down, splitting the leaves at the median along
+// the longest axis of their centers. The root ends up first.
+int aabb_tree::build(array<leaf_entry> &leaves, int first, int last, int parent, array<node> &out)
+{
+    int n = int(out.size());
+    out.push_back({});
+    out[n].parent = parent;
+    out[n].stale = false;
+    if (last - first == 1) {
+        out[n].box = leaves[first].box;
+        out[n].child1 = NONE;
+        out[n].child2 = NONE;
+        out[n].height = 0;
+        out[n].proxy = leaves[first].proxy;
+        return n;
+    }
+    math::vec3 lo = leaves[first].center;
+    math::vec3 hi = lo;
+    for (int i = first + 1; i < last; i++) {
+        const math::vec3 &c = leaves[i].center;
+        lo = math::vec3(std::min(lo.x, c.x), std::min(lo.y, c.y), std::min(lo.z, c.z));
+        hi = math::vec3(std::max(hi.x, c.x), std::max(hi.y, c.y), std::max(hi.z, c.z));
+    }
+    math::vec3 e = hi - lo;
+    int axis = e.x >= e.y && e.x >= e.z ? 0 : (e.y >= e.z ? 1 : 2);
+    int mid = (first + last) / 2;
+    std::nth_element(leaves.begin() + first, leaves.begin() + mid, leaves.begin() + last,
+                     [axis](const leaf_entry &a, const leaf_entry &b) {
+                         return (&a.center.x)[axis] < (&b.center.x)[axis];
+                     });
+    int child1 = build(leaves, first, mid, n, out);
+    int child2 = build(leaves, mid, last, n, out);
+    out[n].child1 = child1;
+    out[n].child2 = child2;
+    out[n].box = combine(out[child1].box, out[child2].box);
+    out[n].height = 1 + std::max(out[child1].height, out[child2].height);
+    out[n].proxy = NONE;
+    return n;
+}
+
+// Swaps the rebuilt tree in, then brings what changed since the
+// snapshot over from the old one.
+void aabb_tree::finish_rebuild()
+{
+    _rebuilding = false;
+    std::vector<uint8_t> alive(_proxies.size());
+    for (size_t p = 0; p < _proxies.size(); p++) alive[p] = _proxies[p].node != NONE;
+
+    _nodes.swap(_next);
+    _next.clear();
+    _root = _nodes.empty() ? NONE : 0;
+    _free = NONE;
+    for (proxy &px : _proxies) px.node = NONE;
+    for (int n = 0; n < int(_nodes.size()); n++) {
+        if (_nodes[n].is_leaf()) _proxies[_nodes[n].proxy].node = n;
+    }
+
+    for (int p : _touched) {
+        _is_touched[p] = 0;
+        int leaf = _proxies[p].node;
+        if (leaf != NONE) {
+            remove_leaf(leaf);
+            free_node(leaf);
+            _proxies[p].node = NONE;
+        }
+        if (!alive[p]) continue;
+        leaf = allocate_node();
+        _nodes[leaf].box = fatten(_proxies[p].box);
+        _nodes[leaf].proxy = p;
+        _proxies[p].node = leaf;
+        insert_leaf(leaf);
+    }
+    _touched.clear();
+    _built_cost = cost();
+}
+
+void aabb_tree::rebuild()
+{
+    if (_rebuilding) {
+        _jobs->wait(_rebuilt);
+        finish_rebuild();
+    }
+    snapshot();
+    _next.clear();
+    if (!_snapshot.empty()) {
+        _next.reserve(_snapshot.size() * 2 - 1);
+        build(_snapshot, 0, int(_snapshot.size()), NONE, _next);
+    }
+    finish_rebuild();
+}
+
+void aabb_tree::maintain(job_system *jobs, float threshold)
+{
+    if (_rebuilding) {
+        if (_rebuilt.is_done()) finish_rebuild();
+        return;
+    }
+    if (_count < 2) return;
+    if (_built_cost == 0) {
+        _built_cost = cost();
+        return;
+    }
+    if (quality() < threshold) return;
+    if (!jobs) {
+        rebuild();
+        return;
+    }
+    snapshot();
+    _rebuilding = true;
+    _jobs = jobs;
+    jobs->run(_rebuilt, [this]() {
+        _next.clear();
+        _next.reserve(_snapshot.size() * 2 - 1);
+        build(_snapshot, 0, int(_snapshot.size()), NONE, _next);
+    });
+}
+}
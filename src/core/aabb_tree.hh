@@ -0,0 +1,361 @@
+#ifndef GDT_AABB_TREE_HEADER_INCLUDED
+#define GDT_AABB_TREE_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "bounds.hh"
+#include "jobs.hh"
+#include "math.hh"
+#include "utils/memory.hh"
+
+namespace gdt {
+
+/**
+ * A dynamic bounding volume tree over the boxes of things in a scene,
+ * for picking, culling and proximity queries that would otherwise test
+ * every instance.
+ *
+ * Every box added gets a proxy, an id to move and remove it by, and
+ * carries a user value, like the index of the instance it bounds:
+ *
+ *     gdt::aabb_tree _tree;
+ *     ...
+ *     int p = _tree.add(bounds.transformed(transform), i);
+ *     ...
+ *     _tree.move(p, bounds.transformed(transform));
+ *     ...
+ *     _tree.query(math::frustum(proj * view), [&](int proxy) {
+ *         _visible.push_back(_tree.user(proxy));
+ *     });
+ *
+ * Leaves hold their box grown by a margin, so something moving a little
+ * stays in its leaf and the tree doesn't change. Moving further out
+ * reinserts the leaf where it adds the least area, and rotations keep
+ * the tree balanced.
+ *
+ * Moving many boxes at once, see move_instances, grows their leaves in
+ * place and refits the tree in a single pass instead. That's cheaper,
+ * but the tree gets looser. maintain, called once a frame, watches the
+ * tree's quality and rebuilds it from scratch once it gets too loose,
+ * on the job system while the old tree is still being used.
+ */
+class aabb_tree {
+  public:
+    static constexpr int NONE = -1;
+
+    /**
+     * @param margin how much leaf boxes are grown on every side
+     */
+    explicit aabb_tree(float margin = 0.1f);
+    ~aabb_tree();
+    aabb_tree(const aabb_tree &) = delete;
+    aabb_tree &operator=(const aabb_tree &) = delete;
+
+    /**
+     * Add a box.
+     *
+     * @param user any value identifying the box, see user
+     * @return the box's proxy
+     */
+    int add(const math::aabb &box, int user = 0);
+
+    void remove(int proxy);
+
+    /**
+     * Change a proxy's box.
+     *
+     * @return true if the leaf had to be reinserted
+     */
+    bool move(int proxy, const math::aabb &box);
+
+    /**
+     * Move the boxes of count instances, local transformed by every
+     * instance transform, stored transposed the way instances keep
+     * them. proxies[i] is the proxy of transforms[i]. Goes well with
+     * the spans gdt::soa_transforms composes:
+     *
+     *     _soa.compose(_rocks.begin());
+     *     for (auto &r : _soa.upload_ranges()) {
+     *         _tree.move_instances(&_proxies[r.first], _rock_bounds,
+     *                              _rocks.begin() + r.first, r.count);
+     *     }
+     */
+    void move_instances(const int *proxies, const math::aabb &local,
+                        const math::mat4 *transforms, int count);
+
+    int user(int proxy) const
+    {
+        return _proxies[proxy].user;
+    }
+
+    /** The proxy's box, as last added or moved. */
+    const math::aabb &bounds(int proxy) const
+    {
+        return _proxies[proxy].box;
+    }
+
+    /** The number of proxies. */
+    int size() const
+    {
+        return _count;
+    }
+
+    /** Call f(proxy) for every box overlapping box. */
+    template <typename F>
+    void query(const math::aabb &box, F &&f) const;
+
+    /** Call f(proxy) for every box overlapping s. */
+    template <typename F>
+    void query(const math::sphere &s, F &&f) const;
+
+    /**
+     * Call f(proxy) for every box inside or crossing fr. Whole subtrees
+     * inside the frustum are reported without further tests.
+     */
+    template <typename F>
+    void query(const math::frustum &fr, F &&f) const;
+
+    /**
+     * Call f(proxy, t) for every box r hits within max_t, t being the
+     * distance it enters the box at. f returns the distance to keep
+     * looking within: t for the closest hit only, max_t for all of
+     * them, 0 to stop.
+     */
+    template <typename F>
+    void raycast(const math::ray &r, float max_t, F &&f) const;
+
+    /**
+     * The k proxies closest to p, closest first. Unlike the queries, it
+     * keeps its search heaps in the tree, so don't call it from two
+     * threads at once.
+     */
+    void nearest(const math::vec3 &p, int k, std::vector<int> &out) const;
+
+    /**
+     * How much looser the tree is than right after it was last built,
+     * comparing the summed surface of its inner boxes.
+     */
+    float quality() const;
+
+    /** Rebuild the tree from scratch, now. */
+    void rebuild();
+
+    /**
+     * Call once a frame. Swaps in a tree rebuilt in the background once
+     * it's done, or starts rebuilding when quality gets worse than
+     * threshold. Without a job system, rebuilds right away.
+     */
+    void maintain(job_system *jobs, float threshold = 1.5f);
+
+  private:
+    template <typename T>
+    using array = std::vector<T, tagged_allocator<T, memory::INSTANCES>>;
+
+    struct node {
+        math::aabb box;
+        // the next free node for free ones
+        int parent;
+        int child1;
+        int child2;
+        // 0 for leaves
+        int height;
+        int proxy;
+        // the box needs refitting to its children
+        bool stale;
+
+        bool is_leaf() const
+        {
+            return child1 == NONE;
+        }
+    };
+
+    struct proxy {
+        math::aabb box;
+        int node;
+        int user;
+    };
+
+    struct leaf_entry {
+        math::aabb box;
+        math::vec3 center;
+        int proxy;
+    };
+
+    // depth first traversal, without allocating for trees of sane depth
+    class node_stack {
+      public:
+        void push(int n)
+        {
+            if (_size < INLINE) {
+                _inline[_size] = n;
+            } else {
+                _more.push_back(n);
+            }
+            _size++;
+        }
+
+        int pop()
+        {
+            _size--;
+            if (_size < INLINE) return _inline[_size];
+            int n = _more.back();
+            _more.pop_back();
+            return n;
+        }
+
+        bool empty() const
+        {
+            return _size == 0;
+        }
+
+      private:
+        static constexpr int INLINE = 128;
+        int _inline[INLINE];
+        std::vector<int> _more;
+        int _size = 0;
+    };
+
+    math::aabb fatten(const math::aabb &box) const;
+    int allocate_node();
+    void free_node(int n);
+    void insert_leaf(int leaf);
+    void remove_leaf(int leaf);
+    int balance(int a);
+    void grow_leaf(int leaf, const math::aabb &box);
+    void refit(int n);
+    float cost() const;
+    void touch(int proxy);
+    void snapshot();
+    void finish_rebuild();
+    static int build(array<leaf_entry> &leaves, int first, int last, int parent,
+                     array<node> &out);
+
+    float _margin;
+    array<node> _nodes;
+    int _root = NONE;
+    int _free = NONE;
+    std::vector<proxy> _proxies;
+    std::vector<int> _free_proxies;
+    int _count = 0;
+    float _built_cost = 0;
+
+    // the background rebuild, working on the snapshot only
+    job_system *_jobs = nullptr;
+    job_counter _rebuilt;
+    bool _rebuilding = false;
+    array<leaf_entry> _snapshot;
+    array<node> _next;
+    // proxies added, removed or reinserted since the snapshot
+    std::vector<int> _touched;
+    std::vector<uint8_t> _is_touched;
+
+    // scratch for nearest
+    using heap_entry = std::pair<float, int>;
+    mutable array<heap_entry> _open;
+    mutable array<heap_entry> _best;
+};
+
+//------------------------------------------------------------------------------------------------
+// IMPLEMENTATIONS
+//------------------------------------------------------------------------------------------------
+
+template <typename F>
+void aabb_tree::query(const math::aabb &box, F &&f) const
+{
+    if (_root == NONE) return;
+    node_stack stack;
+    stack.push(_root);
+    while (!stack.empty()) {
+        const node &n = _nodes[stack.pop()];
+        if (!n.box.overlaps(box)) continue;
+        if (n.is_leaf()) {
+            if (_proxies[n.proxy].box.overlaps(box)) f(n.proxy);
+        } else {
+            stack.push(n.child1);
+            stack.push(n.child2);
+        }
+    }
+}
+
+template <typename F>
+void aabb_tree::query(const math::sphere &s, F &&f) const
+{
+    if (_root == NONE) return;
+    node_stack stack;
+    stack.push(_root);
+    while (!stack.empty()) {
+        const node &n = _nodes[stack.pop()];
+        if (!s.overlaps(n.box)) continue;
+        if (n.is_leaf()) {
+            if (s.overlaps(_proxies[n.proxy].box)) f(n.proxy);
+        } else {
+            stack.push(n.child1);
+            stack.push(n.child2);
+        }
+    }
+}
+
+template <typename F>
+void aabb_tree::query(const math::frustum &fr, F &&f) const
+{
+    if (_root == NONE) return;
+    // Test a box against the planes left in mask. Returns -1 if it's
+    // outside, or the planes it crosses, 0 when it's all inside.
+    auto classify = [&fr](const math::aabb &box, int mask) {
+        math::vec3 c = box.center();
+        math::vec3 e = box.extents();
+        int crossed = 0;
+        for (int p = 0; p < math::frustum::PLANES; p++) {
+            if (!(mask & (1 << p))) continue;
+            const math::plane &pl = fr.planes[p];
+            float r = fabsf(pl.n.x) * e.x + fabsf(pl.n.y) * e.y + fabsf(pl.n.z) * e.z;
+            float d = pl.distance(c);
+            if (d < -r) return -1;
+            if (d < r) crossed |= 1 << p;
+        }
+        return crossed;
+    };
+    node_stack stack;
+    stack.push(_root);
+    stack.push((1 << math::frustum::PLANES) - 1);
+    while (!stack.empty()) {
+        int mask = stack.pop();
+        const node &n = _nodes[stack.pop()];
+        if (mask) {
+            mask = classify(n.box, mask);
+            if (mask < 0) continue;
+        }
+        if (n.is_leaf()) {
+            if (!mask || classify(_proxies[n.proxy].box, mask) >= 0) f(n.proxy);
+        } else {
+            stack.push(n.child1);
+            stack.push(mask);
+            stack.push(n.child2);
+            stack.push(mask);
+        }
+    }
+}
+
+template <typename F>
+void aabb_tree::raycast(const math::ray &r, float max_t, F &&f) const
+{
+    if (_root == NONE) return;
+    node_stack stack;
+    stack.push(_root);
+    while (!stack.empty() && max_t > 0) {
+        const node &n = _nodes[stack.pop()];
+        float t;
+        if (!r.intersects(n.box, &t) || t > max_t) continue;
+        if (n.is_leaf()) {
+            if (r.intersects(_proxies[n.proxy].box, &t) && t <= max_t) max_t = f(n.proxy, t);
+        } else {
+            stack.push(n.child1);
+            stack.push(n.child2);
+        }
+    }
+}
+}
+
+#endif  // GDT_AABB_TREE_HEADER_INCLUDED
@@ -9,6 +9,7 @@
 #include <vector>
 #include <cmath>
 
+#include "arena.hh"
 #include "traits.hh"
 #include "math.hh"
 #include "context.hh"
@@ -24,13 +25,20 @@ struct skeleton;
  * Frames hold bone information for the full set of bones in a skeleton.
  * Frames have to be "baked" before they can be used in the rendering pipeline.
  * Baking will convert the raw bones data into bone transformation matrices.
+ *
+ * gdt::frame keeps its bones on the heap, gdt::transient_frame in the
+ * frame arena, for poses computed and thrown away during a frame.
  */
-struct frame {
-    std::vector<int> bone_parents;
-    std::vector<gdt::math::vec3> bone_positions;
-    std::vector<gdt::math::quat> bone_rotations;
-    std::vector<gdt::math::mat4> bone_transforms;
-    std::vector<gdt::math::mat4> bone_inv_transforms;
+template <template <typename> class ALLOCATOR>
+struct basic_frame {
+    template <typename T>
+    using array = std::vector<T, ALLOCATOR<T>>;
+
+    array<int> bone_parents;
+    array<gdt::math::vec3> bone_positions;
+    array<gdt::math::quat> bone_rotations;
+    array<gdt::math::mat4> bone_transforms;
+    array<gdt::math::mat4> bone_inv_transforms;
     bool baked = false;
 
     gdt::math::mat4 bone_transform(int i)
@@ -53,6 +61,8 @@ struct frame {
         int bones = bone_parents.size();
         this->bone_transforms.clear();
         this->bone_inv_transforms.clear();
+        this->bone_transforms.reserve(bones);
+        this->bone_inv_transforms.reserve(bones);
         for (int i = 0; i < bones; i++) {
             gdt::math::mat4 t = this->bone_transform(i);
             this->bone_transforms.push_back(t);
@@ -62,6 +72,9 @@ struct frame {
     }
 };
 
+using frame = basic_frame<std::allocator>;
+using transient_frame = basic_frame<frame_allocator>;
+
 /**
  * The bone structure holds the name and parent id of a single bone in a
  * skeleton.
@@ -87,6 +100,19 @@ struct skeleton {
     {
         return bones.size();
     }
+
+    /**
+     * The index of the bone called name, or -1. Names read from SMD
+     * files keep their quotes, name matches with or without them.
+     */
+    int find_bone(const std::string& name) const
+    {
+        std::string quoted = "\"" + name + "\"";
+        for (int i = 0; i < n_bones(); i++) {
+            if (bones[i].name == name || bones[i].name == quoted) return i;
+        }
+        return -1;
+    }
 };
 
 /**
@@ -120,35 +146,71 @@ class animation {
     static frame interpolate(const frame& f0, const frame& f1, float amount)
     {
         frame interpolated;
-        interpolated.bone_parents = f0.bone_parents;
+        interpolate(f0, f1, amount, interpolated);
+        return interpolated;
+    }
+
+    /**
+     * Blend f0 into f1 and bake the result into out, reusing out's
+     * storage.
+     */
+    template <typename F0, typename F1, typename OUT>
+    static void interpolate(const F0& f0, const F1& f1, float amount, OUT& out)
+    {
         int nbones = f0.bone_positions.size();
+        out.bone_parents.assign(f0.bone_parents.begin(), f0.bone_parents.end());
+        out.bone_positions.clear();
+        out.bone_rotations.clear();
+        out.bone_positions.reserve(nbones);
+        out.bone_rotations.reserve(nbones);
         for (int i = 0; i < nbones; i++) {
-            interpolated.bone_positions.push_back(
+            out.bone_positions.push_back(
                 gdt::math::vec3::lerp(f0.bone_positions[i], f1.bone_positions[i], amount));
-            interpolated.bone_rotations.push_back(
+            out.bone_rotations.push_back(
                 gdt::math::quat::slerp(f0.bone_rotations[i], f1.bone_rotations[i], amount));
         }
-        interpolated.bake_transforms();
-        return interpolated;
+        out.bake_transforms();
     }
 
     frame current_frame() const
+    {
+        frame f;
+        current_frame(f);
+        return f;
+    }
+
+    /**
+     * Compute the current pose into out, which can be a
+     * gdt::transient_frame to keep it off the heap.
+     */
+    template <typename OUT>
+    void current_frame(OUT& out) const
     {
         float frame_time = 1.0 / 24;
-        if (_loop == false && animation_time > frame_time * (_frames.size() - 1))
-            return _frames[_frames.size() - 1];
+        if (_loop == false && animation_time > frame_time * (_frames.size() - 1)) {
+            const frame& last = _frames[_frames.size() - 1];
+            out.bone_parents.assign(last.bone_parents.begin(), last.bone_parents.end());
+            out.bone_positions.assign(last.bone_positions.begin(), last.bone_positions.end());
+            out.bone_rotations.assign(last.bone_rotations.begin(), last.bone_rotations.end());
+            out.bone_transforms.assign(last.bone_transforms.begin(), last.bone_transforms.end());
+            out.bone_inv_transforms.assign(last.bone_inv_transforms.begin(),
+                                           last.bone_inv_transforms.end());
+            out.baked = last.baked;
+            return;
+        }
         float time = std::fmod(animation_time, frame_time * (_frames.size() - 1));
         float amount = std::fmod(time / frame_time, 1.0);
         const frame& f0 = _frames[time / frame_time + 0];
         const frame& f1 = _frames[time / frame_time + 1];
 
-        return animation::interpolate(f0, f1, amount);
+        animation::interpolate(f0, f1, amount, out);
     }
 
     template <typename SHADER>
     void bind(const SHADER& s) const
     {
-        frame frame = current_frame();
+        transient_frame frame;
+        current_frame(frame);
         gdt::math::mat4 bone_matrices[64];
         gdt::math::vec4 quat_reals[64];
         gdt::math::vec4 quat_duals[64];
@@ -223,16 +285,29 @@ class animixer {
         }
     }
 
-    template <typename SHADER>
-    void bind(const SHADER& s) const
+    /**
+     * Compute the current blend of the playing animations into out.
+     * Its bone_transforms hold every bone's transform in model space,
+     * which is what gdt::transform_hierarchy::attach follows.
+     */
+    void pose(transient_frame& out) const
     {
         if (_strips.begin() == _strips.end())
             throw std::runtime_error("no animations in animixer");
-        frame frame = _strips.begin()->a->current_frame();
+        transient_frame next, blended;
+        _strips.begin()->a->current_frame(out);
         for (auto i = _strips.cbegin() + 1; i != _strips.end(); i++) {
-            frame =
-                animation::interpolate(frame, i->a->current_frame(), i->elapsed / i->duration);
+            i->a->current_frame(next);
+            animation::interpolate(out, next, i->elapsed / i->duration, blended);
+            std::swap(out, blended);
         }
+    }
+
+    template <typename SHADER>
+    void bind(const SHADER& s) const
+    {
+        transient_frame frame;
+        pose(frame);
         gdt::math::mat4 bone_matrices[64];
         gdt::math::vec4 quat_reals[64];
         gdt::math::vec4 quat_duals[64];
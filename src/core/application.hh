@@ -2,22 +2,30 @@
 #define GDT_APPLICATION_HEADER_INCLUDED
 
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <random>
+#include <thread>
 #include <vector>
 
 #include "backends/blueprints/audio.hh"
 #include "backends/blueprints/platform.hh"
 #include "backends/blueprints/physics.hh"
 
+#include "core/arena.hh"
 #include "core/camera.hh"
 #include "core/drawable.hh"
 #include "core/drivers.hh"
 #include "core/font.hh"
+#include "core/jobs.hh"
+#include "core/render_queue.hh"
 #include "core/renderer.hh"
+#include "core/replay.hh"
 #include "core/physics.hh"
 #include "core/shaders.hh"
 #include "core/scene.hh"
+#include "core/scene_loader.hh"
 #include "core/text.hh"
 
 #include "imgui/imgui_gdt.hh"
@@ -238,6 +246,11 @@ class application {
     template <typename RENDERER>
     using renderer = gdt::renderer<graphics, RENDERER>;
 
+    /**
+     * Collects draws and issues them sorted by pipeline and material.
+     */
+    using render_queue = gdt::render_queue<graphics>;
+
     // PHYSICS
 
     /**
@@ -309,7 +322,7 @@ class application {
      */
     using empty_scene = gdt::empty_scene<context>;
 
-    application() : _graphics(&_platform, &_platform._screen)
+    application() : _arena(&_jobs), _graphics(&_platform, &_platform._screen), _scenes(&_jobs, &_ctx)
     {
         LOG_DEBUG << "application setup";
         _platform.on_resize_callback = [this](int w, int h) {
@@ -319,12 +332,20 @@ class application {
             // the command buffers need to be rebuilt as well.
             _active_scene->on_screen_resize(this->_ctx);
         };
-        _platform.on_key_callback = [this](int k) { this->on_key(k); };
+        _platform.on_key_callback = [this](int k) {
+            // a replay only gets the keys pressed while recording
+            if (_input.mode() == input_recorder::REPLAYING) return;
+            if (_input.mode() == input_recorder::RECORDING) _input.key_event(k);
+            key_event(k);
+        };
         _ctx.quit = [this]() { this->quit(); };
         _ctx.p = &_platform;
         _ctx.graphics = &_graphics;
         _ctx.physics = &_physics;
         _ctx.audio = &_audio;
+        _ctx.jobs = &_jobs;
+        _ctx.scenes = &_scenes;
+        _ctx.arena = &_arena;
         set_imgui_style();
     }
 
@@ -357,44 +378,237 @@ class application {
     int run()
     {
         LOG_DEBUG << "application run initiated";
-        _active_scene = std::make_unique<FIRST_SCENE>(_ctx, &_platform._screen);
+        if (_input.mode() != input_recorder::OFF) srand(_input.seed());
+        {
+            memory::scope tag(memory::GAME);
+            _active_scene = std::make_unique<FIRST_SCENE>(_ctx, &_platform._screen);
+        }
         std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
         start = std::chrono::high_resolution_clock::now();
         _ctx.elapsed = 0;
+        _accumulator = 0;
+        profiler::set_thread_name("main");
         while (_platform.process_events() && !_quit) {
-            _ctx.measure("core updates").begin();
-            _graphics.update_frame();
-            _platform.update_window();
-            _platform.update_keyboard();
-            _platform.update_mouse();
-            _ctx.measure("core updates").end();
-            this->update(_ctx);
+            {
+                PROFILE_SCOPE("frame");
+                _arena.begin_frame();
+                {
+                    PROFILE_SCOPE("core updates");
+                    _graphics.update_frame();
+                    _platform.update_window();
+                    _platform.update_keyboard();
+                    _platform.update_mouse();
+                    if (!update_input()) break;
+                }
+                if (auto next = _scenes.update(&_platform._screen)) {
+                    _active_scene = std::move(next);
+                }
+                this->update(_ctx);
+            }
+            PROFILE_COUNTER("draw calls", _graphics.draw_calls());
+            PROFILE_COUNTER("triangles", _graphics.triangles());
+            PROFILE_COUNTER("visible instances", _graphics.visible_instances());
+            PROFILE_COUNTER("culled instances", _graphics.culled_instances());
+            {
+                memory::scope tag(memory::DEBUG);
+                profiler::frame();
+            }
+            memory::frame();
             end = std::chrono::high_resolution_clock::now();
             auto ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
             float x = ms.count() / 1000000.0f;
+            if (_platform.replayed) {
+                _input.frame_time(x);
+                // play back in real time unless asked to hurry
+                if (!_input.fast() && x < _platform.replayed->elapsed) {
+                    std::this_thread::sleep_for(
+                        std::chrono::duration<float>(_platform.replayed->elapsed - x));
+                }
+            }
             _ctx.elapsed = x;
             start = std::chrono::high_resolution_clock::now();
         }
+        _input.finish();
+        _platform.replayed = nullptr;
         LOG_DEBUG << "application run ended";
         return 0;
     }
 
+    /**
+     * Switch to fixed update mode, where the simulation advances in
+     * steps of exactly 1 / rate seconds no matter what the frame rate is.
+     * Each frame, the active scene gets as many gdt::scene::fixed_update
+     * calls as the elapsed time covers, followed by a single
+     * gdt::scene::update with an interpolation factor for rendering:
+     *
+     *     auto app = std::make_unique<my_app>();
+     *     app->set_fixed_update(60);
+     *     app->run<my_scene>();
+     *
+     * To keep a slow frame from snowballing into ever more steps,
+     * at most max_steps are taken per frame and any time left beyond
+     * that is dropped; the simulation slows down instead.
+     *
+     * @param rate simulation steps per second, 0 to go back to variable updates
+     * @param max_steps most fixed updates to run in a single frame
+     */
+    void set_fixed_update(float rate, int max_steps = 5)
+    {
+        _ctx.fixed_step = rate > 0 ? 1.0f / rate : 0;
+        _max_steps = max_steps;
+        _accumulator = 0;
+    }
+
+    /**
+     * Write the last captured frames as a Chrome trace, see gdt::profiler.
+     * If capturing isn't on yet, this turns it on with a 120 frames window
+     * and the next call writes the trace.
+     */
+    void capture_trace(const std::string& path = "gdt_trace.json")
+    {
+        if (profiler::capture_frames() == 0) {
+            LOG_WARNING << "trace capture wasn't on, capturing from now on";
+            profiler::set_capture(120);
+            return;
+        }
+        profiler::write_trace(path);
+    }
+
+    /**
+     * Capture a trace of the last frames whenever key is pressed.
+     * The key is the platform's key code, the same one on_key gets.
+     *
+     *     app->set_trace_key(SDLK_F12);
+     *
+     * @param frames number of frames each trace covers
+     * @param hitch_ms also write a trace when a frame takes longer than this, 0 for never
+     */
+    void set_trace_key(int key, const std::string& path = "gdt_trace.json", int frames = 120,
+                       float hitch_ms = 0)
+    {
+        _trace_key = key;
+        _trace_path = path;
+        profiler::set_capture(frames);
+        profiler::set_capture_threshold(hitch_ms, path);
+    }
+
+    /**
+     * Record this run into path: the elapsed time of every frame, the
+     * keyboard and mouse state and the key presses. The C random
+     * generator is seeded with seed before the first scene is created,
+     * and the seed is kept in the recording too. Call before run.
+     *
+     * @param seed seed for srand, 0 for a random one
+     */
+    void record_input(const std::string& path = "gdt_input.rec", uint32_t seed = 0)
+    {
+        if (seed == 0) seed = std::random_device()();
+        _input.record(path, seed);
+    }
+
+    /**
+     * Play back a run recorded with record_input instead of taking
+     * input from the platform. Every frame gets the recorded elapsed
+     * time and input, so the scene goes through exactly the same
+     * updates, and the application quits when the recording runs out,
+     * logging statistics of the actual frame times:
+     *
+     *     auto app = std::make_unique<my_app>();
+     *     app->replay_input("level1.rec", true, "level1_frames.csv");
+     *     app->run<level1_scene>();
+     *
+     * Throws if the recording can't be read. Call before run.
+     *
+     * @param fast run frames back to back instead of at the recorded pace
+     * @param stats_path also write every frame's time, in ms, to this CSV file
+     */
+    void replay_input(const std::string& path, bool fast = true,
+                      const std::string& stats_path = "")
+    {
+        _input.replay(path, fast, stats_path);
+    }
+
+    /**
+     * The platform backend, for setting it up before run, like
+     * scripting the input of gdt::platform::headless::backend.
+     */
+    platform& get_platform()
+    {
+        return _platform;
+    }
+
   private: 
     virtual void update(const context& _ctx)
     {
         clear_frame();
-        _active_scene.get()->update(_ctx);
-        _ctx.measure("core imgui").begin();
+        {
+            memory::scope tag(memory::GAME);
+            if (_ctx.fixed_step > 0) {
+                fixed_update();
+            } else {
+                PROFILE_SCOPE("scene update");
+                _active_scene.get()->update(_ctx);
+            }
+        }
+        _graphics.end_gpu_zones();
+        PROFILE_SCOPE("core imgui");
+        memory::scope tag(memory::DEBUG);
         _ctx.p->imgui_frame();
         _active_scene.get()->imgui(_ctx);
         ImGui::Render();
-        _ctx.measure("core imgui").end();
     }
 
     virtual void on_key(int k)
     {
     }
 
+    void key_event(int k)
+    {
+        if (_trace_key != 0 && k == _trace_key) capture_trace(_trace_path);
+        this->on_key(k);
+    }
+
+    // record the frame's input, or replace it with the recorded one,
+    // false once there's nothing left to replay
+    bool update_input()
+    {
+        if (_input.mode() == input_recorder::RECORDING) {
+            int x, y;
+            _platform.get_mouse(&x, &y);
+            _input.record_frame(_ctx.elapsed, _platform.key_bits(), x, y,
+                                _platform.is_button_pressed());
+        } else if (_input.mode() == input_recorder::REPLAYING) {
+            _platform.replayed = _input.next_frame();
+            if (!_platform.replayed) return false;
+            _ctx.elapsed = _platform.replayed->elapsed;
+            const int32_t* keys = _input.key_events(*_platform.replayed);
+            for (uint32_t i = 0; i < _platform.replayed->key_events; i++) key_event(keys[i]);
+        }
+        return true;
+    }
+
+    void fixed_update()
+    {
+        float frame = _ctx.elapsed;
+        float step = _ctx.fixed_step;
+        _accumulator += frame;
+        int steps = 0;
+        _ctx.elapsed = step;
+        while (_accumulator >= step && steps < _max_steps) {
+            PROFILE_SCOPE("fixed update");
+            _active_scene.get()->fixed_update(_ctx);
+            _accumulator -= step;
+            steps++;
+        }
+        if (_accumulator >= step) {
+            LOG_DEBUG << "dropping " << int(_accumulator / step) << " fixed updates";
+            _accumulator = fmodf(_accumulator, step);
+        }
+        _ctx.elapsed = frame;
+        PROFILE_SCOPE("scene update");
+        _active_scene.get()->update(_ctx, _accumulator / step);
+    }
+
     void quit()
     {
         _quit = true;
@@ -406,13 +620,24 @@ class application {
     }
 
   private:
-    platform _platform;
+    // declared first so it's destroyed last, joining its workers only
+    // after everything they could be working on is gone
+    job_system _jobs;
+    frame_arena _arena;
+    replayable<platform> _platform;
     graphics _graphics;
     audio _audio;
     physics _physics;
     context _ctx;
     std::unique_ptr<scene> _active_scene;
+    // after the active scene, so a half loaded one goes first
+    scene_loader_for<context> _scenes;
     bool _quit = false;
+    float _accumulator = 0;
+    int _max_steps = 5;
+    int _trace_key = 0;
+    std::string _trace_path;
+    input_recorder _input;
 
 };
 }
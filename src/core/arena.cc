@@ -0,0 +1,90 @@
+#include "arena.hh"
+
+#include <algorithm>
+
+#include "jobs.hh"
+#include "logger.hh"
+
+namespace gdt {
+
+// the application's frame_arena, for frame_allocator
+static frame_arena* active_arena = nullptr;
+
+linear_arena::linear_arena(size_t block_size) : _block_size(block_size)
+{
+}
+
+void* linear_arena::grow(size_t bytes, size_t align)
+{
+    if (!_blocks.empty()) _used_before += _top - _blocks.back().get();
+    size_t size = std::max({_block_size, _capacity, bytes + align});
+    _blocks.emplace_back(new char[size]);
+    _capacity += size;
+    _top = _blocks.back().get();
+    _end = _top + size;
+    return allocate(bytes, align);
+}
+
+void linear_arena::reset()
+{
+    if (_blocks.size() > 1) {
+        // one block big enough for all of it next time
+        _blocks.clear();
+        _blocks.emplace_back(new char[_capacity]);
+    }
+    _used_before = 0;
+    if (_blocks.empty()) return;
+    _top = _blocks.back().get();
+    _end = _top + _capacity;
+}
+
+size_t linear_arena::used() const
+{
+    if (_blocks.empty()) return 0;
+    return _used_before + (_top - _blocks.back().get());
+}
+
+frame_arena::frame_arena(job_system* jobs, size_t block_size) : _jobs(jobs)
+{
+    int threads = 1 + (jobs ? jobs->workers() : 0);
+    for (int i = 0; i < threads; i++) {
+        _slots.push_back(std::make_unique<slot>(block_size));
+    }
+    if (active_arena) {
+        LOG_WARNING << "another frame_arena is active, frame_allocator keeps using it";
+    } else {
+        active_arena = this;
+    }
+}
+
+frame_arena::~frame_arena()
+{
+    if (active_arena == this) active_arena = nullptr;
+}
+
+void frame_arena::begin_frame()
+{
+    int next = 1 - _current.load(std::memory_order_relaxed);
+    for (auto& s : _slots) s->buffers[next].reset();
+    _current.store(next, std::memory_order_release);
+}
+
+linear_arena& frame_arena::local()
+{
+    int index = _jobs ? _jobs->thread_index() : 0;
+    return _slots[index]->buffers[_current.load(std::memory_order_acquire)];
+}
+
+size_t frame_arena::used() const
+{
+    int current = _current.load(std::memory_order_acquire);
+    size_t n = 0;
+    for (auto& s : _slots) n += s->buffers[current].used();
+    return n;
+}
+
+linear_arena* frame_arena::current()
+{
+    return active_arena ? &active_arena->local() : nullptr;
+}
+}
@@ -0,0 +1,199 @@
+#ifndef GDT_ARENA_HEADER_INCLUDED
+#define GDT_ARENA_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace gdt {
+
+class job_system;
+
+/**
+ * A bump allocator. Allocating moves a pointer forward, freeing is a
+ * no-op, and reset takes everything back at once.
+ *
+ * When a block runs out the arena takes another, twice as big, from
+ * the heap. reset then merges them into one block of the total size,
+ * so once an arena has seen its busiest frame it doesn't touch the
+ * heap anymore.
+ *
+ * Not thread safe, every thread gets its own, see gdt::frame_arena.
+ */
+class linear_arena {
+  public:
+    explicit linear_arena(size_t block_size = 64 * 1024);
+    linear_arena(const linear_arena&) = delete;
+    linear_arena& operator=(const linear_arena&) = delete;
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+    {
+        uintptr_t p = (uintptr_t(_top) + align - 1) & ~uintptr_t(align - 1);
+        if (!_top || p + bytes > uintptr_t(_end)) return grow(bytes, align);
+        _top = reinterpret_cast<char*>(p + bytes);
+        return reinterpret_cast<void*>(p);
+    }
+
+    /** Take back everything allocated since the last reset. */
+    void reset();
+
+    /** Bytes allocated since the last reset, padding included. */
+    size_t used() const;
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+  private:
+    void* grow(size_t bytes, size_t align);
+
+    size_t _block_size;
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    char* _top = nullptr;
+    char* _end = nullptr;
+    // bytes used in the blocks before the last one
+    size_t _used_before = 0;
+    size_t _capacity = 0;
+};
+
+/**
+ * Scratch memory for data that lives no longer than a frame. The
+ * application has one, reachable as ctx.arena, with a pair of
+ * linear_arena objects for the main thread and for each job_system
+ * worker. At the start of every frame the pairs flip and the arenas
+ * that become current are reset, so whatever was allocated during a
+ * frame stays valid until the end of the next one.
+ *
+ * Most code uses it through frame_allocator, which picks the calling
+ * thread's arena on its own:
+ *
+ *     gdt::frame_vector<gdt::light> lights;
+ *     lights.reserve(_lamps.size());
+ *     for (auto& l : _lamps) {
+ *         if (l.is_on()) lights.push_back(l.light());
+ *     }
+ *     light_pipeline.set_lights(lights);
+ *
+ * or asks for raw memory directly:
+ *
+ *     auto* scores = static_cast<float*>(ctx.arena->local().allocate(n * sizeof(float)));
+ *
+ * Never keep frame memory past the next frame, and only use it from
+ * the main thread and from jobs started during the frame.
+ */
+class frame_arena {
+  public:
+    /**
+     * @param jobs the job system whose workers get an arena each
+     * @param block_size the initial size of every arena
+     */
+    explicit frame_arena(job_system* jobs, size_t block_size = 64 * 1024);
+    ~frame_arena();
+    frame_arena(const frame_arena&) = delete;
+    frame_arena& operator=(const frame_arena&) = delete;
+
+    /**
+     * Flip the buffers and reset the calling thread's and every
+     * worker's arena for the new frame. Called by gdt::application at
+     * the start of every frame.
+     */
+    void begin_frame();
+
+    /** The calling thread's arena for this frame. */
+    linear_arena& local();
+
+    /** Bytes allocated this frame, all threads together. */
+    size_t used() const;
+
+    /**
+     * The calling thread's arena of the application's frame_arena, or
+     * nullptr when there is no application running.
+     */
+    static linear_arena* current();
+
+  private:
+    struct slot {
+        explicit slot(size_t block_size) : buffers{linear_arena(block_size), linear_arena(block_size)}
+        {
+        }
+        linear_arena buffers[2];
+    };
+
+    job_system* _jobs;
+    std::vector<std::unique_ptr<slot>> _slots;
+    std::atomic<int> _current{0};
+};
+
+/**
+ * A standard allocator handing out frame_arena memory, for containers
+ * that only live during a frame. Deallocating does nothing, so reserve
+ * up front: every time a vector grows, its old buffer stays behind
+ * until the arena resets.
+ *
+ * Outside a running application it falls back to the heap.
+ */
+template <typename T>
+class frame_allocator {
+  public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U>
+    struct rebind {
+        using other = frame_allocator<U>;
+    };
+
+    frame_allocator() : _arena(frame_arena::current())
+    {
+    }
+    explicit frame_allocator(linear_arena* arena) : _arena(arena)
+    {
+    }
+    template <typename U>
+    frame_allocator(const frame_allocator<U>& other) : _arena(other.arena())
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (!_arena) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t)
+    {
+        if (!_arena) ::operator delete(p);
+    }
+
+    linear_arena* arena() const
+    {
+        return _arena;
+    }
+
+  private:
+    linear_arena* _arena;
+};
+
+template <typename T, typename U>
+bool operator==(const frame_allocator<T>& a, const frame_allocator<U>& b)
+{
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const frame_allocator<T>& a, const frame_allocator<U>& b)
+{
+    return a.arena() != b.arena();
+}
+
+template <typename T>
+using frame_vector = std::vector<T, frame_allocator<T>>;
+}
+
+#endif  // GDT_ARENA_HEADER_INCLUDED
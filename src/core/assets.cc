@@ -0,0 +1,178 @@
+#include "assets.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+
+#include "loader.hh"
+#include "logger.hh"
+#include "memory.hh"
+
+namespace gdt {
+
+namespace {
+
+bool ends_with(const std::string& s, const char* suffix)
+{
+    size_t n = std::char_traits<char>::length(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+thread_local asset_cache* current_cache = nullptr;
+thread_local upload_queue* current_queue = nullptr;
+
+// every queue there is, for upload_queue::cancel
+std::mutex queues_lock;
+std::vector<upload_queue*> queues;
+}
+
+asset_cache::scope::scope(asset_cache* c) : _previous(current_cache)
+{
+    current_cache = c;
+}
+
+asset_cache::scope::~scope()
+{
+    current_cache = _previous;
+}
+
+asset_cache::~asset_cache()
+{
+    clear();
+}
+
+void asset_cache::read(const std::string& filename)
+{
+    memory::scope tag(memory::ASSETS);
+    try {
+        if (ends_with(filename, ".smd")) {
+            auto m = read_smd(filename.c_str());
+            std::lock_guard<std::mutex> guard(_lock);
+            _models[filename] = std::move(m);
+        } else if (ends_with(filename, ".png")) {
+            image img;
+            if (!load_png_for_texture(&img.pixels, &img.width, &img.height, filename.c_str())) {
+                LOG_ERROR << "cannot read image " << filename;
+                return;
+            }
+            std::lock_guard<std::mutex> guard(_lock);
+            auto it = _images.find(filename);
+            if (it != _images.end()) free(it->second.pixels);
+            _images[filename] = img;
+        } else {
+            LOG_WARNING << "don't know how to read " << filename << " ahead of time";
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR << "cannot read " << filename << ": " << e.what();
+    }
+}
+
+std::unique_ptr<model> asset_cache::take_model(const std::string& filename)
+{
+    asset_cache* c = current_cache;
+    if (!c) return nullptr;
+    std::lock_guard<std::mutex> guard(c->_lock);
+    auto it = c->_models.find(filename);
+    if (it == c->_models.end()) return nullptr;
+    auto m = std::move(it->second);
+    c->_models.erase(it);
+    return m;
+}
+
+bool asset_cache::take_image(const std::string& filename, unsigned char** img,
+                             unsigned int* width, unsigned int* height)
+{
+    asset_cache* c = current_cache;
+    if (!c) return false;
+    std::lock_guard<std::mutex> guard(c->_lock);
+    auto it = c->_images.find(filename);
+    if (it == c->_images.end()) return false;
+    *img = it->second.pixels;
+    *width = it->second.width;
+    *height = it->second.height;
+    c->_images.erase(it);
+    return true;
+}
+
+void asset_cache::clear()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _models.clear();
+    for (auto& i : _images) free(i.second.pixels);
+    _images.clear();
+}
+
+upload_queue::scope::scope(upload_queue* q) : _previous(current_queue)
+{
+    current_queue = q;
+}
+
+upload_queue::scope::~scope()
+{
+    current_queue = _previous;
+}
+
+upload_queue::upload_queue()
+{
+    std::lock_guard<std::mutex> guard(queues_lock);
+    queues.push_back(this);
+}
+
+upload_queue::~upload_queue()
+{
+    std::lock_guard<std::mutex> guard(queues_lock);
+    queues.erase(std::find(queues.begin(), queues.end(), this));
+}
+
+void upload_queue::submit(size_t bytes, upload f, const void* owner)
+{
+    if (!current_queue) {
+        f();
+        return;
+    }
+    current_queue->_uploads.push_back({bytes, std::move(f), owner});
+    current_queue->_bytes_total += bytes;
+}
+
+void upload_queue::cancel(const void* owner)
+{
+    if (!owner) return;
+    std::lock_guard<std::mutex> guard(queues_lock);
+    for (upload_queue* q : queues) {
+        auto first = q->_uploads.begin() + q->_next;
+        auto last = std::remove_if(first, q->_uploads.end(), [q, owner](entry& e) {
+            if (e.owner != owner) return false;
+            q->_bytes_total -= e.bytes;
+            return true;
+        });
+        q->_uploads.erase(last, q->_uploads.end());
+    }
+}
+
+bool upload_queue::run(float budget_ms)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (_next < _uploads.size()) {
+        entry& e = _uploads[_next++];
+        e.f();
+        e.f.reset();
+        _bytes_done += e.bytes;
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() -
+                                                            start)
+                       .count();
+        if (ms >= budget_ms) break;
+    }
+    if (_next < _uploads.size()) return false;
+    clear();
+    return true;
+}
+
+void upload_queue::clear()
+{
+    _uploads.clear();
+    _next = 0;
+    _bytes_total = 0;
+    _bytes_done = 0;
+}
+}
@@ -0,0 +1,180 @@
+#ifndef GDT_ASSETS_HEADER_INCLUDED
+#define GDT_ASSETS_HEADER_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "callback.hh"
+#include "mesh.hh"
+
+namespace gdt {
+
+/**
+ * Files read and decoded ahead of time, usually by job_system workers
+ * while the current scene keeps running. Drawables and textures look in
+ * the cache open on their thread first, and only read the file
+ * themselves if it isn't there:
+ *
+ *     gdt::asset_cache cache;
+ *     cache.read("res/zombie.smd");               // any thread
+ *     ...
+ *     {
+ *         gdt::asset_cache::scope open(&cache);
+ *         zombie z(ctx);                          // no parsing now
+ *     }
+ *
+ * An asset taken from the cache is gone from it, so every file read
+ * ahead feeds one drawable or texture. Drawables built anywhere else
+ * never see it. gdt::scene_loader does all of this for you.
+ *
+ * SMD models and PNG images are supported.
+ */
+class asset_cache {
+  public:
+    /** Opens a cache for the current thread, until it goes out of scope. */
+    class scope {
+      public:
+        explicit scope(asset_cache* c);
+        ~scope();
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+      private:
+        asset_cache* _previous;
+    };
+
+    asset_cache() = default;
+    ~asset_cache();
+    asset_cache(const asset_cache&) = delete;
+    asset_cache& operator=(const asset_cache&) = delete;
+
+    /**
+     * Read and decode filename into the cache. Safe to call from any
+     * thread. Errors are logged and leave the file out of the cache,
+     * so whoever needs it reads it again and gets the error for real.
+     */
+    void read(const std::string& filename);
+
+    /**
+     * The model read from filename into the cache open on this thread,
+     * or nullptr if there's no such cache or it isn't cached.
+     */
+    static std::unique_ptr<model> take_model(const std::string& filename);
+
+    /**
+     * The RGBA pixels read from filename into the cache open on this
+     * thread, the same as load_png_for_texture gives. False if there's
+     * no such cache or it isn't cached.
+     */
+    static bool take_image(const std::string& filename, unsigned char** img,
+                           unsigned int* width, unsigned int* height);
+
+    /** Drop everything nobody took. */
+    void clear();
+
+  private:
+    struct image {
+        unsigned char* pixels;
+        unsigned int width;
+        unsigned int height;
+    };
+    std::mutex _lock;
+    std::unordered_map<std::string, std::unique_ptr<model>> _models;
+    std::unordered_map<std::string, image> _images;
+};
+
+/**
+ * GPU uploads waiting for their turn. Creating a drawable or a texture
+ * uploads its data on the spot, unless an upload_queue is open on the
+ * current thread, in which case the upload is queued and runs later,
+ * a few at a time:
+ *
+ *     gdt::upload_queue uploads;
+ *     {
+ *         gdt::upload_queue::scope open(&uploads);
+ *         _next = std::make_unique<level2>(ctx, screen);
+ *     }
+ *     ...
+ *     uploads.run(2);   // every frame, at most ~2ms worth
+ *
+ * Queued uploads point into the objects that submitted them, so these
+ * have to stay put until the queue is empty or cleared. Objects going
+ * away before that cancel their uploads, see cancel.
+ */
+class upload_queue {
+  public:
+    using upload = inplace_function<void()>;
+
+    /** Opens a queue for the current thread, until it goes out of scope. */
+    class scope {
+      public:
+        explicit scope(upload_queue* q);
+        ~scope();
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+      private:
+        upload_queue* _previous;
+    };
+
+    upload_queue();
+    ~upload_queue();
+    upload_queue(const upload_queue&) = delete;
+    upload_queue& operator=(const upload_queue&) = delete;
+
+    /**
+     * Queue f on the open queue, or run it now if none is open.
+     *
+     * @param bytes how much f uploads, for progress reporting
+     * @param owner the object f writes into, for cancel
+     */
+    static void submit(size_t bytes, upload f, const void* owner = nullptr);
+
+    /**
+     * Drop the uploads owner submitted that didn't run yet, from every
+     * queue. Called by whatever submits uploads when it's destroyed.
+     */
+    static void cancel(const void* owner);
+
+    /**
+     * Run queued uploads, oldest first, until they took budget_ms.
+     * At least one runs, so the queue always drains.
+     *
+     * @return true once the queue is empty
+     */
+    bool run(float budget_ms);
+
+    /** Drop all queued uploads without running them. */
+    void clear();
+
+    size_t pending() const
+    {
+        return _uploads.size() - _next;
+    }
+    size_t bytes_total() const
+    {
+        return _bytes_total;
+    }
+    size_t bytes_done() const
+    {
+        return _bytes_done;
+    }
+
+  private:
+    struct entry {
+        size_t bytes;
+        upload f;
+        const void* owner;
+    };
+    std::vector<entry> _uploads;
+    size_t _next = 0;
+    size_t _bytes_total = 0;
+    size_t _bytes_done = 0;
+};
+}
+
+#endif  // GDT_ASSETS_HEADER_INCLUDED
@@ -0,0 +1,317 @@
+#include "bounds.hh"
+#include "simd.hh"
+
+namespace gdt::math {
+
+void aabb::expand(const vec3 &p)
+{
+    min = vec3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+    max = vec3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+}
+
+void aabb::merge(const aabb &other)
+{
+    if (other.is_empty()) return;
+    expand(other.min);
+    expand(other.max);
+}
+
+bool aabb::contains(const vec3 &p) const
+{
+    return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z &&
+           p.z <= max.z;
+}
+
+bool aabb::overlaps(const aabb &other) const
+{
+    return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y &&
+           max.y >= other.min.y && min.z <= other.max.z && max.z >= other.min.z;
+}
+
+aabb aabb::transformed(const mat4 &m) const
+{
+    if (is_empty()) return *this;
+    // Arvo's method: transform the center and project the extents
+    // on the absolute rotation and scale part of the matrix.
+    vec3 c = center();
+    vec3 e = extents();
+    vec3 nc(m.xx * c.x + m.xy * c.y + m.xz * c.z + m.xw,
+            m.yx * c.x + m.yy * c.y + m.yz * c.z + m.yw,
+            m.zx * c.x + m.zy * c.y + m.zz * c.z + m.zw);
+    vec3 ne(fabsf(m.xx) * e.x + fabsf(m.xy) * e.y + fabsf(m.xz) * e.z,
+            fabsf(m.yx) * e.x + fabsf(m.yy) * e.y + fabsf(m.yz) * e.z,
+            fabsf(m.zx) * e.x + fabsf(m.zy) * e.y + fabsf(m.zz) * e.z);
+    return aabb(nc - ne, nc + ne);
+}
+
+sphere sphere::around(const aabb &box)
+{
+    if (box.is_empty()) return sphere();
+    return sphere(box.center(), box.extents().length());
+}
+
+bool sphere::contains(const vec3 &p) const
+{
+    return (p - center).length_sqrd() <= radius * radius;
+}
+
+bool sphere::overlaps(const sphere &other) const
+{
+    float r = radius + other.radius;
+    return (other.center - center).length_sqrd() <= r * r;
+}
+
+bool sphere::overlaps(const aabb &box) const
+{
+    float d = 0;
+    const float *c = &center.x;
+    const float *lo = &box.min.x;
+    const float *hi = &box.max.x;
+    for (int i = 0; i < 3; i++) {
+        if (c[i] < lo[i]) d += (lo[i] - c[i]) * (lo[i] - c[i]);
+        if (c[i] > hi[i]) d += (c[i] - hi[i]) * (c[i] - hi[i]);
+    }
+    return d <= radius * radius;
+}
+
+sphere sphere::transformed(const mat4 &m) const
+{
+    vec3 nc(m.xx * center.x + m.xy * center.y + m.xz * center.z + m.xw,
+            m.yx * center.x + m.yy * center.y + m.yz * center.z + m.yw,
+            m.zx * center.x + m.zy * center.y + m.zz * center.z + m.zw);
+    float sx = m.xx * m.xx + m.yx * m.yx + m.zx * m.zx;
+    float sy = m.xy * m.xy + m.yy * m.yy + m.zy * m.zy;
+    float sz = m.xz * m.xz + m.yz * m.yz + m.zz * m.zz;
+    return sphere(nc, radius * sqrtf(std::max(sx, std::max(sy, sz))));
+}
+
+plane::plane(float a, float b, float c, float d)
+{
+    float len = sqrtf(a * a + b * b + c * c);
+    if (len == 0) len = 1;
+    this->n = vec3(a / len, b / len, c / len);
+    this->d = d / len;
+}
+
+bool ray::intersects(const aabb &box, float *t) const
+{
+    float tmin = 0;
+    float tmax = FLT_MAX;
+    const float *o = &origin.x;
+    const float *d = &dir.x;
+    const float *lo = &box.min.x;
+    const float *hi = &box.max.x;
+    for (int i = 0; i < 3; i++) {
+        if (fabsf(d[i]) < FLT_EPSILON) {
+            if (o[i] < lo[i] || o[i] > hi[i]) return false;
+            continue;
+        }
+        float inv = 1.0f / d[i];
+        float t0 = (lo[i] - o[i]) * inv;
+        float t1 = (hi[i] - o[i]) * inv;
+        if (t0 > t1) std::swap(t0, t1);
+        tmin = std::max(tmin, t0);
+        tmax = std::min(tmax, t1);
+        if (tmin > tmax) return false;
+    }
+    if (t) *t = tmin;
+    return true;
+}
+
+bool ray::intersects(const sphere &s, float *t) const
+{
+    vec3 oc = origin - s.center;
+    float a = dir.length_sqrd();
+    float b = oc.x * dir.x + oc.y * dir.y + oc.z * dir.z;
+    float c = oc.length_sqrd() - s.radius * s.radius;
+    float disc = b * b - a * c;
+    if (disc < 0 || a == 0) return false;
+    float sq = sqrtf(disc);
+    float hit = (-b - sq) / a;
+    if (hit < 0) hit = (-b + sq) / a;
+    if (hit < 0) return false;
+    if (t) *t = hit;
+    return true;
+}
+
+frustum::frustum(const mat4 &m)
+{
+    // Gribb & Hartmann: each plane is the w row plus or minus one of
+    // the x, y and z rows of the clip matrix.
+    planes[LEFT] = plane(m.wx + m.xx, m.wy + m.xy, m.wz + m.xz, m.ww + m.xw);
+    planes[RIGHT] = plane(m.wx - m.xx, m.wy - m.xy, m.wz - m.xz, m.ww - m.xw);
+    planes[BOTTOM] = plane(m.wx + m.yx, m.wy + m.yy, m.wz + m.yz, m.ww + m.yw);
+    planes[TOP] = plane(m.wx - m.yx, m.wy - m.yy, m.wz - m.yz, m.ww - m.yw);
+    planes[NEAR_CLIP] = plane(m.wx + m.zx, m.wy + m.zy, m.wz + m.zz, m.ww + m.zw);
+    planes[FAR_CLIP] = plane(m.wx - m.zx, m.wy - m.zy, m.wz - m.zz, m.ww - m.zw);
+}
+
+bool frustum::contains(const vec3 &p) const
+{
+    for (const auto &pl : planes) {
+        if (pl.distance(p) < 0) return false;
+    }
+    return true;
+}
+
+bool frustum::intersects(const sphere &s) const
+{
+    for (const auto &pl : planes) {
+        if (pl.distance(s.center) < -s.radius) return false;
+    }
+    return true;
+}
+
+bool frustum::intersects(const aabb &box) const
+{
+    if (box.is_empty()) return false;
+    vec3 c = box.center();
+    vec3 e = box.extents();
+    for (const auto &pl : planes) {
+        float r = fabsf(pl.n.x) * e.x + fabsf(pl.n.y) * e.y + fabsf(pl.n.z) * e.z;
+        if (pl.distance(c) < -r) return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// BATCHED TESTS
+
+namespace {
+
+int spheres_scalar(const plane *planes, const float *cx, const float *cy, const float *cz,
+                   const float *r, int first, int n, uint8_t *visible)
+{
+    int count = 0;
+    for (int i = first; i < n; i++) {
+        bool inside = true;
+        for (int p = 0; p < frustum::PLANES; p++) {
+            const plane &pl = planes[p];
+            float d = pl.n.x * cx[i] + pl.n.y * cy[i] + pl.n.z * cz[i] + pl.d;
+            inside = inside && d >= -r[i];
+        }
+        visible[i] = inside;
+        count += inside;
+    }
+    return count;
+}
+
+int aabbs_scalar(const plane *planes, const float *cx, const float *cy, const float *cz,
+                 const float *ex, const float *ey, const float *ez, int first, int n,
+                 uint8_t *visible)
+{
+    int count = 0;
+    for (int i = first; i < n; i++) {
+        bool inside = true;
+        for (int p = 0; p < frustum::PLANES; p++) {
+            const plane &pl = planes[p];
+            float d = pl.n.x * cx[i] + pl.n.y * cy[i] + pl.n.z * cz[i] + pl.d;
+            float e = fabsf(pl.n.x) * ex[i] + fabsf(pl.n.y) * ey[i] + fabsf(pl.n.z) * ez[i];
+            inside = inside && d >= -e;
+        }
+        visible[i] = inside;
+        count += inside;
+    }
+    return count;
+}
+
+#if defined(GDT_HAS_SIMD)
+using simd::lanes4;
+using simd::lanes8;
+using simd::load;
+
+template <typename LANES>
+int spheres_wide(const plane *planes, const float *cx, const float *cy, const float *cz,
+                 const float *r, int n, uint8_t *visible)
+{
+    constexpr int W = sizeof(LANES) / sizeof(float);
+    int count = 0;
+    int i = 0;
+    for (; i + W <= n; i += W) {
+        LANES x;
+        load(x, cx + i);
+        LANES y;
+        load(y, cy + i);
+        LANES z;
+        load(z, cz + i);
+        LANES nr;
+        load(nr, r + i);
+        nr = -nr;
+        auto inside = x == x;
+        for (int p = 0; p < frustum::PLANES; p++) {
+            const plane &pl = planes[p];
+            LANES d = x * pl.n.x + y * pl.n.y + z * pl.n.z + pl.d;
+            inside &= d >= nr;
+        }
+        for (int l = 0; l < W; l++) {
+            visible[i + l] = inside[l] != 0;
+            count += visible[i + l];
+        }
+    }
+    return count + spheres_scalar(planes, cx, cy, cz, r, i, n, visible);
+}
+
+template <typename LANES>
+int aabbs_wide(const plane *planes, const float *cx, const float *cy, const float *cz,
+               const float *ex, const float *ey, const float *ez, int n, uint8_t *visible)
+{
+    constexpr int W = sizeof(LANES) / sizeof(float);
+    int count = 0;
+    int i = 0;
+    for (; i + W <= n; i += W) {
+        LANES x;
+        load(x, cx + i);
+        LANES y;
+        load(y, cy + i);
+        LANES z;
+        load(z, cz + i);
+        LANES hx;
+        load(hx, ex + i);
+        LANES hy;
+        load(hy, ey + i);
+        LANES hz;
+        load(hz, ez + i);
+        auto inside = x == x;
+        for (int p = 0; p < frustum::PLANES; p++) {
+            const plane &pl = planes[p];
+            LANES d = x * pl.n.x + y * pl.n.y + z * pl.n.z + pl.d;
+            LANES e = hx * fabsf(pl.n.x) + hy * fabsf(pl.n.y) + hz * fabsf(pl.n.z);
+            inside &= d >= -e;
+        }
+        for (int l = 0; l < W; l++) {
+            visible[i + l] = inside[l] != 0;
+            count += visible[i + l];
+        }
+    }
+    return count + aabbs_scalar(planes, cx, cy, cz, ex, ey, ez, i, n, visible);
+}
+#endif
+}
+
+int frustum::test_spheres(const float *cx, const float *cy, const float *cz, const float *r,
+                          int n, uint8_t *visible, int width) const
+{
+#if defined(GDT_HAS_SIMD)
+    if (width >= 8) return spheres_wide<lanes8>(planes, cx, cy, cz, r, n, visible);
+    if (width >= 4) return spheres_wide<lanes4>(planes, cx, cy, cz, r, n, visible);
+#endif
+    return spheres_scalar(planes, cx, cy, cz, r, 0, n, visible);
+}
+
+int frustum::test_aabbs(const float *cx, const float *cy, const float *cz, const float *ex,
+                        const float *ey, const float *ez, int n, uint8_t *visible,
+                        int width) const
+{
+#if defined(GDT_HAS_SIMD)
+    if (width >= 8) return aabbs_wide<lanes8>(planes, cx, cy, cz, ex, ey, ez, n, visible);
+    if (width >= 4) return aabbs_wide<lanes4>(planes, cx, cy, cz, ex, ey, ez, n, visible);
+#endif
+    return aabbs_scalar(planes, cx, cy, cz, ex, ey, ez, 0, n, visible);
+}
+}
+
+std::ostream &operator<<(std::ostream &os, const gdt::math::aabb &b)
+{
+    os << "[" << b.min << " - " << b.max << "]";
+    return os;
+}
@@ -0,0 +1,190 @@
+#ifndef GDT_BOUNDS_HEADER_INCLUDED
+#define GDT_BOUNDS_HEADER_INCLUDED
+
+#include <float.h>
+#include <stdint.h>
+
+#include "math.hh"
+
+namespace gdt::math {
+
+/**
+ * An axis aligned bounding box, stored as its minimum and maximum corners.
+ *
+ * A default constructed box is empty and will grow to fit whatever you
+ * expand it with:
+ *
+ *     math::aabb box;
+ *     for (const auto &v : m->vertices) box.expand(v.position);
+ */
+struct aabb {
+    vec3 min;
+    vec3 max;
+
+    aabb() : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+    {
+    }
+    aabb(const vec3 &min, const vec3 &max) : min(min), max(max)
+    {
+    }
+
+    bool is_empty() const
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    vec3 center() const
+    {
+        return vec3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+    }
+
+    /** Half the size of the box on each axis. */
+    vec3 extents() const
+    {
+        return vec3((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f);
+    }
+
+    void expand(const vec3 &p);
+    void merge(const aabb &other);
+    bool contains(const vec3 &p) const;
+    bool overlaps(const aabb &other) const;
+
+    /**
+     * Bounds of this box after being transformed by m, using the
+     * usual column vector convention (translation at xw, yw, zw).
+     * Instance transforms are stored transposed, so transpose them first.
+     */
+    aabb transformed(const mat4 &m) const;
+};
+
+/**
+ * A bounding sphere.
+ */
+struct sphere {
+    vec3 center;
+    float radius;
+
+    sphere() : radius(0)
+    {
+    }
+    sphere(const vec3 &center, float radius) : center(center), radius(radius)
+    {
+    }
+
+    /** The smallest sphere around the given box. */
+    static sphere around(const aabb &box);
+
+    bool contains(const vec3 &p) const;
+    bool overlaps(const sphere &other) const;
+    bool overlaps(const aabb &box) const;
+
+    /**
+     * Bounds of this sphere after being transformed by m. The radius is
+     * scaled by the largest axis scale of m.
+     */
+    sphere transformed(const mat4 &m) const;
+};
+
+/**
+ * A plane in the form of n.p + d = 0, with n pointing to the positive half space.
+ */
+struct plane {
+    vec3 n;
+    float d;
+
+    plane() : d(0)
+    {
+    }
+    plane(float a, float b, float c, float d);
+
+    float distance(const vec3 &p) const
+    {
+        return n.x * p.x + n.y * p.y + n.z * p.z + d;
+    }
+};
+
+/**
+ * A ray, used for picking and line of sight queries.
+ * The direction doesn't have to be normalized, but hit distances are
+ * measured in units of its length.
+ */
+struct ray {
+    vec3 origin;
+    vec3 dir;
+
+    ray()
+    {
+    }
+    ray(const vec3 &origin, const vec3 &dir) : origin(origin), dir(dir)
+    {
+    }
+
+    vec3 at(float t) const
+    {
+        return origin + dir * t;
+    }
+
+    /**
+     * Slab test against a box.
+     *
+     * @param box the box to hit
+     * @param t receives the entry distance if not null
+     * @return true if the ray hits the box in front of its origin
+     */
+    bool intersects(const aabb &box, float *t = nullptr) const;
+    bool intersects(const sphere &s, float *t = nullptr) const;
+};
+
+/**
+ * A view frustum made of six inward facing planes.
+ *
+ * You extract a frustum from a combined projection and view matrix,
+ * exactly the one gdt pipelines bind as the camera matrix:
+ *
+ *     auto f = math::frustum(c.entity().proj * c.get_transformable().get_transforms()[0]);
+ *     if (f.intersects(_crate.get_drawable().get_bounding_sphere())) ...
+ *
+ * Besides single shape tests, a frustum can test whole arrays of spheres
+ * or boxes, stored as structure of arrays, 1, 4 or 8 lanes at a time.
+ * These are the ones to use when culling many instances:
+ *
+ *     std::vector<uint8_t> visible(n);
+ *     int count = f.test_spheres(xs, ys, zs, rs, n, visible.data());
+ */
+struct frustum {
+    enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_CLIP, FAR_CLIP, PLANES };
+    plane planes[PLANES];
+
+    frustum()
+    {
+    }
+    explicit frustum(const mat4 &proj_view);
+
+    bool contains(const vec3 &p) const;
+    bool intersects(const sphere &s) const;
+    bool intersects(const aabb &box) const;
+
+    /**
+     * Test n spheres given as separate center and radius arrays.
+     *
+     * @param width number of lanes to test at once: 1, 4 or 8
+     * @return the number of spheres intersecting the frustum
+     */
+    int test_spheres(const float *cx, const float *cy, const float *cz, const float *r, int n,
+                     uint8_t *visible, int width = 8) const;
+
+    /**
+     * Test n boxes given as separate center and half extents arrays.
+     *
+     * @param width number of lanes to test at once: 1, 4 or 8
+     * @return the number of boxes intersecting the frustum
+     */
+    int test_aabbs(const float *cx, const float *cy, const float *cz, const float *ex,
+                   const float *ey, const float *ez, int n, uint8_t *visible,
+                   int width = 8) const;
+};
+}
+
+std::ostream &operator<<(std::ostream &os, const gdt::math::aabb &b);
+
+#endif  // GDT_BOUNDS_HEADER_INCLUDED
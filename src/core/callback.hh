@@ -0,0 +1,96 @@
+#ifndef GDT_CALLBACK_HEADER_INCLUDED
+#define GDT_CALLBACK_HEADER_INCLUDED
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace gdt {
+
+template <typename SIGNATURE, size_t CAPACITY = 48>
+class inplace_function;
+
+/**
+ * A move only std::function replacement that keeps the callable inside
+ * a fixed size buffer, so storing a callback never allocates.
+ *
+ * Anything that fits works, lambdas included:
+ *
+ *     inplace_function<void(float, float)> f = [this](float elapsed, float progress) {
+ *         _alpha = progress;
+ *     };
+ *
+ * Capturing more than CAPACITY bytes is a compile error. Capture a pointer
+ * to your state instead of copying it in.
+ */
+template <typename R, typename... ARGS, size_t CAPACITY>
+class inplace_function<R(ARGS...), CAPACITY> {
+  public:
+    inplace_function() = default;
+
+    template <typename F, typename = std::enable_if_t<
+                              !std::is_same<std::decay_t<F>, inplace_function>::value>>
+    inplace_function(F&& f)
+    {
+        using T = std::decay_t<F>;
+        static_assert(sizeof(T) <= CAPACITY,
+                      "callable is too large, capture a pointer to your state instead");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "callable is over aligned");
+        new (_storage) T(std::forward<F>(f));
+        _invoke = [](void* s, ARGS... args) -> R {
+            return (*static_cast<T*>(s))(std::forward<ARGS>(args)...);
+        };
+        _manage = [](void* dst, void* src) {
+            if (dst) new (dst) T(std::move(*static_cast<T*>(src)));
+            static_cast<T*>(src)->~T();
+        };
+    }
+
+    inplace_function(inplace_function&& other) { take(other); }
+
+    inplace_function& operator=(inplace_function&& other)
+    {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    inplace_function(const inplace_function&) = delete;
+    inplace_function& operator=(const inplace_function&) = delete;
+
+    ~inplace_function() { reset(); }
+
+    R operator()(ARGS... args) const
+    {
+        return _invoke(const_cast<unsigned char*>(_storage), std::forward<ARGS>(args)...);
+    }
+
+    explicit operator bool() const { return _invoke != nullptr; }
+
+    void reset()
+    {
+        if (_manage) _manage(nullptr, _storage);
+        _invoke = nullptr;
+        _manage = nullptr;
+    }
+
+  private:
+    void take(inplace_function& other)
+    {
+        if (other._manage) other._manage(_storage, other._storage);
+        _invoke = other._invoke;
+        _manage = other._manage;
+        other._invoke = nullptr;
+        other._manage = nullptr;
+    }
+
+    alignas(std::max_align_t) unsigned char _storage[CAPACITY];
+    R (*_invoke)(void*, ARGS...) = nullptr;
+    void (*_manage)(void* dst, void* src) = nullptr;
+};
+}
+
+#endif  // GDT_CALLBACK_HEADER_INCLUDED
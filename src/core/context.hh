@@ -3,9 +3,9 @@
 
 #include <functional>
 
-#include <chrono>
-#include <map>
 #include "imgui/imgui.h"
+#include "utils/memory.hh"
+#include "utils/profiler.hh"
 
 // Context is a single object managed by the application and designed to flow
 // through the call stack to any function. Its purpose is to provide access to
@@ -15,6 +15,10 @@
 // part, without introducing inter-aspect dependencies.
 namespace gdt {
 
+class frame_arena;
+class job_system;
+class scene_loader;
+
 /**
  * gdt::context is also composed from this core_context. The core context
  * provides the frame elapsed time, useful in many time-based game state
@@ -22,44 +26,37 @@ namespace gdt {
  *
  * You can directly access `elapsed` through your game's specified context
  * type.
+ *
+ * When the application runs in fixed update mode, `fixed_step` is the
+ * simulation step in seconds, and `elapsed` equals it inside
+ * gdt::scene::fixed_update. Otherwise it is 0.
+ *
+ * `jobs` is the application's gdt::job_system, for fanning work out
+ * to all cores.
+ *
+ * `scenes` is the application's gdt::scene_loader, for switching to
+ * another scene without a loading stall.
+ *
+ * `arena` is the application's gdt::frame_arena, scratch memory reset
+ * every frame.
  */
 struct core_context {
     float elapsed;
+    float fixed_step = 0;
     std::function<void()> quit;
+    job_system* jobs = nullptr;
+    scene_loader* scenes = nullptr;
+    frame_arena* arena = nullptr;
 
-    struct measurement {
-        mutable long long _b;
-        mutable long long _total;
-        mutable int avg = 0;
-        mutable long long _count = 0;
-        void begin() const {
-                _b = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-        }
-        void end() const {
-           _count++;
-           int d = std::chrono::high_resolution_clock::now().time_since_epoch().count() - _b;
-           _total += d;
-           avg = _total / _count;
-        }
-    };
-
-    mutable std::map<std::string, measurement> _m;
-
-    const measurement & measure(std::string what) const {
-        return _m[what];
-    }
-
+    /**
+     * Draw the profiler's zone tree, see gdt::profiler, and the memory
+     * held by each subsystem, see gdt::memory.
+     */
     void imgui() const {
         ImGui::Separator();
-        float total = 0;
-        for (auto & m : _m) {
-            float avg = m.second.avg;
-            avg /= 1000000.0f;
-            ImGui::Text("%s: %fms", m.first.c_str(), avg );
-            total += avg;
-        }
-        ImGui::Text("TOTAL: %fms", total );
+        profiler::imgui();
         ImGui::Separator();
+        if (ImGui::CollapsingHeader("memory")) memory::imgui();
     }
 };
 
@@ -0,0 +1,54 @@
+#include "culling.hh"
+
+#include <algorithm>
+
+#include "simd.hh"
+
+namespace gdt {
+
+int instance_culler::cull(const math::aabb &local, const math::mat4 *transforms, int count)
+{
+    if (count <= 0) return 0;
+    if (int(_cx.size()) < count) {
+        _cx.resize(count);
+        _cy.resize(count);
+        _cz.resize(count);
+        _r.resize(count);
+        _hits.resize(count);
+        _visible.resize(count);
+    }
+    math::sphere s = math::sphere::around(local);
+    math::vec3 c = s.center;
+    // the spheres around every instance, the transforms being transposed
+    for (int i = 0; i < count; i++) {
+        const math::mat4 &m = transforms[i];
+        _cx[i] = m.xx * c.x + m.yx * c.y + m.zx * c.z + m.wx;
+        _cy[i] = m.xy * c.x + m.yy * c.y + m.zy * c.z + m.wy;
+        _cz[i] = m.xz * c.x + m.yz * c.y + m.zz * c.z + m.wz;
+        float sx = m.xx * m.xx + m.xy * m.xy + m.xz * m.xz;
+        float sy = m.yx * m.yx + m.yy * m.yy + m.yz * m.yz;
+        float sz = m.zx * m.zx + m.zy * m.zy + m.zz * m.zz;
+        _r[i] = s.radius * sqrtf(std::max(sx, std::max(sy, sz)));
+    }
+#if defined(GDT_HAS_SIMD)
+    // 8 lanes only pay off where the target has them natively
+    const int width = simd::lanes_of<simd::lanes>::width;
+#else
+    const int width = 1;
+#endif
+    int visible = _frustum.test_spheres(_cx.data(), _cy.data(), _cz.data(), _r.data(), count,
+                                        _hits.data(), width);
+    if (visible == 0) return 0;
+    // nothing to leave out, so draw straight from the instances
+    if (visible == count) {
+        _out = transforms;
+        return count;
+    }
+    _out = _visible.data();
+    int n = 0;
+    for (int i = 0; i < count && n < visible; i++) {
+        if (_hits[i]) _visible[n++] = transforms[i];
+    }
+    return n;
+}
+}
@@ -0,0 +1,81 @@
+#ifndef GDT_CULLING_HEADER_INCLUDED
+#define GDT_CULLING_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+#include "bounds.hh"
+#include "math.hh"
+#include "utils/memory.hh"
+
+namespace gdt {
+
+/**
+ * How a pipeline draw treats instances outside the camera.
+ */
+enum class culling {
+    // draw every instance
+    none,
+    // draw only the instances whose bounds touch the camera frustum
+    frustum
+};
+
+/**
+ * Culls instances against a frustum before they are drawn, leaving the
+ * transforms of the visible ones packed together, ready for a single
+ * instanced draw.
+ *
+ * gdt::forward_pipeline and gdt::geom_pipeline keep one, pointed at the
+ * camera by set_camera, and use it when asked to:
+ *
+ *     _pipeline.use(ctx)
+ *         .set_camera(_camera)
+ *         .draw(_crates, gdt::culling::frustum);
+ *
+ * Every surface of a drawable is culled on its own bounds. Instance
+ * transforms are read the way instances keep them, transposed, and the
+ * sphere around the bounds of each is tested 8 at a time where the
+ * target has SIMD. The backend counts the instances drawn and culled
+ * each frame, see visible_instances and culled_instances.
+ */
+class instance_culler {
+  public:
+    void set_frustum(const math::frustum &f)
+    {
+        _frustum = f;
+    }
+
+    const math::frustum &get_frustum() const
+    {
+        return _frustum;
+    }
+
+    /**
+     * Cull count instances of something bounded by local, in model space.
+     *
+     * @return the number of visible instances, their transforms are in
+     *         visible until the next call
+     */
+    int cull(const math::aabb &local, const math::mat4 *transforms, int count);
+
+    const math::mat4 *visible() const
+    {
+        return _out;
+    }
+
+  private:
+    template <typename T>
+    using array = std::vector<T, tagged_allocator<T, memory::INSTANCES>>;
+
+    math::frustum _frustum;
+    array<float> _cx;
+    array<float> _cy;
+    array<float> _cz;
+    array<float> _r;
+    array<uint8_t> _hits;
+    array<math::mat4> _visible;
+    const math::mat4 *_out = nullptr;
+};
+}
+
+#endif  // GDT_CULLING_HEADER_INCLUDED
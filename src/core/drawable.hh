@@ -5,10 +5,14 @@
 #include <memory>
 #include <vector>
 
+#include "assets.hh"
+#include "bounds.hh"
 #include "checks.hh"
+#include "culling.hh"
 #include "graphics.hh"
 #include "loader.hh"
 #include "math.hh"
+#include "memory.hh"
 #include "mesh.hh"
 #include "traits.hh"
 
@@ -46,6 +50,11 @@ namespace gdt {
  *     gdt::instance<zombie> _zombie;
  *     gdt::instances<zombie, 1000> _army_of_zombies;
  *
+ * The model comes from gdt::asset_cache when it was read ahead of time,
+ * and the surfaces are uploaded through gdt::upload_queue, so a scene
+ * constructed by gdt::scene_loader neither parses nor uploads on the spot.
+ * The bounds are there right away either way.
+ *
  * Now, if you want direct control over your drawable instances, you can
  * use gdt::driven together with a gdt::direct_driver or other drivers
  * to help you manipulate your instances transformations:
@@ -77,12 +86,36 @@ class drawable : public is_drawable<ACTUAL> {
     void draw_instances(const graphics_context<GRAPHICS> &ctx, const PIPELINE &s,
                         const math::mat4 *transforms, int count) const;
 
+    /**
+     * Draw only the instances culler finds visible, culling each surface
+     * on its own bounds.
+     */
+    template <typename PIPELINE>
+    void draw_instances(const graphics_context<GRAPHICS> &ctx, const PIPELINE &s,
+                        const math::mat4 *transforms, int count,
+                        instance_culler &culler) const;
+
+    /**
+     * Half the size of the model's bounding box on each axis.
+     */
     math::vec3 get_bounds() const;
 
+    /**
+     * The model space bounding box of all surfaces, computed once when loaded.
+     */
+    const math::aabb &get_aabb() const;
+
+    /**
+     * The model space bounding sphere around get_aabb().
+     */
+    const math::sphere &get_bounding_sphere() const;
+
   private:
     std::vector<std::unique_ptr<
         gdt::blueprints::graphics::surface<GRAPHICS, typename GRAPHICS::surface>>>
         _surfaces;
+    math::aabb _bounds;
+    math::sphere _sphere;
 };
 
 template <typename GRAPHICS, typename ACTUAL>
@@ -93,6 +126,7 @@ void drawable<GRAPHICS, ACTUAL>::draw_instances(const graphics_context<GRAPHICS>
                                         const math::mat4 *transforms,
                                         int count) const
 {
+    if (count <= 0) return;
     _material.bind(ctx, s);
     for (const auto &surf : _surfaces) {
         surf.get()->draw_instanced(*ctx.graphics, s, transforms, count);
@@ -106,27 +140,44 @@ void drawable<GRAPHICS, ACTUAL>::draw_instances(const graphics_context<GRAPHICS>
                                         const math::mat4 *transforms,
                                         int count) const
 {
+    if (count <= 0) return;
     for (const auto &surf : _surfaces) {
         surf.get()->draw_instanced(*ctx.graphics, s, transforms, count);
     }
 }
 
 template <typename GRAPHICS, typename ACTUAL>
-math::vec3 drawable<GRAPHICS, ACTUAL>::get_bounds() const
+template <typename PIPELINE>
+void drawable<GRAPHICS, ACTUAL>::draw_instances(const graphics_context<GRAPHICS> &ctx,
+                                        const PIPELINE &s,
+                                        const math::mat4 *transforms,
+                                        int count,
+                                        instance_culler &culler) const
 {
-    float max_x, min_x, max_y, min_y, max_z, min_z;
-    max_x = min_x = max_y = min_y = max_z = min_z = 0;
+    if (count <= 0) return;
     for (const auto &surf : _surfaces) {
-        max_x = std::max(max_x, surf->max_v.x);
-        max_y = std::max(max_y, surf->max_v.y);
-        max_z = std::max(max_z, surf->max_v.z);
-        min_x = std::min(min_x, surf->min_v.x);
-        min_y = std::min(min_y, surf->min_v.x);
-        min_z = std::min(min_z, surf->min_v.x);
+        int visible = culler.cull(surf.get()->bounds, transforms, count);
+        ctx.graphics->count_culling(visible, count - visible);
+        if (visible) surf.get()->draw_instanced(*ctx.graphics, s, culler.visible(), visible);
     }
-    math::vec3 ret = math::vec3((max_x - min_x) / 2, (max_y - min_y) / 2, (max_z - min_z) / 2);
-    LOG_DEBUG << "drawable bounds are " << ret;
-    return ret;
+}
+
+template <typename GRAPHICS, typename ACTUAL>
+math::vec3 drawable<GRAPHICS, ACTUAL>::get_bounds() const
+{
+    return _bounds.extents();
+}
+
+template <typename GRAPHICS, typename ACTUAL>
+const math::aabb &drawable<GRAPHICS, ACTUAL>::get_aabb() const
+{
+    return _bounds;
+}
+
+template <typename GRAPHICS, typename ACTUAL>
+const math::sphere &drawable<GRAPHICS, ACTUAL>::get_bounding_sphere() const
+{
+    return _sphere;
 }
 
 template <typename GRAPHICS, typename ACTUAL>
@@ -134,16 +185,34 @@ drawable<GRAPHICS, ACTUAL>::drawable(const graphics_context<GRAPHICS> &ctx,
                             std::string filename,
                             std::function<std::unique_ptr<model>(const char *filename)> loader)
 {
-    auto model = loader(filename.c_str());
+    auto model = asset_cache::take_model(filename);
+    if (!model) {
+        memory::scope tag(memory::ASSETS);
+        model = loader(filename.c_str());
+    }
+    size_t bytes = 0;
     for (auto &m : model->meshes) {
-        auto s = std::make_unique<typename GRAPHICS::surface>(ctx, m.get());
-        _surfaces.push_back(std::move(s));
+        _bounds.merge(m->calc_bounds());
+        bytes += m->vertices.size() * sizeof(vertex) + m->triangles.size() * sizeof(uint32_t);
+    }
+    graphics_context<GRAPHICS> gctx = ctx;
+    upload_queue::submit(bytes, [this, gctx, model = std::move(model)]() {
+        for (auto &m : model->meshes) {
+            _surfaces.push_back(std::make_unique<typename GRAPHICS::surface>(gctx, m.get()));
+        }
+    }, this);
+    if (_bounds.is_empty()) {
+        _bounds = math::aabb(math::vec3(), math::vec3());
     }
+    _sphere = math::sphere::around(_bounds);
+    LOG_DEBUG << "drawable bounds are " << _bounds;
 }
 
 template <typename GRAPHICS, typename ACTUAL>
 drawable<GRAPHICS, ACTUAL>::~drawable()
 {
+    // an upload still queued would write into this drawable
+    upload_queue::cancel(this);
 }
 
 }
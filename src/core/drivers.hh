@@ -148,10 +148,13 @@ class direct_driver {
     {
         return _driven_transform;
     }
+    void retarget(math::mat4 *transform)
+    {
+        _driven_transform = transform;
+    }
 
   private:
     math::mat4 *_driven_transform;
-    math::mat4 _transform;
 
     math::vec3 _translation;
     math::mat4 _rotation;
@@ -482,10 +485,16 @@ direct_driver<DRIVABLE>::direct_driver(const core_context &context, math::mat4 *
 template <typename DRIVABLE>
 void direct_driver<DRIVABLE>::update()
 {
-    _transform = math::mat4::translation(_translation);
-    _transform *= _rotation;
-    _transform *= math::mat4::scale(_scale);
-    *_driven_transform = _transform.transpose();
+    // translation * rotation * scale, transposed, written out without
+    // the two matrix products
+    const math::mat4 &r = _rotation;
+    const math::vec3 &t = _translation;
+    const math::vec3 &s = _scale;
+    *_driven_transform = math::mat4(
+        (r.xx + t.x * r.wx) * s.x, (r.yx + t.y * r.wx) * s.x, (r.zx + t.z * r.wx) * s.x, r.wx * s.x,
+        (r.xy + t.x * r.wy) * s.y, (r.yy + t.y * r.wy) * s.y, (r.zy + t.z * r.wy) * s.y, r.wy * s.y,
+        (r.xz + t.x * r.wz) * s.z, (r.yz + t.y * r.wz) * s.z, (r.zz + t.z * r.wz) * s.z, r.wz * s.z,
+        r.xw + t.x * r.ww, r.yw + t.y * r.ww, r.zw + t.z * r.ww, r.ww);
 }
 
 template <typename DRIVABLE>
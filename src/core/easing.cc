@@ -20,12 +20,16 @@
  *    distribution.
  */
 #include <math.h>
+#include <string.h>
+#include <array>
+#include <utility>
 //#include "utils.h"
 #include "easing.hh"
+#include "simd.hh"
 
 
 static const double Pi = 3.14159265358979323846264338328;
-static const double Pi_2 = 3.14159265358979323846264338328 * 2;
+static const double Pi_2 = 3.14159265358979323846264338328 / 2;
 
 static __inline float max(float x, float y)
 {
@@ -311,3 +315,216 @@ float bounce_ease_in_out(float p)
         return 0.5 * bounce_ease_out(p * 2 - 1) + 0.5;
     }
 }
+
+/*
+ * Easing kinds, batched easing and lookup tables
+ */
+
+static float (*const easing_functions[EASE_KINDS])(float) = {
+    linear_interpolation,
+    quadratic_ease_in, quadratic_ease_out, quadratic_ease_in_out,
+    cubic_ease_in, cubic_ease_out, cubic_ease_in_out,
+    quartic_ease_in, quartic_ease_out, quartic_ease_in_out,
+    quintic_ease_in, quintic_ease_out, quintic_ease_in_out,
+    sine_ease_in, sine_ease_out, sine_ease_in_out,
+    circular_ease_in, circular_ease_out, circular_ease_in_out,
+    exponential_ease_in, exponential_ease_out, exponential_ease_in_out,
+    elastic_ease_in, elastic_ease_out, elastic_ease_in_out,
+    back_ease_in, back_ease_out, back_ease_in_out,
+    bounce_ease_in, bounce_ease_out, bounce_ease_in_out
+};
+
+float (*easing_function(easing_kind kind))(float)
+{
+    return easing_functions[kind];
+}
+
+float ease(easing_kind kind, float p)
+{
+    return easing_functions[kind](p);
+}
+
+#if defined(GDT_HAS_SIMD)
+namespace {
+
+using namespace gdt::simd;
+
+template <typename V>
+inline V bounce_out_lanes(V p)
+{
+    V a = (121 * p * p) / 16.0f;
+    V b = (363 / 40.0f * p * p) - (99 / 10.0f * p) + 17 / 5.0f;
+    V c = (4356 / 361.0f * p * p) - (35442 / 1805.0f * p) + 16061 / 1805.0f;
+    V d = (54 / 5.0f * p * p) - (513 / 25.0f * p) + 268 / 25.0f;
+    V r = p < 9 / 10.0f ? c : d;
+    r = p < 8 / 11.0f ? b : r;
+    return p < 4 / 11.0f ? a : r;
+}
+
+template <typename V>
+inline V back_lanes(V f)
+{
+    return f * f * f - f * gdt::simd::sin(f * (float)Pi);
+}
+
+/* The same formulas as the scalar functions above, evaluated lane-wise.
+ * Piecewise functions evaluate both sides and select. The kind is a
+ * template argument so the switch folds away inside the loops below. */
+template <int kind, typename V>
+inline V ease_lanes(const V& p)
+{
+    const V zero = V{};
+    const V one = zero + 1;
+    const float pi_2 = Pi_2;
+    switch (kind) {
+        case EASE_LINEAR:
+            return p;
+        case EASE_QUADRATIC_IN:
+            return p * p;
+        case EASE_QUADRATIC_OUT:
+            return -(p * (p - 2));
+        case EASE_QUADRATIC_IN_OUT:
+            return p < 0.5f ? 2 * p * p : (-2 * p * p) + (4 * p) - 1;
+        case EASE_CUBIC_IN:
+            return p * p * p;
+        case EASE_CUBIC_OUT: {
+            V f = p - 1;
+            return f * f * f + 1;
+        }
+        case EASE_CUBIC_IN_OUT: {
+            V f = (2 * p) - 2;
+            return p < 0.5f ? 4 * p * p * p : 0.5f * f * f * f + 1;
+        }
+        case EASE_QUARTIC_IN:
+            return p * p * p * p;
+        case EASE_QUARTIC_OUT: {
+            V f = p - 1;
+            return f * f * f * (1 - p) + 1;
+        }
+        case EASE_QUARTIC_IN_OUT: {
+            V f = p - 1;
+            return p < 0.5f ? 8 * p * p * p * p : -8 * f * f * f * f + 1;
+        }
+        case EASE_QUINTIC_IN:
+            return p * p * p * p * p;
+        case EASE_QUINTIC_OUT: {
+            V f = p - 1;
+            return f * f * f * f * f + 1;
+        }
+        case EASE_QUINTIC_IN_OUT: {
+            V f = (2 * p) - 2;
+            return p < 0.5f ? 16 * p * p * p * p * p : 0.5f * f * f * f * f * f + 1;
+        }
+        case EASE_SINE_IN:
+            return gdt::simd::sin((p - 1) * pi_2) + 1;
+        case EASE_SINE_OUT:
+            return gdt::simd::sin(p * pi_2);
+        case EASE_SINE_IN_OUT:
+            return 0.5f * (1 - gdt::simd::cos(p * (float)Pi));
+        case EASE_CIRCULAR_IN:
+            return 1 - gdt::simd::sqrt(1 - (p * p));
+        case EASE_CIRCULAR_OUT:
+            return gdt::simd::sqrt((2 - p) * p);
+        case EASE_CIRCULAR_IN_OUT:
+            return p < 0.5f ? 0.5f * (1 - gdt::simd::sqrt(1 - 4 * (p * p)))
+                            : 0.5f * (gdt::simd::sqrt(-((2 * p) - 3) * ((2 * p) - 1)) + 1);
+        case EASE_EXPONENTIAL_IN:
+            return p == zero ? p : exp2(10 * (p - 1));
+        case EASE_EXPONENTIAL_OUT:
+            return p == one ? p : 1 - exp2(-10 * p);
+        case EASE_EXPONENTIAL_IN_OUT: {
+            V r = p < 0.5f ? 0.5f * exp2((20 * p) - 10) : -0.5f * exp2((-20 * p) + 10) + 1;
+            return (p == zero) | (p == one) ? p : r;
+        }
+        case EASE_ELASTIC_IN:
+            return gdt::simd::sin(13 * pi_2 * p) * exp2(10 * (p - 1));
+        case EASE_ELASTIC_OUT:
+            return gdt::simd::sin(-13 * pi_2 * (p + 1)) * exp2(-10 * p) + 1;
+        case EASE_ELASTIC_IN_OUT:
+            return p < 0.5f ? 0.5f * gdt::simd::sin(13 * pi_2 * (2 * p)) *
+                                  exp2(10 * ((2 * p) - 1))
+                            : 0.5f * (gdt::simd::sin(-13 * pi_2 * ((2 * p - 1) + 1)) *
+                                          exp2(-10 * (2 * p - 1)) +
+                                      2);
+        case EASE_BACK_IN:
+            return back_lanes(p);
+        case EASE_BACK_OUT:
+            return 1 - back_lanes(1 - p);
+        case EASE_BACK_IN_OUT:
+            return p < 0.5f ? 0.5f * back_lanes(2 * p)
+                            : 0.5f * (1 - back_lanes(1 - (2 * p - 1))) + 0.5f;
+        case EASE_BOUNCE_IN:
+            return 1 - bounce_out_lanes(1 - p);
+        case EASE_BOUNCE_OUT:
+            return bounce_out_lanes(p);
+        case EASE_BOUNCE_IN_OUT:
+            return p < 0.5f ? 0.5f * (1 - bounce_out_lanes(1 - p * 2))
+                            : 0.5f * bounce_out_lanes(p * 2 - 1) + 0.5f;
+        default:
+            return p;
+    }
+}
+
+template <int kind>
+void ease_block(const float* t, float* out, int n)
+{
+    const int W = lanes_of<lanes>::width;
+    int i = 0;
+    for (; i + W <= n; i += W) {
+        lanes p;
+        load(p, t + i);
+        store(out + i, ease_lanes<kind>(p));
+    }
+    if (i < n) {
+        float tail[W] = {0};
+        memcpy(tail, t + i, sizeof(float) * (n - i));
+        lanes p;
+        load(p, tail);
+        store(tail, ease_lanes<kind>(p));
+        memcpy(out + i, tail, sizeof(float) * (n - i));
+    }
+}
+
+template <int... kinds>
+constexpr auto ease_blocks(std::integer_sequence<int, kinds...>)
+{
+    return std::array<void (*)(const float*, float*, int), EASE_KINDS>{ease_block<kinds>...};
+}
+
+const auto ease_block_functions = ease_blocks(std::make_integer_sequence<int, EASE_KINDS>());
+}
+#endif
+
+void ease_n(easing_kind kind, const float* t, float* out, int n)
+{
+#if defined(GDT_HAS_SIMD)
+    ease_block_functions[kind](t, out, n);
+#else
+    float (*f)(float) = easing_functions[kind];
+    for (int i = 0; i < n; i++) out[i] = f(t[i]);
+#endif
+}
+
+easing_lut::easing_lut(easing_kind kind, float max_error)
+{
+    float (*f)(float) = easing_functions[kind];
+    for (int size = 16;; size *= 2) {
+        _table.resize(size + 1);
+        for (int i = 0; i <= size; i++) {
+            _table[i] = f(float(i) / size);
+        }
+        _scale = size;
+        _error = 0;
+        // measure between samples, where linear interpolation is the worst
+        for (int i = 0; i < size * 4; i++) {
+            float p = (i + 0.5f) / (size * 4);
+            _error = max(_error, fabsf((*this)(p) - f(p)));
+        }
+        if (_error <= max_error || size >= 65536) break;
+    }
+}
+
+void easing_lut::ease_n(const float* t, float* out, int n) const
+{
+    for (int i = 0; i < n; i++) out[i] = (*this)(t[i]);
+}
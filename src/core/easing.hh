@@ -471,4 +471,96 @@ float bounce_ease_out(float p);
  */
 float bounce_ease_in_out(float p);
 
+/**
+ * Easing function identifiers, for code that stores easings as data or
+ * eases many values at once, instead of calling through function pointers.
+ */
+enum easing_kind {
+    EASE_LINEAR,
+    EASE_QUADRATIC_IN, EASE_QUADRATIC_OUT, EASE_QUADRATIC_IN_OUT,
+    EASE_CUBIC_IN, EASE_CUBIC_OUT, EASE_CUBIC_IN_OUT,
+    EASE_QUARTIC_IN, EASE_QUARTIC_OUT, EASE_QUARTIC_IN_OUT,
+    EASE_QUINTIC_IN, EASE_QUINTIC_OUT, EASE_QUINTIC_IN_OUT,
+    EASE_SINE_IN, EASE_SINE_OUT, EASE_SINE_IN_OUT,
+    EASE_CIRCULAR_IN, EASE_CIRCULAR_OUT, EASE_CIRCULAR_IN_OUT,
+    EASE_EXPONENTIAL_IN, EASE_EXPONENTIAL_OUT, EASE_EXPONENTIAL_IN_OUT,
+    EASE_ELASTIC_IN, EASE_ELASTIC_OUT, EASE_ELASTIC_IN_OUT,
+    EASE_BACK_IN, EASE_BACK_OUT, EASE_BACK_IN_OUT,
+    EASE_BOUNCE_IN, EASE_BOUNCE_OUT, EASE_BOUNCE_IN_OUT,
+    EASE_KINDS
+};
+
+/**
+ * The scalar easing function for an easing kind.
+ */
+float (*easing_function(easing_kind kind))(float);
+
+/**
+ * Ease a single value using an easing kind.
+ */
+float ease(easing_kind kind, float p);
+
+/**
+ * Ease n values at once. This is the one to use when you have many
+ * values sharing the same easing, for example in a tween system:
+ *
+ *     ease_n(EASE_CUBIC_IN_OUT, progress, eased, count);
+ *
+ * Where SIMD is available all easing kinds run 4 or 8 values at a time,
+ * using float approximations of sin, exp2 and sqrt. Results match the
+ * scalar functions to within 1e-4.
+ *
+ * @param kind the easing to apply
+ * @param t input values, normally from 0 to 1
+ * @param out eased values, can be the same array as t
+ * @param n number of values
+ */
+void ease_n(easing_kind kind, const float* t, float* out, int n);
+
+#ifdef __cplusplus
+#include <vector>
+
+/**
+ * A lookup table approximation of an easing function, linearly
+ * interpolating between evenly spaced samples. The table grows until the
+ * interpolation error, measured between samples, is below the requested
+ * bound:
+ *
+ *     static const easing_lut bounce(EASE_BOUNCE_OUT, 1e-3f);
+ *     float y = bounce(x);
+ *
+ * Lookup tables pay off for the expensive transcendental easings
+ * (elastic, exponential, sine). Inputs are clamped to [0, 1].
+ * Easings with a vertical tangent (circular) may not reach the bound
+ * at all; check error() if it matters.
+ */
+class easing_lut {
+  public:
+    easing_lut(easing_kind kind, float max_error = 1e-3f);
+
+    float operator()(float p) const
+    {
+        p = p < 0 ? 0 : (p > 1 ? 1 : p);
+        float x = p * _scale;
+        int i = (int)x;
+        if (i >= (int)_table.size() - 1) i = _table.size() - 2;
+        float f = x - i;
+        return _table[i] + (_table[i + 1] - _table[i]) * f;
+    }
+
+    void ease_n(const float* t, float* out, int n) const;
+
+    /** Number of intervals in the table. */
+    int size() const { return _table.size() - 1; }
+
+    /** The largest error measured while building the table. */
+    float error() const { return _error; }
+
+  private:
+    std::vector<float> _table;
+    float _scale;
+    float _error;
+};
+#endif
+
 #endif /* end of include guard: EASING_H_FES178TS */
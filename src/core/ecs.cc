@@ -0,0 +1,223 @@
+#include "ecs.hh"
+
+#include <mutex>
+
+namespace gdt::ecs {
+
+namespace {
+
+// entries never move once registered, so reading them needs no lock
+std::mutex registry_lock;
+component_type registry[MAX_COMPONENTS];
+int registered = 0;
+
+size_t align_up(size_t n, size_t align)
+{
+    return (n + align - 1) & ~(align - 1);
+}
+}
+
+int register_component(const component_type &type)
+{
+    std::lock_guard<std::mutex> lock(registry_lock);
+    if (registered == MAX_COMPONENTS) {
+        throw std::runtime_error("ecs: too many component types");
+    }
+    registry[registered] = type;
+    return registered++;
+}
+
+const component_type &get_component_type(int id)
+{
+    return registry[id];
+}
+
+//------------------------------------------------------------------------------------------------
+// ARCHETYPE
+//------------------------------------------------------------------------------------------------
+
+archetype::archetype(component_mask mask) : _mask(mask)
+{
+    std::fill(_column, _column + MAX_COMPONENTS, -1);
+    size_t row = sizeof(entity);
+    for (int id = 0; id < MAX_COMPONENTS; id++) {
+        if (!has(id)) continue;
+        const component_type &type = get_component_type(id);
+        _column[id] = int8_t(_components.size());
+        _components.push_back(id);
+        _sizes.push_back(type.size);
+        row += type.size;
+    }
+    // a single row may not fit the usual chunk
+    _chunk_bytes = std::max(CHUNK_BYTES, row * 2 + 16 * _components.size());
+    _capacity = int(_chunk_bytes / row);
+    for (;; _capacity--) {
+        size_t end = sizeof(entity) * _capacity;
+        _offsets.clear();
+        for (int id : _components) {
+            const component_type &type = get_component_type(id);
+            end = align_up(end, type.align);
+            _offsets.push_back(end);
+            end += type.size * _capacity;
+        }
+        if (end <= _chunk_bytes) break;
+    }
+}
+
+archetype::~archetype()
+{
+    for (int row = 0; row < _size; row++) {
+        for (int id : _components) get_component_type(id).destroy(at(row, id));
+    }
+    for (uint8_t *c : _chunks) memory::deallocate(c);
+}
+
+int archetype::add_row(entity e)
+{
+    if (_size == int(_chunks.size()) * _capacity) {
+        void *chunk = memory::allocate(_chunk_bytes, memory::GAME);
+        if (!chunk) throw std::bad_alloc();
+        _chunks.push_back(static_cast<uint8_t *>(chunk));
+    }
+    int row = _size++;
+    entity_at(row) = e;
+    return row;
+}
+
+//------------------------------------------------------------------------------------------------
+// WORLD
+//------------------------------------------------------------------------------------------------
+
+entity world::make_entity(component_mask mask)
+{
+    entity e;
+    if (!_free.empty()) {
+        e.index = _free.back();
+        _free.pop_back();
+    } else {
+        e.index = uint32_t(_records.size());
+        _records.push_back({nullptr, 0, 1});
+    }
+    record &r = _records[e.index];
+    e.generation = r.generation;
+    r.arch = find(mask);
+    r.row = r.arch->add_row(e);
+    _size++;
+    return e;
+}
+
+void world::destroy(entity e)
+{
+    if (!alive(e)) return;
+    record &r = _records[e.index];
+    for (int id : r.arch->_components) get_component_type(id).destroy(r.arch->at(r.row, id));
+    erase_row(r.arch, r.row);
+    r.arch = nullptr;
+    if (++r.generation == 0) r.generation = 1;
+    _free.push_back(e.index);
+    _size--;
+}
+
+archetype *world::find(component_mask mask)
+{
+    auto i = _by_mask.find(mask);
+    if (i != _by_mask.end()) return i->second;
+    _archetypes.push_back(std::make_unique<archetype>(mask));
+    archetype *a = _archetypes.back().get();
+    _by_mask[mask] = a;
+    std::lock_guard<std::mutex> guard(_matching_lock);
+    for (auto &m : _matching) {
+        if ((mask & m.first) == m.first) m.second.push_back(a);
+    }
+    return a;
+}
+
+const std::vector<archetype *> &world::matching(component_mask mask)
+{
+    std::lock_guard<std::mutex> guard(_matching_lock);
+    auto i = _matching.find(mask);
+    if (i != _matching.end()) return i->second;
+    std::vector<archetype *> &m = _matching[mask];
+    for (auto &a : _archetypes) {
+        if ((a->mask() & mask) == mask) m.push_back(a.get());
+    }
+    return m;
+}
+
+archetype *world::with(archetype *a, int component)
+{
+    if (!a->_with[component]) a->_with[component] = find(a->mask() | component_mask(1) << component);
+    return a->_with[component];
+}
+
+archetype *world::without(archetype *a, int component)
+{
+    if (!a->_without[component]) {
+        a->_without[component] = find(a->mask() & ~(component_mask(1) << component));
+    }
+    return a->_without[component];
+}
+
+// Moves e's components over to another archetype, dropping those it
+// doesn't have. Those it has and e hadn't are left for the caller to
+// construct.
+void world::move(entity e, archetype *to)
+{
+    record &r = _records[e.index];
+    archetype *from = r.arch;
+    int row = to->add_row(e);
+    for (int id : from->_components) {
+        const component_type &type = get_component_type(id);
+        if (to->has(id)) {
+            type.relocate(to->at(row, id), from->at(r.row, id));
+        } else {
+            type.destroy(from->at(r.row, id));
+        }
+    }
+    erase_row(from, r.row);
+    r.arch = to;
+    r.row = row;
+}
+
+// Fills the row, whose components are gone already, with the last one.
+void world::erase_row(archetype *a, int row)
+{
+    int last = a->_size - 1;
+    if (row != last) {
+        for (int id : a->_components) {
+            get_component_type(id).relocate(a->at(row, id), a->at(last, id));
+        }
+        entity moved = a->entity_at(last);
+        a->entity_at(row) = moved;
+        _records[moved.index].row = row;
+    }
+    a->_size--;
+}
+
+void world::run_systems(job_system *jobs)
+{
+    size_t first = 0;
+    while (first < _systems.size()) {
+        // take systems while they don't touch what the ones taken write,
+        // or write what they read
+        component_mask reads = 0, writes = 0;
+        size_t last = first;
+        for (; last < _systems.size(); last++) {
+            const system &s = _systems[last];
+            if (s.writes & (reads | writes) || s.reads & writes) break;
+            reads |= s.reads;
+            writes |= s.writes;
+        }
+        if (!jobs || last - first == 1) {
+            for (size_t i = first; i < last; i++) _systems[i].run(*this, jobs);
+        } else {
+            job_counter done;
+            for (size_t i = first; i < last; i++) {
+                jobs->run(done, [this, jobs, i]() { _systems[i].run(*this, jobs); });
+            }
+            jobs->wait(done);
+        }
+        first = last;
+    }
+}
+}
@@ -0,0 +1,656 @@
+#ifndef GDT_ECS_HEADER_INCLUDED
+#define GDT_ECS_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "animation.hh"
+#include "context.hh"
+#include "jobs.hh"
+#include "math.hh"
+#include "traits.hh"
+#include "utils/memory.hh"
+
+/**
+ * Entities with components stored by archetype, for scenes with more
+ * things than gdt::instances and gdt::driven members can comfortably
+ * spell out one by one.
+ *
+ * An entity is just a handle. Its components are plain values of any
+ * movable type, and entities with the same set of component types, an
+ * archetype, are stored together in chunks of 16K, every component
+ * type in an array of its own. Queries visit the chunks of every
+ * archetype having the components asked for, so a loop over all the
+ * things that move touches nothing but positions and velocities:
+ *
+ *     struct position { gdt::math::vec3 p; };
+ *     struct velocity { gdt::math::vec3 v; };
+ *
+ *     gdt::ecs::world _world;
+ *     ...
+ *     auto e = _world.create(position{{0, 0, 0}}, velocity{{1, 0, 0}});
+ *     _world.add(e, gdt::ecs::transform());
+ *     ...
+ *     _world.each<position, const velocity>([&](position &p, const velocity &v) {
+ *         p.p += v.v * ctx.elapsed;
+ *     });
+ *
+ * Creating, destroying or changing the component set of entities moves
+ * components around, so don't do it from inside a query: collect the
+ * entities first.
+ */
+namespace gdt::ecs {
+
+/**
+ * A handle to an entity in a world. It stays valid until the entity
+ * is destroyed; after that, the world ignores it, even once the slot
+ * is reused.
+ */
+struct entity {
+    uint32_t index = 0;
+    // never 0 for a live entity, so a default handle is no one's
+    uint32_t generation = 0;
+
+    bool operator==(const entity &other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const entity &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+static constexpr int MAX_COMPONENTS = 64;
+using component_mask = uint64_t;
+
+/** How the values of a component type are moved and destroyed in chunks. */
+struct component_type {
+    size_t size;
+    size_t align;
+    // move construct into to and destroy from
+    void (*relocate)(void *to, void *from);
+    void (*destroy)(void *p);
+};
+
+int register_component(const component_type &type);
+const component_type &get_component_type(int id);
+
+template <typename C>
+int register_component()
+{
+    static_assert(alignof(C) <= 16, "ecs components can't be aligned to more than 16 bytes");
+    static const int id = register_component(
+        {sizeof(C), alignof(C),
+         [](void *to, void *from) {
+             new (to) C(std::move(*static_cast<C *>(from)));
+             static_cast<C *>(from)->~C();
+         },
+         [](void *p) { static_cast<C *>(p)->~C(); }});
+    return id;
+}
+
+/** The id of a component type, registered on first use. */
+template <typename T>
+int component_id()
+{
+    return register_component<std::remove_const_t<T>>();
+}
+
+template <typename... C>
+component_mask mask_of()
+{
+    component_mask mask = 0;
+    for (int id : {component_id<C>()..., -1}) {
+        if (id >= 0) mask |= component_mask(1) << id;
+    }
+    return mask;
+}
+
+/**
+ * The entities of one component set, in chunks. Row r lives at
+ * r % capacity in chunk r / capacity, and every chunk but the last is
+ * full.
+ */
+class archetype {
+  public:
+    static constexpr size_t CHUNK_BYTES = 16 * 1024;
+
+    explicit archetype(component_mask mask);
+    ~archetype();
+    archetype(const archetype &) = delete;
+    archetype &operator=(const archetype &) = delete;
+
+    component_mask mask() const
+    {
+        return _mask;
+    }
+
+    bool has(int component) const
+    {
+        return (_mask >> component) & 1;
+    }
+
+    int size() const
+    {
+        return _size;
+    }
+
+    int chunk_count() const
+    {
+        return (_size + _capacity - 1) / _capacity;
+    }
+
+    int chunk_size(int c) const
+    {
+        return std::min(_capacity, _size - c * _capacity);
+    }
+
+    const entity *entities(int c) const
+    {
+        return reinterpret_cast<const entity *>(_chunks[c]);
+    }
+
+    /** The array of component in chunk c. */
+    void *column(int c, int component) const
+    {
+        return _chunks[c] + _offsets[_column[component]];
+    }
+
+    void *at(int row, int component) const
+    {
+        int col = _column[component];
+        return _chunks[row / _capacity] + _offsets[col] + (row % _capacity) * _sizes[col];
+    }
+
+  private:
+    friend class world;
+
+    int add_row(entity e);
+    entity &entity_at(int row)
+    {
+        return reinterpret_cast<entity *>(_chunks[row / _capacity])[row % _capacity];
+    }
+
+    component_mask _mask;
+    std::vector<int> _components;
+    // column of every component id, -1 for those not in the archetype
+    int8_t _column[MAX_COMPONENTS];
+    std::vector<size_t> _offsets;
+    std::vector<size_t> _sizes;
+    std::vector<uint8_t *> _chunks;
+    size_t _chunk_bytes = CHUNK_BYTES;
+    int _capacity = 0;
+    int _size = 0;
+    // the archetypes one component away, found on first use
+    archetype *_with[MAX_COMPONENTS] = {};
+    archetype *_without[MAX_COMPONENTS] = {};
+};
+
+class world;
+
+/**
+ * The archetypes of a world having all of C. The world keeps the list,
+ * shared by every query of the same components, and adds archetypes to
+ * it as they appear, so making a query is a lookup. const components
+ * are read only, and systems reading the same components may run at
+ * the same time.
+ */
+template <typename... C>
+class query {
+  public:
+    explicit query(world &w);
+
+    /** Call f(C &...) for every entity. */
+    template <typename F>
+    void each(F &&f);
+
+    /**
+     * Call f(entities, count, C *...) for every chunk, with the arrays
+     * of the chunk's entities and components, for loops the compiler
+     * can vectorize.
+     */
+    template <typename F>
+    void each_chunk(F &&f);
+
+    /** each, with chunks spread over the job system's threads. */
+    template <typename F>
+    void par_each(job_system *jobs, F &&f);
+
+    /** The number of matching entities. */
+    int size();
+
+  private:
+    template <typename F>
+    static void visit(archetype *a, int c, F &f)
+    {
+        f(a->entities(c), a->chunk_size(c),
+          static_cast<C *>(a->column(c, component_id<C>()))...);
+    }
+
+    const std::vector<archetype *> *_matches;
+};
+
+/**
+ * The entities and their components, and the systems running over
+ * them.
+ *
+ * Systems are queries run every frame. Registered with add_system,
+ * they run in order with run_systems, but consecutive systems that
+ * don't write what the others read or write run at the same time,
+ * each spreading its chunks over the job system too:
+ *
+ *     _world.add_system<position, const velocity>([](position &p, const velocity &v) {
+ *         p.p += v.v * (1.0f / 60);
+ *     });
+ *     _world.add_system<const position, gdt::ecs::transform>(
+ *         [](const position &p, gdt::ecs::transform &t) {
+ *             t.matrix = gdt::math::mat4::translation(p.p).transpose();
+ *         });
+ *     ...
+ *     _world.run_systems(ctx.jobs);
+ */
+class world {
+  public:
+    world() = default;
+    world(const world &) = delete;
+    world &operator=(const world &) = delete;
+
+    /** Create an entity with the given components, one of each type. */
+    template <typename... C>
+    entity create(C... components);
+
+    void destroy(entity e);
+
+    bool alive(entity e) const
+    {
+        return e.index < _records.size() && _records[e.index].generation == e.generation;
+    }
+
+    /** Add a component to e, or replace the one it has. */
+    template <typename T>
+    void add(entity e, T component);
+
+    template <typename T>
+    void remove(entity e);
+
+    /** e's T, or nullptr if e has no T or is gone. */
+    template <typename T>
+    T *get(entity e);
+
+    template <typename T>
+    bool has(entity e) const
+    {
+        return alive(e) && _records[e.index].arch->has(component_id<T>());
+    }
+
+    /** The number of live entities. */
+    int size() const
+    {
+        return _size;
+    }
+
+    template <typename... C, typename F>
+    void each(F &&f)
+    {
+        query<C...>(*this).each(f);
+    }
+
+    template <typename... C, typename F>
+    void each_chunk(F &&f)
+    {
+        query<C...>(*this).each_chunk(f);
+    }
+
+    template <typename... C, typename F>
+    void par_each(job_system *jobs, F &&f)
+    {
+        query<C...>(*this).par_each(jobs, f);
+    }
+
+    /** Run f(C &...) over the matching entities on every run_systems. */
+    template <typename... C, typename F>
+    void add_system(F f);
+
+    void run_systems(job_system *jobs = nullptr);
+
+    const std::vector<std::unique_ptr<archetype>> &archetypes() const
+    {
+        return _archetypes;
+    }
+
+    /**
+     * The archetypes having all of mask. The list is made on the first
+     * call for a mask and kept up to date from then on, so it stays
+     * valid as long as the world does.
+     */
+    const std::vector<archetype *> &matching(component_mask mask);
+
+  private:
+    struct record {
+        archetype *arch;
+        int row;
+        uint32_t generation;
+    };
+
+    struct system {
+        component_mask reads;
+        component_mask writes;
+        std::function<void(world &, job_system *)> run;
+    };
+
+    entity make_entity(component_mask mask);
+    archetype *find(component_mask mask);
+    archetype *with(archetype *a, int component);
+    archetype *without(archetype *a, int component);
+    void move(entity e, archetype *to);
+    void erase_row(archetype *a, int row);
+
+    std::vector<std::unique_ptr<archetype>> _archetypes;
+    std::unordered_map<component_mask, archetype *> _by_mask;
+    std::vector<record> _records;
+    std::vector<uint32_t> _free;
+    std::vector<system> _systems;
+    int _size = 0;
+    // systems running at the same time may look up their lists at once
+    std::mutex _matching_lock;
+    std::unordered_map<component_mask, std::vector<archetype *>> _matching;
+};
+
+//------------------------------------------------------------------------------------------------
+// BRIDGES
+//------------------------------------------------------------------------------------------------
+
+/**
+ * Where an entity is, laid out like the transforms of gdt::instances,
+ * so drivers and pipelines take it as is.
+ */
+struct transform {
+    math::mat4 matrix = math::mat4::id();
+};
+
+/**
+ * Draws an entity with a drawable asset, shared by every entity
+ * looking the same.
+ */
+template <typename DRAWABLE>
+struct renderable {
+    const DRAWABLE *drawable;
+};
+
+/**
+ * The transforms of every entity drawn with one drawable, gathered
+ * into one instance buffer, for the existing pipelines:
+ *
+ *     gdt::ecs::draw_batch<crate> _crates{&_crate};
+ *     ...
+ *     _crates.collect(ctx, _world);
+ *     _pipeline.use(ctx).set_camera(_camera).draw(_crates);
+ */
+template <typename DRAWABLE>
+class draw_batch : public is_transformable<draw_batch<DRAWABLE>> {
+  public:
+    explicit draw_batch(const DRAWABLE *drawable) : _drawable(drawable)
+    {
+    }
+
+    /**
+     * Gather the transforms of the entities with a transform and a
+     * renderable of this batch's drawable, and upload them.
+     */
+    template <typename CONTEXT>
+    void collect(const CONTEXT &ctx, world &w);
+
+    const typename DRAWABLE::t_drawable &get_drawable() const
+    {
+        return _drawable->get_drawable();
+    }
+
+    const math::mat4 *get_transforms() const
+    {
+        return _transforms.data();
+    }
+
+    int size() const
+    {
+        return int(_transforms.size());
+    }
+
+  private:
+    const DRAWABLE *_drawable;
+    std::vector<math::mat4, tagged_allocator<math::mat4, memory::INSTANCES>> _transforms;
+};
+
+/**
+ * A single entity as the pipelines see it, for drawing entities one at
+ * a time, like animated ones with a pose each:
+ *
+ *     _world.each<const gdt::ecs::renderable<imrod>, const gdt::ecs::transform,
+ *                 const gdt::animixer>([&](auto &r, auto &t, auto &m) {
+ *         _pipeline.draw(gdt::ecs::drawn<imrod>(*r.drawable, t, &m));
+ *     });
+ */
+template <typename DRAWABLE>
+class drawn : public is_transformable<drawn<DRAWABLE>> {
+  public:
+    drawn(const DRAWABLE &drawable, const transform &t, const animixer *mixer = nullptr)
+        : _drawable(&drawable), _transform(&t), _mixer(mixer)
+    {
+    }
+
+    const typename DRAWABLE::t_drawable &get_drawable() const
+    {
+        return _drawable->get_drawable();
+    }
+
+    const animixer &get_animatable() const
+    {
+        if (!_mixer) throw std::runtime_error("ecs: drawing an entity without an animixer");
+        return *_mixer;
+    }
+
+    const math::mat4 *get_transforms() const
+    {
+        return &_transform->matrix;
+    }
+
+    int size() const
+    {
+        return 1;
+    }
+
+  private:
+    const DRAWABLE *_drawable;
+    const transform *_transform;
+    const animixer *_mixer;
+};
+
+/**
+ * Update every DRIVER component, like gdt::rigid_body_driver, into its
+ * entity's transform. Drivers are created as usual, with any transform
+ * to start with; they are pointed at the entity's before every update.
+ */
+template <typename DRIVER>
+void update_drivers(world &w)
+{
+    w.each<DRIVER, transform>([](DRIVER &d, transform &t) {
+        d.retarget(&t.matrix);
+        d.update();
+    });
+}
+
+/** The fixed update mode counterpart of update_drivers. */
+template <typename DRIVER>
+void fixed_update_drivers(world &w)
+{
+    w.each<DRIVER, transform>([](DRIVER &d, transform &t) {
+        d.retarget(&t.matrix);
+        d.fixed_update();
+    });
+}
+
+template <typename DRIVER>
+void interpolate_drivers(world &w, float alpha)
+{
+    w.each<DRIVER, transform>([alpha](DRIVER &d, transform &t) {
+        d.retarget(&t.matrix);
+        d.interpolate(alpha);
+    });
+}
+
+/**
+ * Advance every animixer component. animixer::update advances the
+ * animations it plays, so every mixer needs animations of its own.
+ */
+inline void update_animations(world &w, const core_context &ctx)
+{
+    w.each<animixer>([&ctx](animixer &m) { m.update(ctx); });
+}
+
+//------------------------------------------------------------------------------------------------
+// IMPLEMENTATIONS
+//------------------------------------------------------------------------------------------------
+
+template <typename... C>
+query<C...>::query(world &w) : _matches(&w.matching(mask_of<C...>()))
+{
+}
+
+template <typename... C>
+template <typename F>
+void query<C...>::each(F &&f)
+{
+    each_chunk([&f](const entity *, int count, C *... columns) {
+        for (int i = 0; i < count; i++) f(columns[i]...);
+    });
+}
+
+template <typename... C>
+template <typename F>
+void query<C...>::each_chunk(F &&f)
+{
+    for (archetype *a : *_matches) {
+        for (int c = 0; c < a->chunk_count(); c++) visit(a, c, f);
+    }
+}
+
+template <typename... C>
+template <typename F>
+void query<C...>::par_each(job_system *jobs, F &&f)
+{
+    auto run = [&f](const entity *, int count, C *... columns) {
+        for (int i = 0; i < count; i++) f(columns[i]...);
+    };
+    int chunks = 0;
+    for (archetype *a : *_matches) chunks += a->chunk_count();
+    if (!jobs || chunks < 2) {
+        each_chunk(run);
+        return;
+    }
+    // chunks are numbered across the archetypes in order, there are too
+    // few archetypes for the walk to matter next to a chunk's worth of work
+    jobs->parallel_for(0, chunks, [&](int i) {
+        for (archetype *a : *_matches) {
+            if (i < a->chunk_count()) {
+                visit(a, i, run);
+                return;
+            }
+            i -= a->chunk_count();
+        }
+    }, 1);
+}
+
+template <typename... C>
+int query<C...>::size()
+{
+    int n = 0;
+    for (archetype *a : *_matches) n += a->size();
+    return n;
+}
+
+template <typename... C>
+entity world::create(C... components)
+{
+    component_mask mask = mask_of<C...>();
+    if (int(__builtin_popcountll(mask)) != int(sizeof...(C))) {
+        throw std::runtime_error("ecs: an entity can't have two components of a type");
+    }
+    entity e = make_entity(mask);
+    const record &r = _records[e.index];
+    int unused[] = {(new (r.arch->at(r.row, component_id<C>())) C(std::move(components)), 0)...,
+                    0};
+    (void)unused;
+    return e;
+}
+
+template <typename T>
+void world::add(entity e, T component)
+{
+    if (!alive(e)) return;
+    int id = component_id<T>();
+    record &r = _records[e.index];
+    if (r.arch->has(id)) {
+        *static_cast<T *>(r.arch->at(r.row, id)) = std::move(component);
+        return;
+    }
+    move(e, with(r.arch, id));
+    new (r.arch->at(r.row, id)) T(std::move(component));
+}
+
+template <typename T>
+void world::remove(entity e)
+{
+    if (!has<T>(e)) return;
+    record &r = _records[e.index];
+    move(e, without(r.arch, component_id<T>()));
+}
+
+template <typename T>
+T *world::get(entity e)
+{
+    if (!alive(e)) return nullptr;
+    const record &r = _records[e.index];
+    int id = component_id<T>();
+    return r.arch->has(id) ? static_cast<T *>(r.arch->at(r.row, id)) : nullptr;
+}
+
+template <typename... C, typename F>
+void world::add_system(F f)
+{
+    system s;
+    s.reads = 0;
+    s.writes = 0;
+    for (auto c : {std::make_pair(component_id<C>(), std::is_const<C>::value)...,
+                   std::make_pair(-1, false)}) {
+        if (c.first < 0) continue;
+        (c.second ? s.reads : s.writes) |= component_mask(1) << c.first;
+    }
+    s.run = [f](world &w, job_system *jobs) mutable { w.par_each<C...>(jobs, f); };
+    _systems.push_back(std::move(s));
+}
+
+template <typename DRAWABLE>
+template <typename CONTEXT>
+void draw_batch<DRAWABLE>::collect(const CONTEXT &ctx, world &w)
+{
+    _transforms.clear();
+    w.each_chunk<const renderable<DRAWABLE>, const transform>(
+        [this](const entity *, int count, const renderable<DRAWABLE> *r, const transform *t) {
+            for (int i = 0; i < count; i++) {
+                if (r[i].drawable == _drawable) _transforms.push_back(t[i].matrix);
+            }
+        });
+    ctx.graphics->update_instance_buffer(_transforms.data(), size());
+}
+}
+
+#endif  // GDT_ECS_HEADER_INCLUDED
@@ -1,13 +1,17 @@
 #ifndef GDT_INSTANCES_HEADER_INCLUDED
 #define GDT_INSTANCES_HEADER_INCLUDED
 
+#include <stdint.h>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
 
 #include "context.hh"
 #include "math.hh"
 #include "traits.hh"
 #include "utils/checks.hh"
+#include "utils/memory.hh"
 
 namespace gdt {
 
@@ -219,10 +223,175 @@ class instances : public transforms<C>,
 template <typename T>
 using instance = instances<T, 1>;
 
+/**
+ * gdt::instance_pool is gdt::instances for things that come and go, like
+ * bullets, particles or enemies: the number of instances changes at
+ * runtime.
+ *
+ * spawn adds an instance and returns a handle to it, kill removes it, both
+ * in constant time. The live transforms are always packed at the front,
+ * so pipelines draw exactly those and nothing else:
+ *
+ *     gdt::instance_pool<bullet> _bullets;
+ *     ...
+ *     auto b = _bullets.spawn(math::mat4::translation(muzzle).transpose());
+ *     ...
+ *     *_bullets.get(b) = math::mat4::translation(p).transpose();
+ *     ...
+ *     _bullets.kill(b);
+ *
+ * A handle stays valid until its instance is killed. After that, get
+ * returns nullptr for it and kill does nothing, even if the slot was
+ * reused by another spawn. The transform pointers themselves move
+ * around on every spawn and kill, so keep handles rather than
+ * pointers.
+ *
+ * The transforms grow by doubling, and so does every surface's GPU
+ * instance buffer, so neither is reallocated once the pool has seen
+ * its busiest frame.
+ *
+ * @tparam T your entity type
+ */
+template <typename T>
+class instance_pool : public container<T>,
+                      public is_transformable<instance_pool<T>>,
+                      public may_have_drawable<T, instance_pool<T>>,
+                      public may_have_animatable<T, instance_pool<T>>,
+                      public may_have_collidable<T, instance_pool<T>> {
+  public:
+    struct handle {
+        uint32_t index = 0;
+        // never 0 for a spawned instance, so a default handle is no one's
+        uint32_t generation = 0;
+
+        bool operator==(const handle &other) const
+        {
+            return index == other.index && generation == other.generation;
+        }
+        bool operator!=(const handle &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * @param ctx a context
+     * @param capacity instances to make room for up front
+     * @param a the entity's constructor parameters
+     */
+    template <typename CONTEXT, typename... ARG>
+    instance_pool(const CONTEXT &ctx, int capacity = 0, const ARG &... a);
+
+    handle spawn(const math::mat4 &transform = math::mat4().transpose());
+
+    /**
+     * Remove an instance. The last live instance takes its place.
+     *
+     * @return false if h was killed already
+     */
+    bool kill(handle h);
+
+    /** Kill all instances, invalidating every handle. */
+    void clear();
+
+    bool alive(handle h) const;
+
+    /** The instance's transform, or nullptr if it was killed. */
+    math::mat4 *get(handle h);
+
+    /** The handle of the live instance at position i, 0 <= i < size(). */
+    handle handle_at(int i) const;
+
+    int size() const
+    {
+        return int(_transforms.size());
+    }
+
+    int capacity() const
+    {
+        return int(_transforms.capacity());
+    }
+
+    math::mat4 *begin()
+    {
+        return _transforms.data();
+    }
+
+    math::mat4 *end()
+    {
+        return _transforms.data() + _transforms.size();
+    }
+
+    const math::mat4 *get_transforms() const
+    {
+        return _transforms.data();
+    }
+
+    math::mat4 *get_transform_ptr(int i)
+    {
+        return &_transforms[i];
+    }
+
+    template <typename CONTEXT>
+    void update(const CONTEXT &ctx)
+    {
+        ctx.graphics->update_instance_buffer(_transforms.data(), size());
+    }
+
+  private:
+    static const uint32_t NONE = UINT32_MAX;
+
+    template <typename V>
+    using pool_vector = std::vector<V, tagged_allocator<V, memory::INSTANCES>>;
+
+    struct slot {
+        // the instance's position in _transforms, or the next free slot
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    pool_vector<math::mat4> _transforms;
+    pool_vector<uint32_t> _owners;
+    pool_vector<slot> _slots;
+    uint32_t _free = NONE;
+};
+
+/**
+ * SFINAE test for a static DRIVER::update_all(gdt::span<DRIVER>), a
+ * driver's own loop over all the drivers of a gdt::driven.
+ */
+template <typename DRIVER, typename Enable = void>
+struct has_update_all : std::false_type {
+};
+
+template <typename DRIVER>
+struct has_update_all<
+    DRIVER, decltype(DRIVER::update_all(std::declval<span<DRIVER>>()), void())>
+    : std::true_type {
+};
+
+/** The same, for DRIVER::interpolate_all(gdt::span<DRIVER>, float alpha). */
+template <typename DRIVER, typename Enable = void>
+struct has_interpolate_all : std::false_type {
+};
+
+template <typename DRIVER>
+struct has_interpolate_all<
+    DRIVER, decltype(DRIVER::interpolate_all(std::declval<span<DRIVER>>(), 0.0f), void())>
+    : std::true_type {
+};
+
 /**
  * gdt::driven can extend any gdt::is_transformable by allocating one or more
  * gdt::driver objects to manipulate one or more 3D transformation.
  *
+ * The drivers are kept side by side in a single allocation, constructed
+ * in place, so they never move and need not be movable. A driver type
+ * can update all of them in one loop of its own, with a static
+ * update_all(gdt::span<DRIVER>), and interpolate them with a static
+ * interpolate_all(gdt::span<DRIVER>, float alpha). update and
+ * interpolate call those instead of each driver's own, when present.
+ *
  * @tparam T a valid gdt::is_transformable type.
  * @tparam DRIVER a driver type to instantiate for each transformation of T.
  */
@@ -234,7 +403,26 @@ class driven : public container<T>,
                public may_have_collidable<T, driven<T, DRIVER>>,
                public may_have_transformable<T, driven<T, DRIVER>> {
   private:
-    std::vector<std::unique_ptr<DRIVER<typename T::t_drivable>>> _drivers;
+    using driver_type = DRIVER<typename T::t_drivable>;
+
+    static_assert(alignof(driver_type) <= 16, "drivers can't be aligned to more than 16 bytes");
+
+    // destroys the first count drivers and frees them all
+    struct drivers_deleter {
+        int count = 0;
+        void operator()(driver_type *drivers) const
+        {
+            for (int j = 0; j < count; j++) drivers[j].~driver_type();
+            memory::deallocate(drivers);
+        }
+    };
+
+    std::unique_ptr<driver_type, drivers_deleter> _drivers;
+
+    span<driver_type> drivers()
+    {
+        return span<driver_type>(_drivers.get(), this->content()->size());
+    }
 
   public:
     template <typename CONTEXT, typename... ARG>
@@ -248,10 +436,15 @@ class driven : public container<T>,
            const ARG &... a)
         : container<T>(ctx, pos::origin, a...)
     {
-        for (int j = 0; j < this->content()->size(); j++) {
-            _drivers.push_back(std::make_unique<DRIVER<typename T::t_drivable>>(
-                ctx, this->get_transformable_ptr()->get_transform_ptr(j),
-                this->get_drivable_ptr(), driver_callback(j)));
+        int count = this->content()->size();
+        void *storage = memory::allocate(sizeof(driver_type) * count, memory::INSTANCES);
+        if (!storage) throw std::bad_alloc();
+        _drivers.reset(static_cast<driver_type *>(storage));
+        for (int j = 0; j < count; j++) {
+            new (&_drivers.get()[j])
+                driver_type(ctx, this->get_transformable_ptr()->get_transform_ptr(j),
+                            this->get_drivable_ptr(), driver_callback(j));
+            _drivers.get_deleter().count = j + 1;
         }
     }
 
@@ -263,28 +456,52 @@ class driven : public container<T>,
     {
         this->get_transformable_ptr()->reuse(ctx, pos_callback);
         for (int j = 0; j < this->content()->size(); j++) {
-            _drivers[j]->reuse(ctx, this->get_transformable_ptr()->get_transform_ptr(j));
+            _drivers.get()[j].reuse(ctx, this->get_transformable_ptr()->get_transform_ptr(j));
         }
     }
 
     const DRIVER<typename T::etype> &get_driver(int index = 0) const
     {
-        return *_drivers[index].get();
+        return _drivers.get()[index];
     }
 
     DRIVER<typename T::etype> *get_driver_ptr(int index = 0)
     {
-        return _drivers[index].get();
+        return &_drivers.get()[index];
     }
 
     template <typename CONTEXT>
     void update(const CONTEXT &ctx)
     {
-        for (int j = 0; j < this->content()->size(); j++) {
-            _drivers[j]->update();
+        update_drivers(has_update_all<driver_type>());
+        this->content()->update(ctx);
+    }
+
+    /**
+     * Fixed update mode counterpart of update, for drivers following a
+     * simulation (like gdt::rigid_body_driver). Call it from
+     * gdt::scene::fixed_update, after stepping the simulation.
+     */
+    template <typename CONTEXT>
+    void fixed_update(const CONTEXT &ctx)
+    {
+        for (driver_type &d : drivers()) {
+            d.fixed_update();
         }
+    }
+
+    /**
+     * Blend the driven transforms between the last two fixed updates and
+     * upload them. Call it once per frame from the interpolating
+     * gdt::scene::update.
+     */
+    template <typename CONTEXT>
+    void interpolate(const CONTEXT &ctx, float alpha)
+    {
+        interpolate_drivers(alpha, has_interpolate_all<driver_type>());
         this->content()->update(ctx);
     }
+
     const T &drivable() const
     {
         return *this->ccontent();
@@ -299,7 +516,115 @@ class driven : public container<T>,
     {
         return *this->content();
     }
+
+  private:
+    void update_drivers(std::true_type)
+    {
+        driver_type::update_all(drivers());
+    }
+
+    void update_drivers(std::false_type)
+    {
+        for (driver_type &d : drivers()) {
+            d.update();
+        }
+    }
+
+    void interpolate_drivers(float alpha, std::true_type)
+    {
+        driver_type::interpolate_all(drivers(), alpha);
+    }
+
+    void interpolate_drivers(float alpha, std::false_type)
+    {
+        for (driver_type &d : drivers()) {
+            d.interpolate(alpha);
+        }
+    }
 };
+
+//------------------------------------------------------------------------------------------------
+// IMPLEMENTATIONS
+//------------------------------------------------------------------------------------------------
+
+template <typename T>
+template <typename CONTEXT, typename... ARG>
+instance_pool<T>::instance_pool(const CONTEXT &ctx, int capacity, const ARG &... a)
+    : container<T>(ctx, a...)
+{
+    _transforms.reserve(capacity);
+    _owners.reserve(capacity);
+    _slots.reserve(capacity);
+}
+
+template <typename T>
+typename instance_pool<T>::handle instance_pool<T>::spawn(const math::mat4 &transform)
+{
+    uint32_t index = _free;
+    if (index != NONE) {
+        _free = _slots[index].dense;
+    } else {
+        index = uint32_t(_slots.size());
+        _slots.push_back({0, 1});
+    }
+    _slots[index].dense = uint32_t(_transforms.size());
+    _transforms.push_back(transform);
+    _owners.push_back(index);
+    return {index, _slots[index].generation};
+}
+
+template <typename T>
+bool instance_pool<T>::kill(handle h)
+{
+    if (!alive(h)) return false;
+    slot &s = _slots[h.index];
+    uint32_t last = uint32_t(_transforms.size()) - 1;
+    if (s.dense != last) {
+        _transforms[s.dense] = _transforms[last];
+        _owners[s.dense] = _owners[last];
+        _slots[_owners[s.dense]].dense = s.dense;
+    }
+    _transforms.pop_back();
+    _owners.pop_back();
+    if (++s.generation == 0) s.generation = 1;
+    s.dense = _free;
+    _free = h.index;
+    return true;
+}
+
+template <typename T>
+void instance_pool<T>::clear()
+{
+    for (uint32_t owner : _owners) {
+        slot &s = _slots[owner];
+        if (++s.generation == 0) s.generation = 1;
+        s.dense = _free;
+        _free = owner;
+    }
+    _transforms.clear();
+    _owners.clear();
+}
+
+template <typename T>
+bool instance_pool<T>::alive(handle h) const
+{
+    // killing bumps the generation, so only the live instance's handle
+    // matches
+    return h.index < _slots.size() && _slots[h.index].generation == h.generation;
+}
+
+template <typename T>
+math::mat4 *instance_pool<T>::get(handle h)
+{
+    return alive(h) ? &_transforms[_slots[h.index].dense] : nullptr;
+}
+
+template <typename T>
+typename instance_pool<T>::handle instance_pool<T>::handle_at(int i) const
+{
+    uint32_t owner = _owners[i];
+    return {owner, _slots[owner].generation};
+}
 }
 
 #endif  // GDT_INSTANCES_HEADER_INCLUDED
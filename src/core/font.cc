@@ -0,0 +1,123 @@
+#include "font.hh"
+
+#include <cstring>
+
+namespace gdt {
+
+font_metrics::font_metrics(std::string fnt_file)
+{
+    std::ifstream f(fnt_file, std::ios::in);
+    if (!f) throw std::runtime_error("Unable to open font resource file");
+    uint32_t c, x, y, w, h, xoff, yoff, ow, oh;
+    uint32_t n_glyphs, n_kerning_pairs;
+    f >> n_glyphs;
+    while (f.eof() == false && n_glyphs-- > 0) {
+        f >> c >> x >> y >> w >> h >> xoff >> yoff >> ow >> oh;
+        glyph_data g;
+        g.pos.x = x + 12;
+        g.pos.y = y + 12;
+        g.offset.x = xoff;
+        g.offset.y = yoff;
+        g.dim.x = w;
+        g.dim.y = h;
+        g.orig_dim.x = ow;
+        g.orig_dim.y = oh;
+        _glyphs[c] = g;
+    }
+    if (f.eof()) {
+        LOG_WARNING << "Font " << fnt_file << " does not have kerning pairs.";
+        return;
+    }
+    f >> n_kerning_pairs;
+    uint32_t c1, c2;
+    float k;
+    while (f.eof() == false && n_kerning_pairs-- > 0) {
+        f >> c1 >> c2 >> k;
+        _kerning_pairs[c1][c2] = k;
+    }
+}
+
+const font_metrics::glyph_data& font_metrics::get_glyph(int c) const
+{
+    return _glyphs.at(c);
+}
+
+float font_metrics::get_kerning(int c1, int c2) const
+{
+    float ret = 0;
+    if (_kerning_pairs.find(c1) != _kerning_pairs.end()) {
+        if (_kerning_pairs.at(c1).find(c2) != _kerning_pairs.at(c1).end()) {
+            ret = _kerning_pairs.at(c1).at(c2);
+        }
+    }
+    return ret;
+}
+
+void font_metrics::layout(const char* text, float atlas_width, float atlas_height,
+                          frame_vector<gdt::vertex>& vs, frame_vector<uint32_t>& triangles) const
+{
+    const char* p;
+    int32_t xpos, ypos;
+    xpos = ypos = 0;
+    size_t n = strlen(text);
+    vs.reserve(vs.size() + n * 4);
+    triangles.reserve(triangles.size() + n * 6);
+    uint32_t tid = vs.size();
+    float zpos = 0;
+    int prev = -1;
+    for (p = text; *p; p++) {
+        if (*p == '\n') {
+            ypos -= get_glyph(32).orig_dim.y * 1.5;  // whitespace height X line spacing
+            xpos = 0;
+            continue;
+        }
+        zpos += 0.01;
+        const glyph_data& m = get_glyph(*p);
+        gdt::vertex v1, v2, v3, v4;
+
+        static const float BUF = 0;
+        float offv = m.orig_dim.y - m.dim.y - m.offset.y;
+        xpos += m.offset.x;
+
+        v1.position.x = xpos;
+        v1.position.y = ypos + offv;
+        v1.position.z = zpos;
+        v1.uvs.x = (m.pos.x - BUF) / atlas_width;
+        v1.uvs.y = 1.0 - (m.pos.y + m.dim.y + BUF) / atlas_height;
+        vs.push_back(v1);
+
+        v2.position.x = xpos + m.dim.x;
+        v2.position.y = ypos + offv;
+        v2.position.z = zpos;
+        v2.uvs.x = (m.pos.x + m.dim.x + BUF) / atlas_width;
+        v2.uvs.y = 1.0 - (m.pos.y + m.dim.y + BUF) / atlas_height;
+        vs.push_back(v2);
+
+        v3.position.x = xpos + m.dim.x;
+        v3.position.y = ypos + m.dim.y + offv;
+        v3.position.z = zpos;
+        v3.uvs.x = (m.pos.x + m.dim.x + BUF) / atlas_width;
+        v3.uvs.y = 1.0 - (m.pos.y - BUF) / atlas_height;
+        vs.push_back(v3);
+
+        v4.position.x = xpos;
+        v4.position.y = ypos + m.dim.y + offv;
+        v4.position.z = zpos;
+        v4.uvs.x = (m.pos.x - BUF) / atlas_width;
+        v4.uvs.y = 1.0 - (m.pos.y - BUF) / atlas_height;
+        vs.push_back(v4);
+
+        xpos += m.orig_dim.x - m.offset.x - BUF + (prev != -1 ? get_kerning(prev, *p) : 0);
+
+        triangles.push_back(tid + 0);
+        triangles.push_back(tid + 1);
+        triangles.push_back(tid + 2);
+        triangles.push_back(tid + 0);
+        triangles.push_back(tid + 2);
+        triangles.push_back(tid + 3);
+
+        tid = tid + 4;
+        prev = *p;
+    }
+}
+}
@@ -3,22 +3,20 @@
 
 #include <fstream>
 #include <map>
+#include <vector>
 
+#include "arena.hh"
+#include "mesh.hh"
 #include "shaders.hh"
 
 namespace gdt {
 
 /**
-* Font holds resource texture and glyph information needed to create and draw
-* text objects on screen.
-* You would usually use the same font resource instance for a set of text objects
-* and you would usually have a font instance created once for your application or
-* scene lifespan.
-* Font resources provide a text_pipeline material instance for the actual
-* drawing operation of the text shader.
+* Font metrics hold the glyph and kerning information of an SDF font,
+* as read from its FNT file. They have no graphics resources of their own,
+* so you can use them to measure or lay out text without a graphics backend.
 */
-template <typename GRAPHICS>
-class font {
+class font_metrics {
   public:
     struct glyph_data {
         gdt::math::vec2 pos;      // Position in texture
@@ -27,14 +25,12 @@ class font {
         gdt::math::vec2 orig_dim; // Glyph's full dimentions (x and y)
     };
 
-  public:
     /**
-    * Construct a new font resource.
+    * Read font metrics from an FNT file.
     *
-    * @param ctx Context instance implementing graphics_context
-    * @param resource_file Prefix SDF font resource name (for both PNG and FNT files)
+    * @param fnt_file full path to the FNT file
     */
-    font(const graphics_context<GRAPHICS>& ctx, std::string resource_file = "res/fonts/sdf");
+    font_metrics(std::string fnt_file);
 
     /**
     * Returns the glyph descriptor of a character.
@@ -47,6 +43,40 @@ class font {
     */
     float get_kerning(int c1, int c2) const;
 
+    /**
+    * Lay out a string as textured quads, 4 vertices and 2 triangles per
+    * character, using an atlas of the given size for the texture coordinates.
+    * Results are appended to vs and triangles, which only live until the
+    * vertices are uploaded, so they go in the frame arena.
+    */
+    void layout(const char* text, float atlas_width, float atlas_height,
+                frame_vector<gdt::vertex>& vs, frame_vector<uint32_t>& triangles) const;
+
+  private:
+    std::map<int, glyph_data> _glyphs;
+    std::map<int, std::map<int, float>> _kerning_pairs;
+};
+
+/**
+* Font holds resource texture and glyph information needed to create and draw
+* text objects on screen.
+* You would usually use the same font resource instance for a set of text objects
+* and you would usually have a font instance created once for your application or
+* scene lifespan.
+* Font resources provide a text_pipeline material instance for the actual
+* drawing operation of the text shader.
+*/
+template <typename GRAPHICS>
+class font : public font_metrics {
+  public:
+    /**
+    * Construct a new font resource.
+    *
+    * @param ctx Context instance implementing graphics_context
+    * @param resource_file Prefix SDF font resource name (for both PNG and FNT files)
+    */
+    font(const graphics_context<GRAPHICS>& ctx, std::string resource_file = "res/fonts/sdf");
+
     // Simple getters
     float get_atlas_width() const;
     float get_atlas_height() const;
@@ -56,58 +86,21 @@ class font {
   private:
     typename GRAPHICS::texture _atlas;
     typename text_pipeline<GRAPHICS>::material _material;
-    std::map<int, glyph_data> _glyphs;
-    std::map<int, std::map<int, float>> _kerning_pairs;
 
 };
 
 template <typename GRAPHICS>
 font<GRAPHICS>::font(const graphics_context<GRAPHICS>& ctx, std::string resource_file):
+  font_metrics(resource_file+".fnt"),
   _atlas(ctx, resource_file+".png"),
   _material{&_atlas}
 {
-    std::ifstream f(resource_file+".fnt", std::ios::in);
-    if (!f) throw std::runtime_error("Unable to open font resource file");
-    uint32_t c, x, y, w, h, xoff, yoff, ow, oh;
-    uint32_t n_glyphs, n_kerning_pairs;
-    f >> n_glyphs;
-    while (f.eof() == false && n_glyphs-- > 0) {
-        f >> c >> x >> y >> w >> h >> xoff >> yoff >> ow >> oh;
-        glyph_data g;
-        g.pos.x = x + 12;
-        g.pos.y = y + 12;
-        g.offset.x = xoff;
-        g.offset.y = yoff;
-        g.dim.x = w;
-        g.dim.y = h;
-        g.orig_dim.x = ow;
-        g.orig_dim.y = oh;
-        _glyphs[c] = g;
-    }
-    if (f.eof()) {
-        LOG_WARNING << "Font " << resource_file << " does not have kerning pairs.";
-        return;
-    }
-    f >> n_kerning_pairs;
-    uint32_t c1, c2;
-    float k;
-    while (f.eof() == false && n_kerning_pairs-- > 0) {
-        f >> c1 >> c2 >> k;
-        _kerning_pairs[c1][c2] = k;
-    }
 }
 
 /**
 * FONT TEMPLATE IMPLEMENTATION
 */
 
-template <typename GRAPHICS>
-const typename font<GRAPHICS>::glyph_data&
-font<GRAPHICS>::get_glyph(int c) const
-{
-    return _glyphs.at(c);
-}
-
 template <typename GRAPHICS>
 float
 font<GRAPHICS>::get_atlas_width() const
@@ -122,19 +115,6 @@ font<GRAPHICS>::get_atlas_height() const
     return _atlas.height;
 }
 
-template <typename GRAPHICS>
-float
-font<GRAPHICS>::get_kerning(int c1, int c2) const
-{
-    float ret = 0;
-    if (_kerning_pairs.find(c1) != _kerning_pairs.end()) {
-        if (_kerning_pairs.at(c1).find(c2) != _kerning_pairs.at(c1).end()) {
-            ret = _kerning_pairs.at(c1).at(c2);
-        }
-    }
-    return ret;
-}
-
 template <typename GRAPHICS>
 const typename GRAPHICS::texture&
 font<GRAPHICS>::atlas() const
@@ -0,0 +1,292 @@
+#include "hierarchy.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include "animation.hh"
+#include "context.hh"
+#include "jobs.hh"
+
+namespace gdt {
+
+namespace {
+
+// levels smaller than this aren't worth a job
+const int PARALLEL_LEVEL = 4096;
+const int GRAIN = 1024;
+
+// a * b, both affine, so the bottom rows are 0, 0, 0, 1
+void affine_mul(const math::mat4 &a, const math::mat4 &b, math::mat4 &out)
+{
+    out.xx = a.xx * b.xx + a.xy * b.yx + a.xz * b.zx;
+    out.xy = a.xx * b.xy + a.xy * b.yy + a.xz * b.zy;
+    out.xz = a.xx * b.xz + a.xy * b.yz + a.xz * b.zz;
+    out.xw = a.xx * b.xw + a.xy * b.yw + a.xz * b.zw + a.xw;
+    out.yx = a.yx * b.xx + a.yy * b.yx + a.yz * b.zx;
+    out.yy = a.yx * b.xy + a.yy * b.yy + a.yz * b.zy;
+    out.yz = a.yx * b.xz + a.yy * b.yz + a.yz * b.zz;
+    out.yw = a.yx * b.xw + a.yy * b.yw + a.yz * b.zw + a.yw;
+    out.zx = a.zx * b.xx + a.zy * b.yx + a.zz * b.zx;
+    out.zy = a.zx * b.xy + a.zy * b.yy + a.zz * b.zy;
+    out.zz = a.zx * b.xz + a.zy * b.yz + a.zz * b.zz;
+    out.zw = a.zx * b.xw + a.zy * b.yw + a.zz * b.zw + a.zw;
+    out.wx = 0;
+    out.wy = 0;
+    out.wz = 0;
+    out.ww = 1;
+}
+}
+
+transform_hierarchy::transform_hierarchy(int capacity)
+{
+    _parent_of.reserve(capacity);
+    _slot_of.reserve(capacity);
+    _parent.reserve(capacity);
+    _node.reserve(capacity);
+    _local.reserve(capacity);
+    _world.reserve(capacity);
+    _dirty.reserve(capacity);
+    _moved.reserve(capacity);
+}
+
+int transform_hierarchy::add(int parent, const math::mat4 &local)
+{
+    if (parent != NONE && (parent < 0 || parent >= int(_slot_of.size()) || _slot_of[parent] < 0)) {
+        throw std::runtime_error("transform_hierarchy: no such parent node");
+    }
+    int node;
+    if (!_free.empty()) {
+        node = _free.back();
+        _free.pop_back();
+    } else {
+        node = int(_parent_of.size());
+        _parent_of.push_back(NONE);
+        _slot_of.push_back(-1);
+    }
+    _parent_of[node] = parent;
+    _slot_of[node] = int(_node.size());
+    _parent.push_back(NONE);
+    _node.push_back(node);
+    _local.push_back(local);
+    _world.push_back(local);
+    _dirty.push_back(1);
+    _moved.push_back(0);
+    _count++;
+    _unsorted = true;
+    return node;
+}
+
+void transform_hierarchy::remove(int node)
+{
+    if (node < 0 || node >= int(_slot_of.size()) || _slot_of[node] == -1) return;
+    detach(node);
+    _node[_slot_of[node]] = NONE;
+    _slot_of[node] = -1;
+    _removed.push_back(node);
+    _count--;
+    _unsorted = true;
+}
+
+void transform_hierarchy::set_parent(int node, int parent)
+{
+    for (int p = parent; p != NONE; p = _parent_of[p]) {
+        if (p == node) throw std::runtime_error("transform_hierarchy: parenting makes a cycle");
+    }
+    _parent_of[node] = parent;
+    _dirty[_slot_of[node]] = 1;
+    _unsorted = true;
+}
+
+void transform_hierarchy::follow(int node, const math::mat4 *transform)
+{
+    _followers.push_back({node, transform});
+    _dirty[_slot_of[node]] = 1;
+}
+
+void transform_hierarchy::bind(int node, math::mat4 *transform)
+{
+    _bindings.push_back({node, transform});
+    // written out on the next update even if the node doesn't move
+    _dirty[_slot_of[node]] = 1;
+}
+
+void transform_hierarchy::attach(int node, const animixer *mixer, int bone)
+{
+    if (bone < 0 || bone >= mixer->get_skeleton().n_bones()) {
+        throw std::runtime_error("transform_hierarchy: no such bone");
+    }
+    // grouped by mixer, so every pose is computed once
+    auto at = std::upper_bound(
+        _attachments.begin(), _attachments.end(), mixer,
+        [](const animixer *m, const attachment &a) { return std::less<const animixer *>()(m, a.mixer); });
+    _attachments.insert(at, {mixer, bone, node});
+    _dirty[_slot_of[node]] = 1;
+}
+
+void transform_hierarchy::detach(int node)
+{
+    _followers.erase(std::remove_if(_followers.begin(), _followers.end(),
+                                    [node](const follower &f) { return f.node == node; }),
+                     _followers.end());
+    _bindings.erase(std::remove_if(_bindings.begin(), _bindings.end(),
+                                   [node](const binding &b) { return b.node == node; }),
+                    _bindings.end());
+    _attachments.erase(std::remove_if(_attachments.begin(), _attachments.end(),
+                                      [node](const attachment &a) { return a.node == node; }),
+                       _attachments.end());
+}
+
+void transform_hierarchy::update(const core_context &ctx)
+{
+    update(ctx.jobs);
+}
+
+void transform_hierarchy::update(job_system *jobs)
+{
+    if (_unsorted) sort();
+    sample();
+    propagate(jobs);
+    for (const binding &b : _bindings) {
+        int s = _slot_of[b.node];
+        if (_moved[s]) *b.transform = _world[s].transpose();
+    }
+}
+
+// Lays the nodes out breadth first: the roots in their current order,
+// then their children, and so on. Nodes left unvisited are below a
+// removed node and go too.
+void transform_hierarchy::sort()
+{
+    int ids = int(_parent_of.size());
+    int slots = int(_node.size());
+
+    std::vector<int> first(ids + 1, 0);
+    for (int s = 0; s < slots; s++) {
+        int node = _node[s];
+        if (node != NONE && _parent_of[node] != NONE) first[_parent_of[node] + 1]++;
+    }
+    for (int i = 0; i < ids; i++) first[i + 1] += first[i];
+    std::vector<int> children(first[ids]);
+    std::vector<int> next(first.begin(), first.end() - 1);
+    for (int s = 0; s < slots; s++) {
+        int node = _node[s];
+        if (node != NONE && _parent_of[node] != NONE) children[next[_parent_of[node]]++] = node;
+    }
+
+    std::vector<int> order;
+    order.reserve(_count);
+    for (int s = 0; s < slots; s++) {
+        int node = _node[s];
+        if (node != NONE && _parent_of[node] == NONE) order.push_back(node);
+    }
+    _levels.assign(1, 0);
+    for (size_t begin = 0; begin < order.size();) {
+        size_t end = order.size();
+        for (size_t i = begin; i < end; i++) {
+            int p = order[i];
+            // a removed parent's slot is gone, so its children never get here
+            order.insert(order.end(), children.begin() + first[p], children.begin() + first[p + 1]);
+        }
+        _levels.push_back(int(end));
+        begin = end;
+    }
+
+    int n = int(order.size());
+    array<int> parent(n);
+    array<int> nodes(order.begin(), order.end());
+    array<math::mat4> local(n);
+    array<math::mat4> world(n);
+    array<uint8_t> dirty(n);
+    for (int t = 0; t < n; t++) {
+        int s = _slot_of[order[t]];
+        local[t] = _local[s];
+        world[t] = _world[s];
+        dirty[t] = _dirty[s];
+        _node[s] = NONE;
+    }
+    // whatever is still in a slot was below a removed node
+    for (int s = 0; s < slots; s++) {
+        int node = _node[s];
+        if (node == NONE) continue;
+        detach(node);
+        _slot_of[node] = -1;
+        _free.push_back(node);
+        _count--;
+    }
+    for (int t = 0; t < n; t++) _slot_of[order[t]] = t;
+    for (int t = 0; t < n; t++) {
+        int p = _parent_of[order[t]];
+        parent[t] = p == NONE ? NONE : _slot_of[p];
+    }
+    _free.insert(_free.end(), _removed.begin(), _removed.end());
+    _removed.clear();
+
+    _parent.swap(parent);
+    _node.swap(nodes);
+    _local.swap(local);
+    _world.swap(world);
+    _dirty.swap(dirty);
+    _moved.assign(n, 0);
+    _unsorted = false;
+}
+
+// Pulls in the local transforms of followed instances and attached
+// bones, only dirtying the nodes whose transform actually changed.
+void transform_hierarchy::sample()
+{
+    for (const follower &f : _followers) {
+        int s = _slot_of[f.node];
+        math::mat4 local = f.transform->transpose();
+        if (memcmp(&local, &_local[s], sizeof(local)) != 0) {
+            _local[s] = local;
+            _dirty[s] = 1;
+        }
+    }
+    transient_frame pose;
+    const animixer *posed = nullptr;
+    for (const attachment &a : _attachments) {
+        if (a.mixer != posed) {
+            a.mixer->pose(pose);
+            posed = a.mixer;
+        }
+        int s = _slot_of[a.node];
+        const math::mat4 &local = pose.bone_transforms[a.bone];
+        if (memcmp(&local, &_local[s], sizeof(local)) != 0) {
+            _local[s] = local;
+            _dirty[s] = 1;
+        }
+    }
+}
+
+void transform_hierarchy::propagate(job_system *jobs)
+{
+    const int *parent = _parent.data();
+    const math::mat4 *local = _local.data();
+    math::mat4 *world = _world.data();
+    uint8_t *dirty = _dirty.data();
+    uint8_t *moved = _moved.data();
+
+    int roots = _levels.size() > 1 ? _levels[1] : 0;
+    for (int s = 0; s < roots; s++) {
+        moved[s] = dirty[s];
+        if (dirty[s]) world[s] = local[s];
+        dirty[s] = 0;
+    }
+    auto step = [=](int s) {
+        moved[s] = dirty[s] | moved[parent[s]];
+        if (moved[s]) affine_mul(world[parent[s]], local[s], world[s]);
+        dirty[s] = 0;
+    };
+    for (size_t l = 1; l + 1 < _levels.size(); l++) {
+        int begin = _levels[l];
+        int end = _levels[l + 1];
+        if (jobs && end - begin >= PARALLEL_LEVEL) {
+            jobs->parallel_for(begin, end, step, GRAIN);
+        } else {
+            for (int s = begin; s < end; s++) step(s);
+        }
+    }
+}
+}
@@ -0,0 +1,189 @@
+#ifndef GDT_HIERARCHY_HEADER_INCLUDED
+#define GDT_HIERARCHY_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+#include "math.hh"
+#include "utils/memory.hh"
+
+namespace gdt {
+
+class animixer;
+class job_system;
+struct core_context;
+
+/**
+ * Parent and child relations between transforms, for things that move
+ * along with others: a turret on a vehicle, a weapon in a hand.
+ *
+ * Nodes are kept sorted by depth, roots first, every node after its
+ * parent and siblings next to each other, as flat arrays of parent
+ * indices and local and world matrices. Updating the world matrices is
+ * then a single pass over the arrays, one level at a time, and the
+ * nodes of a level, all in different subtrees, are split between the
+ * job system's threads:
+ *
+ *     gdt::transform_hierarchy _nodes;
+ *     ...
+ *     int tank = _nodes.add();
+ *     int turret = _nodes.add(tank, gdt::math::mat4::translation({0, 2, 0}));
+ *     _nodes.follow(tank, _tank.get_transform_ptr());
+ *     _nodes.bind(turret, _turret.get_transform_ptr());
+ *     ...
+ *     _nodes.set_local(turret, gdt::math::mat4::rotation_quat(_aim));
+ *     _nodes.update(ctx);
+ *
+ * follow reads a node's local transform from a driven instance, bind
+ * writes a node's world transform out to one, both in the transposed
+ * layout instances use. attach makes a node follow a bone of an
+ * animixer's current pose, so children of the node follow the bone:
+ *
+ *     int hand = _nodes.add(imrod);
+ *     _nodes.attach(hand, _imrod.get_animatable_ptr(),
+ *                   _imrod.get_animatable_ptr()->get_skeleton().find_bone("item.R"));
+ *     int sword = _nodes.add(hand, _grip);
+ *
+ * Only nodes whose local transform changed, and what is below them,
+ * are recomputed. Transforms are expected to be affine, as everything
+ * placed in a scene is.
+ *
+ * Adding, removing and reparenting nodes re-sorts the arrays on the
+ * next update. Node ids stay the same, but a removed node's id is
+ * reused by later adds.
+ */
+class transform_hierarchy {
+  public:
+    static constexpr int NONE = -1;
+
+    explicit transform_hierarchy(int capacity = 0);
+
+    /**
+     * Add a node.
+     *
+     * @param parent the parent node, NONE for a root
+     * @return the new node
+     */
+    int add(int parent = NONE, const math::mat4 &local = math::mat4::id());
+
+    /** Remove a node, and everything below it. Does nothing if it's gone already. */
+    void remove(int node);
+
+    /** Move node, with everything below it, under parent. */
+    void set_parent(int node, int parent);
+
+    int parent(int node) const
+    {
+        return _parent_of[node];
+    }
+
+    /** The number of nodes. */
+    int size() const
+    {
+        return _count;
+    }
+
+    void set_local(int node, const math::mat4 &local)
+    {
+        int s = _slot_of[node];
+        _local[s] = local;
+        _dirty[s] = 1;
+    }
+
+    const math::mat4 &local(int node) const
+    {
+        return _local[_slot_of[node]];
+    }
+
+    /** The node's world transform as of the last update. */
+    const math::mat4 &world(int node) const
+    {
+        return _world[_slot_of[node]];
+    }
+
+    /** Whether the last update changed the node's world transform. */
+    bool moved(int node) const
+    {
+        return _moved[_slot_of[node]];
+    }
+
+    /**
+     * Take the node's local transform from an instance transform, such
+     * as get_transform_ptr of a driven instance, on every update.
+     */
+    void follow(int node, const math::mat4 *transform);
+
+    /** Write the node's world transform to an instance transform on every update. */
+    void bind(int node, math::mat4 *transform);
+
+    /**
+     * Take the node's local transform from a bone of mixer's current
+     * pose, on every update. The node's parent should be the node
+     * placing the animated model.
+     */
+    void attach(int node, const animixer *mixer, int bone);
+
+    /** Stop following, binding or attaching the node. */
+    void detach(int node);
+
+    /** Recompute the world transforms, using ctx.jobs. */
+    void update(const core_context &ctx);
+
+    /**
+     * Recompute the world transforms.
+     *
+     * @param jobs the job system to split levels with, or nullptr
+     */
+    void update(job_system *jobs = nullptr);
+
+  private:
+    template <typename T>
+    using array = std::vector<T, tagged_allocator<T, memory::INSTANCES>>;
+
+    struct follower {
+        int node;
+        const math::mat4 *transform;
+    };
+
+    struct binding {
+        int node;
+        math::mat4 *transform;
+    };
+
+    struct attachment {
+        const animixer *mixer;
+        int bone;
+        int node;
+    };
+
+    void sort();
+    void sample();
+    void propagate(job_system *jobs);
+
+    // by node id
+    std::vector<int> _parent_of;
+    std::vector<int> _slot_of;
+    std::vector<int> _free;
+    // removed ids, reused once sort has removed their children too
+    std::vector<int> _removed;
+
+    // by depth sorted slot
+    array<int> _parent;
+    array<int> _node;
+    array<math::mat4> _local;
+    array<math::mat4> _world;
+    array<uint8_t> _dirty;
+    array<uint8_t> _moved;
+    // the first slot of every level, and the end of the last
+    std::vector<int> _levels;
+
+    std::vector<follower> _followers;
+    std::vector<binding> _bindings;
+    std::vector<attachment> _attachments;
+
+    int _count = 0;
+    bool _unsorted = false;
+};
+}
+
+#endif  // GDT_HIERARCHY_HEADER_INCLUDED
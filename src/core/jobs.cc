@@ -0,0 +1,223 @@
+#include "jobs.hh"
+
+#include <string>
+
+#include "logger.hh"
+#include "utils/profiler.hh"
+
+namespace gdt {
+
+// Worker threads remember which pool they belong to, any other thread
+// shares queue 0.
+static thread_local const job_system* current_pool = nullptr;
+static thread_local int current_queue = 0;
+
+// Counter generations, unique across all counters and pools.
+static std::atomic<uint64_t> generations{0};
+
+void job_system::queue::push_back(job&& j)
+{
+    if (size == jobs.size()) {
+        // grow, unrolling the ring so it starts at 0 again
+        std::vector<job> grown(std::max<size_t>(64, jobs.size() * 2));
+        for (size_t i = 0; i < size; i++) {
+            grown[i] = std::move(jobs[(front + i) % jobs.size()]);
+        }
+        jobs.swap(grown);
+        front = 0;
+    }
+    jobs[(front + size) % jobs.size()] = std::move(j);
+    size++;
+}
+
+bool job_system::queue::pop_back(job& j)
+{
+    if (size == 0) return false;
+    size--;
+    j = std::move(jobs[(front + size) % jobs.size()]);
+    return true;
+}
+
+bool job_system::queue::pop_front(job& j)
+{
+    if (size == 0) return false;
+    j = std::move(jobs[front]);
+    front = (front + 1) % jobs.size();
+    size--;
+    return true;
+}
+
+job_system::job_system(int workers)
+{
+    if (workers < 0) workers = std::max(0, int(std::thread::hardware_concurrency()) - 1);
+    _workers = workers;
+    _queues = std::make_unique<queue[]>(workers + 1);
+    _threads.reserve(workers);
+    for (int i = 0; i < workers; i++) {
+        _threads.emplace_back([this, i]() { work(i + 1); });
+    }
+    LOG_DEBUG << "job system started with " << workers << " workers";
+}
+
+job_system::~job_system()
+{
+    {
+        std::lock_guard<std::mutex> guard(_sleep_lock);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& t : _threads) t.join();
+}
+
+int job_system::thread_index() const
+{
+    return current_pool == this ? current_queue : 0;
+}
+
+void job_system::push(job&& j)
+{
+    queue& q = _queues[thread_index()];
+    {
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.push_back(std::move(j));
+    }
+    _queued.fetch_add(1);
+    // only pay for a notify when someone is actually asleep
+    if (_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> guard(_sleep_lock);
+        _wake.notify_one();
+    }
+}
+
+bool job_system::take(job& j)
+{
+    if (_queued.load(std::memory_order_relaxed) == 0) return false;
+    int n = workers() + 1;
+    int own = thread_index();
+    {
+        queue& q = _queues[own];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.pop_back(j)) {
+            _queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (int i = 1; i < n; i++) {
+        queue& q = _queues[(own + i) % n];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.pop_front(j)) {
+            _queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void job_system::count(job_counter& c)
+{
+    // mostly the counter is busy already and keeps its generation
+    int pending = c._pending.load();
+    while (pending > 0) {
+        if (c._pending.compare_exchange_weak(pending, pending + 1)) return;
+    }
+    // Starting over from zero. The new generation goes in before the
+    // counter shows busy, and under the lock run_after looks at both with,
+    // so no job waits on a generation that has finished already.
+    std::lock_guard<std::mutex> guard(_waiting_lock);
+    pending = c._pending.load();
+    while (true) {
+        if (pending == 0) c._generation.store(generations.fetch_add(1) + 1);
+        if (c._pending.compare_exchange_weak(pending, pending + 1)) return;
+    }
+}
+
+void job_system::run(job_counter& c, job_function f)
+{
+    count(c);
+    push({std::move(f), &c});
+}
+
+void job_system::run_after(job_counter& dependency, job_counter& c, job_function f)
+{
+    count(c);
+    job j{std::move(f), &c};
+    {
+        std::lock_guard<std::mutex> guard(_waiting_lock);
+        _waiting_count.fetch_add(1);
+        if (!dependency.is_done()) {
+            _waiting.push_back({dependency._generation.load(), std::move(j)});
+            return;
+        }
+        _waiting_count.fetch_sub(1);
+    }
+    push(std::move(j));
+}
+
+void job_system::execute(job& j)
+{
+    j.run();
+    j.run.reset();
+    finish(j.counter);
+}
+
+void job_system::finish(job_counter* c)
+{
+    uint64_t generation = c->_generation.load();
+    if (c->_pending.fetch_sub(1) != 1) return;
+    // Once the counter is at zero its owner may return from wait() and
+    // destroy or restart it, so from here on it isn't touched at all.
+    if (_waiting_count.load() == 0) return;
+    std::lock_guard<std::mutex> guard(_waiting_lock);
+    for (size_t i = 0; i < _waiting.size();) {
+        if (_waiting[i].dependency != generation) {
+            i++;
+            continue;
+        }
+        push(std::move(_waiting[i].j));
+        _waiting[i] = std::move(_waiting.back());
+        _waiting.pop_back();
+        _waiting_count.fetch_sub(1);
+    }
+}
+
+void job_system::wait(job_counter& c)
+{
+    job j;
+    while (!c.is_done()) {
+        if (take(j)) {
+            execute(j);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void job_system::work(int index)
+{
+    current_pool = this;
+    current_queue = index;
+    std::string name = "worker " + std::to_string(index);
+    profiler::set_thread_name(name.c_str());
+    job j;
+    while (true) {
+        if (take(j)) {
+            execute(j);
+            continue;
+        }
+        // a short spin catches the next batch of jobs without a round trip
+        // through the scheduler
+        bool found = false;
+        for (int spin = 0; spin < 64 && !found; spin++) {
+            std::this_thread::yield();
+            found = _queued.load(std::memory_order_relaxed) > 0;
+        }
+        if (found) continue;
+
+        std::unique_lock<std::mutex> lock(_sleep_lock);
+        _sleeping.fetch_add(1);
+        _wake.wait(lock, [this]() { return _stop || _queued.load() > 0; });
+        _sleeping.fetch_sub(1);
+        if (_stop) return;
+    }
+}
+}
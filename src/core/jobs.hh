@@ -0,0 +1,187 @@
+#ifndef GDT_JOBS_HEADER_INCLUDED
+#define GDT_JOBS_HEADER_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "callback.hh"
+
+namespace gdt {
+
+class job_counter;
+
+/**
+ * A job waiting in a queue: the function to run and the counter to
+ * decrement once it's done.
+ */
+struct job {
+    inplace_function<void()> run;
+    job_counter* counter = nullptr;
+};
+
+/**
+ * Counts the jobs started with it that haven't finished yet.
+ * Wait on it with job_system::wait, or make more jobs depend on it
+ * with job_system::run_after.
+ *
+ * A counter has to outlive the jobs counted with it.
+ */
+class job_counter {
+  public:
+    job_counter() = default;
+    job_counter(const job_counter&) = delete;
+    job_counter& operator=(const job_counter&) = delete;
+
+    bool is_done() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class job_system;
+    std::atomic<int> _pending{0};
+    // changes every time the counter starts over from zero
+    std::atomic<uint64_t> _generation{0};
+};
+
+/**
+ * A work stealing thread pool. The application creates one and hands
+ * it to everyone through core_context::jobs:
+ *
+ *     gdt::job_counter done;
+ *     ctx.jobs->run(done, [this]() { _navmesh.rebuild(); });
+ *     ctx.jobs->run(done, [this]() { _ai.plan(); });
+ *     ...
+ *     ctx.jobs->wait(done);
+ *
+ * Every worker has a queue of its own. Workers take their newest job
+ * first and steal the oldest job of another worker when they run out.
+ * A thread waiting on a counter doesn't block, it runs jobs until the
+ * counter gets to zero. So jobs may start and wait on more jobs, and a
+ * pool with no workers at all still works, on the waiting thread.
+ *
+ * Jobs that must run after others go through run_after:
+ *
+ *     ctx.jobs->run_after(animated, skinned, [this]() { upload_bones(); });
+ *
+ * and loops over many independent items through parallel_for, which
+ * splits the range into chunks:
+ *
+ *     ctx.jobs->parallel_for(0, int(_crates.size()), [&](int i) {
+ *         _crates[i].update(ctx);
+ *     });
+ *
+ * Job functions are stored in place, like timeline callbacks, so
+ * starting a job doesn't allocate. Capture pointers, not big objects.
+ */
+class job_system {
+  public:
+    using job_function = inplace_function<void()>;
+
+    /**
+     * @param workers number of worker threads, -1 for one less than
+     *        the number of hardware threads, leaving one for the main thread
+     */
+    explicit job_system(int workers = -1);
+    ~job_system();
+    job_system(const job_system&) = delete;
+    job_system& operator=(const job_system&) = delete;
+
+    int workers() const { return _workers; }
+
+    /** 0 on threads outside the pool, 1 to workers() on its workers. */
+    int thread_index() const;
+
+    /** Start f, counted by c. */
+    void run(job_counter& c, job_function f);
+
+    /** Start f, counted by c, once all the jobs counted by dependency are done. */
+    void run_after(job_counter& dependency, job_counter& c, job_function f);
+
+    /** Run jobs until c gets to zero. */
+    void wait(job_counter& c);
+
+    /**
+     * Call f(i) for every i in [begin, end), in chunks of grain
+     * indices, and return once they are all done.
+     *
+     * @param grain indices per job, 0 to split the range evenly
+     *        between the threads, a few chunks each
+     */
+    template <typename F>
+    void parallel_for(int begin, int end, F&& f, int grain = 0);
+
+  private:
+    // a growable ring of jobs, the owner pushes and pops at the back
+    // and thieves take from the front
+    struct queue {
+        std::mutex lock;
+        std::vector<job> jobs;
+        size_t front = 0;
+        size_t size = 0;
+
+        void push_back(job&& j);
+        bool pop_back(job& j);
+        bool pop_front(job& j);
+    };
+
+    // jobs wait on a generation of their dependency, not on its address,
+    // which a new counter may take over once the old one is done
+    struct waiting_job {
+        uint64_t dependency;
+        job j;
+    };
+
+    void count(job_counter& c);
+    void push(job&& j);
+    bool take(job& j);
+    void execute(job& j);
+    void finish(job_counter* c);
+    void work(int index);
+
+    // queue 0 belongs to all threads outside the pool, 1.. to the workers
+    int _workers = 0;
+    std::unique_ptr<queue[]> _queues;
+    std::vector<std::thread> _threads;
+    std::atomic<int> _queued{0};
+
+    std::mutex _sleep_lock;
+    std::condition_variable _wake;
+    std::atomic<int> _sleeping{0};
+    bool _stop = false;
+
+    std::mutex _waiting_lock;
+    std::vector<waiting_job> _waiting;
+    std::atomic<int> _waiting_count{0};
+};
+
+// IMPLEMENTATIONS
+
+template <typename F>
+void job_system::parallel_for(int begin, int end, F&& f, int grain)
+{
+    int n = end - begin;
+    if (n <= 0) return;
+    if (grain <= 0) grain = std::max(1, n / ((workers() + 1) * 4));
+    if (workers() == 0 || n <= grain) {
+        for (int i = begin; i < end; i++) f(i);
+        return;
+    }
+    job_counter c;
+    auto* fp = &f;
+    for (int first = begin + grain; first < end; first += grain) {
+        int last = std::min(end, first + grain);
+        run(c, [fp, first, last]() {
+            for (int i = first; i < last; i++) (*fp)(i);
+        });
+    }
+    // the calling thread takes the first chunk itself
+    for (int i = begin; i < begin + grain; i++) f(i);
+    wait(c);
+}
+}
+
+#endif  // GDT_JOBS_HEADER_INCLUDED
@@ -5,6 +5,7 @@
 #include <memory>
 #include <vector>
 
+#include "bounds.hh"
 #include "math.hh"
 
 namespace gdt {
@@ -277,6 +278,19 @@ struct mesh {
             vtx.uvs = math::vec2(vtx.uvs.x, vtx.uvs.y / scale);
         }
     }
+
+    /** The box around all vertices, a point at the origin if there are none. */
+    math::aabb calc_bounds() const
+    {
+        math::aabb b;
+        for (const auto& v : vertices) {
+            b.expand(v.position);
+        }
+        if (b.is_empty()) {
+            b = math::aabb(math::vec3(), math::vec3());
+        }
+        return b;
+    }
 };
 
 struct model {
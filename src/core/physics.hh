@@ -73,7 +73,12 @@ class sphere_proxy : public container<DRAWABLE>,
 };
 
 /**
- * TODO: document me
+ * Drives a transform from a rigid body in the physics world.
+ *
+ * With variable updates, update copies the body's transform every frame.
+ * In fixed update mode, call fixed_update after each physics step and
+ * interpolate once per frame, so the rendered transform is blended between
+ * the last two steps instead of jumping at the simulation rate.
  */
 template <typename PHYSICS, typename SHAPED>
 class rigid_body_driver {
@@ -86,13 +91,46 @@ class rigid_body_driver {
                       math::mat4* transform,
                       SHAPED* shaped, initializer i);
     void update();
+    void fixed_update();
+    void interpolate(float alpha);
     void reuse(const physics_context<PHYSICS>& ctx, math::mat4* transform);
 
+    /** interpolate, for all the drivers of a gdt::driven in one loop. */
+    static void interpolate_all(span<rigid_body_driver> drivers, float alpha);
+
+    /**
+     * Drive another transform from now on, for drivers kept where
+     * transforms move around, like gdt::ecs components.
+     */
+    void retarget(math::mat4* transform)
+    {
+        _driven_transform = transform;
+    }
+
   private:
     math::mat4* _driven_transform;
     typename PHYSICS::body _body;
+    math::mat4 _previous;
+    math::mat4 _current;
 };
 
+/**
+ * Blend two rigid (rotation and translation only) transforms, stored
+ * the way GL expects them. The rotation is blended linearly and then
+ * orthonormalized, which is accurate for the small rotations between
+ * consecutive simulation steps.
+ */
+inline math::mat4 blend_rigid_transforms(const math::mat4& a, const math::mat4& b, float t)
+{
+    auto lerp = [t](float from, float to) { return from + (to - from) * t; };
+    math::vec3 x = math::vec3(lerp(a.xx, b.xx), lerp(a.xy, b.xy), lerp(a.xz, b.xz)).normalize();
+    math::vec3 y = math::vec3(lerp(a.yx, b.yx), lerp(a.yy, b.yy), lerp(a.yz, b.yz));
+    math::vec3 z = x.cross(y).normalize();
+    y = z.cross(x);
+    math::vec3 p = math::vec3(lerp(a.wx, b.wx), lerp(a.wy, b.wy), lerp(a.wz, b.wz));
+    return math::mat4(x.x, x.y, x.z, 0, y.x, y.y, y.z, 0, z.x, z.y, z.z, 0, p.x, p.y, p.z, 1);
+}
+
 //------------------------------------------------------------------------------------------------
 // BOX_PROXY
 //------------------------------------------------------------------------------------------------
@@ -172,6 +210,7 @@ rigid_body_driver<PHYSICS, SHAPED>::rigid_body_driver(const physics_context<PHYS
     _body =
         shaped->get_physics()->make_rigid_body(shaped->get_shape(), i.pos, i.r, shaped->get_mass());
     *_driven_transform = math::mat4::translation(i.pos).transpose();
+    _previous = _current = *_driven_transform;
 }
 
 template <typename PHYSICS, typename SHAPED>
@@ -180,6 +219,28 @@ void rigid_body_driver<PHYSICS, SHAPED>::update()
     _body.update_transform(_driven_transform);
 }
 
+template <typename PHYSICS, typename SHAPED>
+void rigid_body_driver<PHYSICS, SHAPED>::fixed_update()
+{
+    _previous = _current;
+    _body.update_transform(&_current);
+}
+
+template <typename PHYSICS, typename SHAPED>
+void rigid_body_driver<PHYSICS, SHAPED>::interpolate(float alpha)
+{
+    *_driven_transform = blend_rigid_transforms(_previous, _current, alpha);
+}
+
+template <typename PHYSICS, typename SHAPED>
+void rigid_body_driver<PHYSICS, SHAPED>::interpolate_all(span<rigid_body_driver> drivers,
+                                                         float alpha)
+{
+    for (rigid_body_driver& d : drivers) {
+        *d._driven_transform = blend_rigid_transforms(d._previous, d._current, alpha);
+    }
+}
+
 template <typename PHYSICS, typename SHAPED>
 void rigid_body_driver<PHYSICS, SHAPED>::reuse(const physics_context<PHYSICS>& ctx,
                                                math::mat4* transform)
@@ -188,6 +249,7 @@ void rigid_body_driver<PHYSICS, SHAPED>::reuse(const physics_context<PHYSICS>& c
                                 transform->wz);  // = get position from transform
     _body.reposition(pos);
     *_driven_transform = math::mat4::translation(pos).transpose();
+    _previous = _current = *_driven_transform;
 }
 };
 #endif  // GDT_CONSTRUCTS_RIGID_BODY_INCLUDED
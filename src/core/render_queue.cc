@@ -0,0 +1,35 @@
+#include "render_queue.hh"
+
+#include <utility>
+
+namespace gdt {
+
+void radix_sort(sort_entry *entries, sort_entry *scratch, int n)
+{
+    if (n < 2) return;
+    // all eight histograms in a single pass over the keys
+    uint32_t counts[8][256] = {};
+    for (int i = 0; i < n; i++) {
+        uint64_t key = entries[i].key;
+        for (int b = 0; b < 8; b++) counts[b][(key >> (b * 8)) & 0xff]++;
+    }
+    sort_entry *from = entries;
+    sort_entry *to = scratch;
+    for (int b = 0; b < 8; b++) {
+        uint32_t *count = counts[b];
+        // every key has the same byte here, nothing moves
+        if (count[(from[0].key >> (b * 8)) & 0xff] == uint32_t(n)) continue;
+        uint32_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            uint32_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++) {
+            to[count[(from[i].key >> (b * 8)) & 0xff]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != entries) memcpy(entries, from, sizeof(sort_entry) * n);
+}
+}
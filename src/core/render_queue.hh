@@ -0,0 +1,358 @@
+#ifndef GDT_RENDER_QUEUE_HEADER_INCLUDED
+#define GDT_RENDER_QUEUE_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "context.hh"
+#include "culling.hh"
+#include "imgui/imgui.h"
+#include "utils/memory.hh"
+
+namespace gdt {
+
+/**
+ * A draw waiting in a gdt::render_queue, by its sort key.
+ */
+struct sort_entry {
+    uint64_t key;
+    uint32_t index;
+};
+
+/**
+ * Sort n entries by key, a byte at a time from the lowest, keeping
+ * entries with equal keys in the order they were given. Bytes all the
+ * keys share are skipped.
+ *
+ * @param scratch room for another n entries
+ */
+void radix_sort(sort_entry *entries, sort_entry *scratch, int n);
+
+/**
+ * Collects the draws of a frame and issues them sorted by state, so
+ * that pipelines are used and materials bound once for all the draws
+ * sharing them, instead of every time the drawing code switches between
+ * them.
+ *
+ * Every draw goes in with a pass, the pipeline and material it needs and
+ * its distance from the camera. These make its 64 bit sort key. Passes
+ * come first, in increasing order, then opaque draws grouped by pipeline
+ * and then material, nearest first within a group. Translucent draws go
+ * last in their pass, farthest first, so they blend over what's behind
+ * them:
+ *
+ *     _queue.clear();
+ *     _queue.submit(0, _pipeline, &_rock_material, _rocks);
+ *     _queue.submit(0, _pipeline, &_crate_material, _crates, gdt::culling::frustum);
+ *     _queue.submit(0, _pipeline, &_glass_material, _window,
+ *                   (_window_pos - _camera.entity().pos).length(),
+ *                   my_app::render_queue::order::translucent);
+ *     ...
+ *     _pipeline.use(ctx).set_camera(_camera);
+ *     _queue.execute(ctx);
+ *
+ * Pipelines and materials get their part of the key the first time the
+ * queue sees them in a frame, up to 4096 pipelines and 4095 materials
+ * per frame. Draws with the same key are issued in the order they were
+ * submitted.
+ *
+ * Pipelines keep their uniforms, like the camera, between draws, so set
+ * those before executing the queue. Executing a single pass at a time,
+ * see execute, lets a renderer change targets in between.
+ *
+ * get_stats tells how many pipeline and material changes the queue made
+ * in the frame, next to how many the same draws would have taken in the
+ * order they were submitted.
+ */
+template <typename GRAPHICS>
+class render_queue {
+  public:
+    enum class order { opaque, translucent };
+
+    struct stats {
+        int draws = 0;
+        int pipeline_changes = 0;
+        int material_changes = 0;
+        // the same draws, issued as submitted
+        int unsorted_pipeline_changes = 0;
+        int unsorted_material_changes = 0;
+    };
+
+    static constexpr int MAX_PASSES = 256;
+    static constexpr int MAX_PIPELINES = 4096;
+    static constexpr int MAX_MATERIALS = 4095;
+
+    /**
+     * Queue drawing all of what's instances with pipeline p.
+     *
+     * @param pass the pass to draw in, from 0 to MAX_PASSES - 1
+     * @param m the material to bind, or nullptr to leave whatever is bound
+     * @param depth distance from the camera
+     */
+    template <typename PIPELINE, typename SOMETHING>
+    void submit(int pass, const PIPELINE &p, const typename PIPELINE::material *m,
+                const SOMETHING &what, float depth = 0, order o = order::opaque);
+
+    /**
+     * submit, leaving out the instances c culls when the draw is issued,
+     * see gdt::culling.
+     */
+    template <typename PIPELINE, typename SOMETHING>
+    void submit(int pass, const PIPELINE &p, const typename PIPELINE::material *m,
+                const SOMETHING &what, culling c, float depth = 0, order o = order::opaque);
+
+    /** Issue every queued draw. */
+    void execute(const graphics_context<GRAPHICS> &ctx);
+
+    /** Issue the draws queued in one pass only. */
+    void execute(const graphics_context<GRAPHICS> &ctx, int pass);
+
+    /** Drop the queued draws and start counting a new frame. */
+    void clear();
+
+    int size() const
+    {
+        return int(_items.size());
+    }
+
+    const stats &get_stats() const
+    {
+        return _stats;
+    }
+
+    void imgui();
+
+    static uint64_t make_key(int pass, int pipeline, int material, float depth, order o);
+
+  private:
+    template <typename T>
+    using array = std::vector<T, tagged_allocator<T, memory::INSTANCES>>;
+
+    struct item {
+        const void *pipeline;
+        const void *material;
+        const void *what;
+        void (*use)(const void *pipeline, const graphics_context<GRAPHICS> &ctx);
+        void (*bind)(const void *pipeline, const void *material);
+        void (*draw)(const void *pipeline, const void *what, culling c);
+        culling cull;
+    };
+
+    template <typename PIPELINE>
+    static void use_pipeline(const void *p, const graphics_context<GRAPHICS> &ctx)
+    {
+        static_cast<const PIPELINE *>(p)->use(ctx);
+    }
+
+    template <typename PIPELINE>
+    static void bind_material(const void *p, const void *m)
+    {
+        static_cast<const PIPELINE *>(p)->set_material(
+            *static_cast<const typename PIPELINE::material *>(m));
+    }
+
+    template <typename PIPELINE, typename SOMETHING>
+    static void draw_with(const void *p, const void *what, culling c)
+    {
+        static_cast<const PIPELINE *>(p)->draw(*static_cast<const SOMETHING *>(what), c);
+    }
+
+    template <typename PIPELINE>
+    void push(int pass, const PIPELINE &p, const typename PIPELINE::material *m,
+              const void *what, void (*draw)(const void *, const void *, culling), culling c,
+              float depth, order o);
+
+    struct frame_id {
+        int id = -1;
+        uint32_t frame = 0;
+    };
+    using id_map = std::unordered_map<const void *, frame_id>;
+
+    int id_of(id_map &ids, int &next, const void *p, int max);
+    void sort();
+    void issue(const graphics_context<GRAPHICS> &ctx, int first, int last);
+
+    array<item> _items;
+    array<sort_entry> _order;
+    array<sort_entry> _scratch;
+    // ids are handed out anew every frame, entries from earlier frames
+    // are stale but kept, so a steady scene doesn't allocate
+    id_map _pipeline_ids;
+    id_map _material_ids;
+    int _next_pipeline = 0;
+    int _next_material = 0;
+    uint32_t _frame = 0;
+    bool _sorted = true;
+    stats _stats;
+};
+
+//------------------------------------------------------------------------------------------------
+// IMPLEMENTATIONS
+//------------------------------------------------------------------------------------------------
+
+template <typename GRAPHICS>
+template <typename PIPELINE, typename SOMETHING>
+void render_queue<GRAPHICS>::submit(int pass, const PIPELINE &p,
+                                    const typename PIPELINE::material *m,
+                                    const SOMETHING &what, float depth, order o)
+{
+    push(pass, p, m, &what, &draw_with<PIPELINE, SOMETHING>, culling::none, depth, o);
+}
+
+template <typename GRAPHICS>
+template <typename PIPELINE, typename SOMETHING>
+void render_queue<GRAPHICS>::submit(int pass, const PIPELINE &p,
+                                    const typename PIPELINE::material *m,
+                                    const SOMETHING &what, culling c, float depth, order o)
+{
+    push(pass, p, m, &what, &draw_with<PIPELINE, SOMETHING>, c, depth, o);
+}
+
+template <typename GRAPHICS>
+template <typename PIPELINE>
+void render_queue<GRAPHICS>::push(int pass, const PIPELINE &p,
+                                  const typename PIPELINE::material *m, const void *what,
+                                  void (*draw)(const void *, const void *, culling),
+                                  culling c, float depth, order o)
+{
+    if (pass < 0 || pass >= MAX_PASSES) {
+        throw std::runtime_error("render_queue: pass out of range");
+    }
+    int pipeline = id_of(_pipeline_ids, _next_pipeline, &p, MAX_PIPELINES);
+    // 0 stands for no material
+    int material = m ? id_of(_material_ids, _next_material, m, MAX_MATERIALS) + 1 : 0;
+    _order.push_back({make_key(pass, pipeline, material, depth, o), uint32_t(_items.size())});
+    _items.push_back({&p, m, what, &use_pipeline<PIPELINE>, &bind_material<PIPELINE>, draw, c});
+    _sorted = false;
+}
+
+template <typename GRAPHICS>
+int render_queue<GRAPHICS>::id_of(id_map &ids, int &next, const void *p, int max)
+{
+    frame_id &f = ids[p];
+    if (f.frame == _frame && f.id >= 0) return f.id;
+    if (next == max) throw std::runtime_error("render_queue: too many pipelines or materials");
+    f = {next++, _frame};
+    return f.id;
+}
+
+template <typename GRAPHICS>
+uint64_t render_queue<GRAPHICS>::make_key(int pass, int pipeline, int material, float depth,
+                                          order o)
+{
+    // flip the float's bits so that they sort as unsigned, and keep the
+    // top 24 of them
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    uint64_t d = bits >> 8;
+    uint64_t key = uint64_t(pass) << 56;
+    if (o == order::opaque) {
+        // pass:8 | 0 | pipeline:12 | material:12 | depth:24 | 7 unused
+        return key | uint64_t(pipeline) << 43 | uint64_t(material) << 31 | d << 7;
+    }
+    // pass:8 | 1 | far to near:24 | pipeline:12 | material:12 | 7 unused
+    return key | uint64_t(1) << 55 | (~d & 0xffffff) << 31 | uint64_t(pipeline) << 19 |
+           uint64_t(material) << 7;
+}
+
+template <typename GRAPHICS>
+void render_queue<GRAPHICS>::sort()
+{
+    if (_sorted) return;
+    // what issuing the draws as submitted would have taken
+    const void *pipeline = nullptr;
+    const void *material = nullptr;
+    _stats.unsorted_pipeline_changes = 0;
+    _stats.unsorted_material_changes = 0;
+    for (const item &i : _items) {
+        if (i.pipeline != pipeline) {
+            pipeline = i.pipeline;
+            material = nullptr;
+            _stats.unsorted_pipeline_changes++;
+        }
+        if (i.material && i.material != material) {
+            material = i.material;
+            _stats.unsorted_material_changes++;
+        }
+    }
+    _scratch.resize(_order.size());
+    radix_sort(_order.data(), _scratch.data(), int(_order.size()));
+    _sorted = true;
+}
+
+template <typename GRAPHICS>
+void render_queue<GRAPHICS>::execute(const graphics_context<GRAPHICS> &ctx)
+{
+    sort();
+    issue(ctx, 0, int(_order.size()));
+}
+
+template <typename GRAPHICS>
+void render_queue<GRAPHICS>::execute(const graphics_context<GRAPHICS> &ctx, int pass)
+{
+    sort();
+    auto by_pass = [](const sort_entry &e, uint64_t p) { return (e.key >> 56) < p; };
+    auto first = std::lower_bound(_order.begin(), _order.end(), uint64_t(pass), by_pass);
+    auto last = std::lower_bound(first, _order.end(), uint64_t(pass) + 1, by_pass);
+    issue(ctx, int(first - _order.begin()), int(last - _order.begin()));
+}
+
+template <typename GRAPHICS>
+void render_queue<GRAPHICS>::issue(const graphics_context<GRAPHICS> &ctx, int first, int last)
+{
+    // whatever ran in between may have changed both
+    const void *pipeline = nullptr;
+    const void *material = nullptr;
+    for (int n = first; n < last; n++) {
+        const item &i = _items[_order[n].index];
+        if (i.pipeline != pipeline) {
+            i.use(i.pipeline, ctx);
+            pipeline = i.pipeline;
+            material = nullptr;
+            _stats.pipeline_changes++;
+        }
+        if (i.material && i.material != material) {
+            i.bind(i.pipeline, i.material);
+            material = i.material;
+            _stats.material_changes++;
+        }
+        i.draw(i.pipeline, i.what, i.cull);
+        _stats.draws++;
+    }
+}
+
+template <typename GRAPHICS>
+void render_queue<GRAPHICS>::clear()
+{
+    _items.clear();
+    _order.clear();
+    _sorted = true;
+    _stats = stats();
+    _frame++;
+    _next_pipeline = 0;
+    _next_material = 0;
+    // forget pipelines and materials gone long ago, the next frame's
+    // come back at the cost of an allocation each
+    if (_pipeline_ids.size() > 2 * MAX_PIPELINES) _pipeline_ids.clear();
+    if (_material_ids.size() > 2 * MAX_MATERIALS) _material_ids.clear();
+}
+
+template <typename GRAPHICS>
+void render_queue<GRAPHICS>::imgui()
+{
+    if (ImGui::CollapsingHeader("render queue")) {
+        ImGui::Text("%d draws", _stats.draws);
+        ImGui::Text("pipeline changes: %d (%d unsorted)", _stats.pipeline_changes,
+                    _stats.unsorted_pipeline_changes);
+        ImGui::Text("material changes: %d (%d unsorted)", _stats.material_changes,
+                    _stats.unsorted_material_changes);
+    }
+}
+}
+
+#endif  // GDT_RENDER_QUEUE_HEADER_INCLUDED
@@ -32,13 +32,18 @@ class renderer {
 *
 *
 * blah
+*
+* With the profiler enabled, the pass is timed on the GPU from target
+* on, under the given name.
 */
 template <typename GRAPHICS>
 class render_pass {
   private:
     const graphics_context<GRAPHICS>& _ctx;
+    const char* _name;
   public:
-    render_pass(const graphics_context<GRAPHICS>& ctx) : _ctx(ctx)
+    render_pass(const graphics_context<GRAPHICS>& ctx, const char* name = "render pass")
+        : _ctx(ctx), _name(name)
     {
     }
 
@@ -49,6 +54,9 @@ class render_pass {
     * @param fb test
     */
     const render_pass & target(const typename GRAPHICS::frame_buffer & fb) const {
+#ifdef PROFILER_IS_ENABLED
+        _ctx.graphics->begin_gpu_pass(profiler::site_id(_name));
+#endif
         fb.bind();
         return *this;
     }
@@ -71,8 +79,8 @@ class render_pass {
         return pipeline;
     }
 
-    template <typename... PIPELINE>
-    void process_cmds(std::function<void(const PIPELINE &...)> cmds, const PIPELINE &... s) const
+    template <typename CMDS, typename... PIPELINE>
+    void process_cmds(const CMDS& cmds, const PIPELINE &... s) const
     {
         _ctx.graphics->process_cmds(cmds, s...);
     }
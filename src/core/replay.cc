@@ -0,0 +1,168 @@
+#include "replay.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "logger.hh"
+
+namespace gdt {
+
+static const char RECORDING_MAGIC[4] = {'G', 'D', 'T', 'R'};
+static const uint32_t RECORDING_VERSION = 1;
+
+template <typename T>
+static void write_raw(std::ofstream& f, T v)
+{
+    f.write(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+static bool read_raw(std::ifstream& f, T& v)
+{
+    return bool(f.read(reinterpret_cast<char*>(&v), sizeof(v)));
+}
+
+bool input_recording::save(const std::string& path) const
+{
+    std::ofstream f(path, std::ios::binary);
+    if (!f) {
+        LOG_ERROR << "cannot write input recording " << path;
+        return false;
+    }
+    f.write(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    write_raw(f, RECORDING_VERSION);
+    write_raw(f, seed);
+    write_raw(f, uint32_t(frames.size()));
+    write_raw(f, uint32_t(key_events.size()));
+    for (const frame& fr : frames) {
+        write_raw(f, fr.elapsed);
+        write_raw(f, fr.keys);
+        write_raw(f, fr.mouse_x);
+        write_raw(f, fr.mouse_y);
+        write_raw(f, fr.button);
+        write_raw(f, uint8_t(fr.key_events));
+    }
+    f.write(reinterpret_cast<const char*>(key_events.data()),
+            key_events.size() * sizeof(int32_t));
+    if (!f) {
+        LOG_ERROR << "failed writing input recording " << path;
+        return false;
+    }
+    return true;
+}
+
+bool input_recording::load(const std::string& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    char magic[4];
+    uint32_t version, n_frames, n_key_events;
+    if (!f.read(magic, sizeof(magic)) || std::memcmp(magic, RECORDING_MAGIC, 4) != 0 ||
+        !read_raw(f, version) || version != RECORDING_VERSION || !read_raw(f, seed) ||
+        !read_raw(f, n_frames) || !read_raw(f, n_key_events)) {
+        return false;
+    }
+    frames.resize(n_frames);
+    uint32_t first = 0;
+    for (frame& fr : frames) {
+        uint8_t count;
+        if (!read_raw(f, fr.elapsed) || !read_raw(f, fr.keys) || !read_raw(f, fr.mouse_x) ||
+            !read_raw(f, fr.mouse_y) || !read_raw(f, fr.button) || !read_raw(f, count)) {
+            return false;
+        }
+        fr.first_key_event = first;
+        fr.key_events = count;
+        first += count;
+    }
+    if (first != n_key_events) return false;
+    key_events.resize(n_key_events);
+    return bool(f.read(reinterpret_cast<char*>(key_events.data()),
+                       n_key_events * sizeof(int32_t)));
+}
+
+void input_recorder::record(const std::string& path, uint32_t seed)
+{
+    _mode = RECORDING;
+    _path = path;
+    _recording = input_recording();
+    _recording.seed = seed;
+    _pending_key_events = 0;
+}
+
+void input_recorder::replay(const std::string& path, bool fast, const std::string& stats_path)
+{
+    if (!_recording.load(path)) {
+        throw std::runtime_error("cannot read input recording " + path);
+    }
+    _mode = REPLAYING;
+    _fast = fast;
+    _path = path;
+    _stats_path = stats_path;
+    _next = 0;
+    _frame_times.clear();
+    _frame_times.reserve(_recording.frames.size());
+    LOG_INFO << "replaying " << _recording.frames.size() << " frames from " << path;
+}
+
+void input_recorder::key_event(int k)
+{
+    // the count is stored in a byte, nobody types that fast anyway
+    if (_pending_key_events == 255) return;
+    _recording.key_events.push_back(k);
+    _pending_key_events++;
+}
+
+void input_recorder::record_frame(float elapsed, uint64_t keys, int mouse_x, int mouse_y,
+                                  bool button)
+{
+    uint32_t first = _recording.key_events.size() - _pending_key_events;
+    _recording.frames.push_back(
+        {elapsed, keys, mouse_x, mouse_y, uint8_t(button), first, _pending_key_events});
+    _pending_key_events = 0;
+}
+
+const input_recording::frame* input_recorder::next_frame()
+{
+    if (_next >= _recording.frames.size()) return nullptr;
+    return &_recording.frames[_next++];
+}
+
+void input_recorder::frame_time(float seconds)
+{
+    _frame_times.push_back(seconds * 1000.0f);
+}
+
+void input_recorder::finish()
+{
+    if (_mode == RECORDING) {
+        if (_recording.save(_path)) {
+            LOG_INFO << "recorded " << _recording.frames.size() << " frames to " << _path;
+        }
+    } else if (_mode == REPLAYING && !_frame_times.empty()) {
+        if (!_stats_path.empty()) {
+            std::ofstream f(_stats_path);
+            f << "frame,ms\n";
+            for (size_t i = 0; i < _frame_times.size(); i++) {
+                f << i << "," << _frame_times[i] << "\n";
+            }
+            if (!f) LOG_ERROR << "cannot write frame times to " << _stats_path;
+        }
+        std::vector<float> sorted = _frame_times;
+        std::sort(sorted.begin(), sorted.end());
+        auto at = [&sorted](float p) {
+            size_t i = size_t(std::ceil(p * sorted.size()));
+            return sorted[std::min(sorted.size(), std::max<size_t>(i, 1)) - 1];
+        };
+        double total = 0;
+        for (float t : sorted) total += t;
+        LOG_INFO << "replayed " << sorted.size() << " frames of " << _path << " in "
+                 << total / 1000.0 << "s";
+        LOG_INFO << "frame ms: min " << sorted.front() << ", avg " << total / sorted.size()
+                 << ", p50 " << at(0.5f) << ", p95 " << at(0.95f) << ", p99 " << at(0.99f)
+                 << ", max " << sorted.back();
+    }
+    _mode = OFF;
+}
+}
@@ -0,0 +1,143 @@
+#ifndef GDT_REPLAY_HEADER_INCLUDED
+#define GDT_REPLAY_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "backends/blueprints/platform.hh"
+
+namespace gdt {
+
+/**
+ * A recorded session: the random seed it started with and, for every
+ * frame, the elapsed time the frame got, the state of all the keys
+ * and the mouse, and the key presses the platform reported.
+ *
+ * Saved as a compact binary file, little endian as written by the
+ * machine that recorded it:
+ *
+ *     "GDTR", version, seed, frame count, key press count
+ *     per frame: elapsed, key bits, mouse x, mouse y, button, key presses
+ *     key press codes
+ */
+struct input_recording {
+    struct frame {
+        float elapsed;
+        uint64_t keys;
+        int32_t mouse_x;
+        int32_t mouse_y;
+        uint8_t button;
+        uint32_t first_key_event;
+        uint32_t key_events;
+    };
+
+    uint32_t seed = 0;
+    std::vector<frame> frames;
+    std::vector<int32_t> key_events;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+/**
+ * Records a session into an input_recording, or plays one back.
+ * gdt::application owns one, see application::record_input and
+ * application::replay_input.
+ *
+ * While playing back it also keeps the real duration of every frame,
+ * and reports their statistics once the recording runs out, so two
+ * builds can be compared on the very same gameplay.
+ */
+class input_recorder {
+  public:
+    enum mode_t { OFF, RECORDING, REPLAYING };
+
+    void record(const std::string& path, uint32_t seed);
+    void replay(const std::string& path, bool fast, const std::string& stats_path);
+
+    mode_t mode() const
+    {
+        return _mode;
+    }
+    bool fast() const
+    {
+        return _fast;
+    }
+    uint32_t seed() const
+    {
+        return _recording.seed;
+    }
+
+    /** Keep a key press for the frame being recorded. */
+    void key_event(int k);
+    /** Close the frame being recorded. */
+    void record_frame(float elapsed, uint64_t keys, int mouse_x, int mouse_y, bool button);
+
+    /** The next frame to play back, nullptr once the recording is over. */
+    const input_recording::frame* next_frame();
+    const int32_t* key_events(const input_recording::frame& f) const
+    {
+        return _recording.key_events.data() + f.first_key_event;
+    }
+    /** How long the frame played back last really took. */
+    void frame_time(float seconds);
+
+    /** Save the recording, or report the played back frame times. */
+    void finish();
+
+  private:
+    mode_t _mode = OFF;
+    bool _fast = false;
+    std::string _path;
+    std::string _stats_path;
+    input_recording _recording;
+    uint32_t _pending_key_events = 0;
+    size_t _next = 0;
+    std::vector<float> _frame_times;
+};
+
+/**
+ * Wraps a platform backend so the keyboard and mouse state can come
+ * from a played back frame instead of the actual devices. The
+ * application wraps its platform with it, nothing changes while
+ * nothing plays back.
+ */
+template <typename PLATFORM>
+class replayable : public PLATFORM {
+  public:
+    using PLATFORM::PLATFORM;
+
+    /** The frame whose input is reported, nullptr for the live input. */
+    const input_recording::frame* replayed = nullptr;
+
+    bool is_key_pressed(key k) const override
+    {
+        if (replayed) return (replayed->keys >> k) & 1;
+        return PLATFORM::is_key_pressed(k);
+    }
+    void get_mouse(int* x, int* y) const override
+    {
+        if (!replayed) return PLATFORM::get_mouse(x, y);
+        *x = replayed->mouse_x;
+        *y = replayed->mouse_y;
+    }
+    bool is_button_pressed() const override
+    {
+        if (replayed) return replayed->button;
+        return PLATFORM::is_button_pressed();
+    }
+
+    /** The current key and mouse state, packed for recording. */
+    uint64_t key_bits() const
+    {
+        uint64_t bits = 0;
+        for (int k = 0; k <= key::SPACE; k++) {
+            if (is_key_pressed(key(k))) bits |= uint64_t(1) << k;
+        }
+        return bits;
+    }
+};
+}
+
+#endif  // GDT_REPLAY_HEADER_INCLUDED
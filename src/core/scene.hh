@@ -44,6 +44,40 @@ class scene {
      */
     virtual void update(const CONTEXT& ctx) = 0;
 
+    /**
+     * When the application runs in fixed update mode, simulation goes
+     * here instead of in update. It is called zero or more times per frame,
+     * with `ctx.elapsed` always equal to `ctx.fixed_step`:
+     *
+     *     void fixed_update(const my_app::context & ctx) override {
+     *         ctx.physics->update(ctx);
+     *         _crates.fixed_update(ctx);
+     *     }
+     */
+    virtual void fixed_update([[maybe_unused]] const CONTEXT& ctx)
+    {
+    }
+
+    /**
+     * In fixed update mode, this is called once per frame after the fixed
+     * updates. `alpha` tells how far, from 0 to 1, the frame is between the
+     * last two simulation steps, so you can blend simulated transforms for
+     * smooth rendering at any frame rate:
+     *
+     *     void update(const my_app::context & ctx, float alpha) override {
+     *         _crates.interpolate(ctx, alpha);
+     *         render(ctx);
+     *     }
+     *
+     * Scenes that don't override it just get their regular update. Scenes
+     * that do can have their regular update forward to it with an alpha
+     * of 1, for when the application is not in fixed update mode.
+     */
+    virtual void update(const CONTEXT& ctx, [[maybe_unused]] float alpha)
+    {
+        update(ctx);
+    }
+
     /**
      * You must provide your own rendering implementation. Make sure you draw
      * only in this method, as this method could also be called by the engine.
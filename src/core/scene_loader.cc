@@ -0,0 +1,103 @@
+#include "scene_loader.hh"
+
+#include <algorithm>
+
+#include "logger.hh"
+#include "utils/memory.hh"
+#include "utils/profiler.hh"
+
+namespace gdt {
+
+scene_loader::scene_loader(job_system* jobs) : _jobs(jobs)
+{
+}
+
+scene_loader::~scene_loader()
+{
+    // the scene itself went with scene_loader_for, only the reads are left
+    if (_jobs) _jobs->wait(_read);
+}
+
+bool scene_loader::start(std::vector<std::string> files)
+{
+    if (_stage != IDLE) {
+        LOG_WARNING << "a scene is already loading";
+        return false;
+    }
+    _files = std::move(files);
+    _files_read = 0;
+    _stage = READING;
+    // without workers nobody would pick the jobs up before the wait,
+    // advance reads a file per frame instead
+    if (!_jobs || _jobs->workers() == 0) return true;
+    for (size_t i = 0; i < _files.size(); i++) {
+        _jobs->run(_read, [this, i]() {
+            _cache.read(_files[i]);
+            _files_read.fetch_add(1);
+        });
+    }
+    return true;
+}
+
+void scene_loader::cancel()
+{
+    if (_jobs) _jobs->wait(_read);
+    // the queued uploads point into the scene, so they go first
+    _uploads.clear();
+    discard();
+    if (_stage != IDLE) _cache.clear();
+    _stage = IDLE;
+}
+
+float scene_loader::progress() const
+{
+    switch (_stage) {
+        case READING:
+            return 0.5f * _files_read.load() / std::max<size_t>(1, _files.size());
+        case UPLOADING:
+            if (_uploads.bytes_total() == 0) return 1;
+            return 0.5f + 0.5f * _uploads.bytes_done() / _uploads.bytes_total();
+        default:
+            return 1;
+    }
+}
+
+bool scene_loader::advance(screen* s)
+{
+    if (_stage == READING) {
+        if (!_jobs || _jobs->workers() == 0) {
+            size_t next = _files_read.load();
+            if (next < _files.size()) {
+                PROFILE_SCOPE("scene reading");
+                _cache.read(_files[next]);
+                _files_read++;
+                return false;
+            }
+        }
+        if (!_read.is_done()) return false;
+        PROFILE_SCOPE("scene construction");
+        try {
+            asset_cache::scope use(&_cache);
+            upload_queue::scope open(&_uploads);
+            memory::scope tag(memory::GAME);
+            construct(s);
+        } catch (...) {
+            _uploads.clear();
+            _cache.clear();
+            _stage = IDLE;
+            throw;
+        }
+        _stage = UPLOADING;
+        LOG_DEBUG << "scene constructed, " << _uploads.pending() << " uploads queued";
+        return false;
+    }
+    if (_stage == UPLOADING) {
+        PROFILE_SCOPE("scene uploads");
+        if (!_uploads.run(_budget_ms)) return false;
+        _stage = IDLE;
+        _cache.clear();
+        return true;
+    }
+    return false;
+}
+}
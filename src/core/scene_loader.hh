@@ -0,0 +1,186 @@
+#ifndef GDT_SCENE_LOADER_HEADER_INCLUDED
+#define GDT_SCENE_LOADER_HEADER_INCLUDED
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "core/assets.hh"
+#include "core/jobs.hh"
+#include "core/scene.hh"
+#include "core/screen.hh"
+
+namespace gdt {
+
+/**
+ * Loads the next scene while the current one keeps running, and
+ * switches to it in between two frames once it's ready. The
+ * application has one, reachable from every scene as ctx.scenes:
+ *
+ *     void update(const my_app::context& ctx) override
+ *     {
+ *         if (_level_done && !ctx.scenes->is_loading()) {
+ *             ctx.scenes->load<level2>(ctx, {"res/level2.smd", "res/level2_d.png"});
+ *         }
+ *         if (ctx.scenes->is_loading()) {
+ *             draw_progress_bar(ctx.scenes->progress());
+ *         }
+ *         ...
+ *     }
+ *
+ * Loading goes through three stages:
+ *
+ * 1. The listed files are read and decoded into the loader's own
+ *    gdt::asset_cache by job_system workers.
+ * 2. The scene is constructed, on the main thread, in between two
+ *    frames. Its drawables and textures find their data in the cache,
+ *    which nothing else built meanwhile gets to see, and their GPU
+ *    uploads go to an upload_queue instead of happening on the spot.
+ * 3. The uploads run, a few every frame, within a time budget.
+ *
+ * Then the new scene replaces the active one. Files the scene needs
+ * but that weren't listed still load, just on the main thread, in
+ * stage 2.
+ *
+ * The application's loader is a gdt::scene_loader_for its context, which
+ * keeps the scene being loaded.
+ */
+class scene_loader {
+  public:
+    explicit scene_loader(job_system* jobs);
+    virtual ~scene_loader();
+    scene_loader(const scene_loader&) = delete;
+    scene_loader& operator=(const scene_loader&) = delete;
+
+    /**
+     * Start loading SCENE. Ignored, with a warning, while another scene
+     * is still loading. SCENE has to be a scene of ctx's context.
+     *
+     * @param files the models and images to read ahead of time
+     */
+    template <typename SCENE, typename CONTEXT>
+    void load(const CONTEXT& ctx, std::vector<std::string> files);
+
+    bool is_loading() const
+    {
+        return _stage != IDLE;
+    }
+
+    /**
+     * How far loading got, from 0 to 1. Reading files is the first
+     * half, uploading them the second.
+     */
+    float progress() const;
+
+    /**
+     * Milliseconds per frame to spend on GPU uploads, 2 by default.
+     */
+    void set_upload_budget(float ms)
+    {
+        _budget_ms = ms;
+    }
+
+  protected:
+    /** False, with a warning, while another scene is still loading. */
+    bool start(std::vector<std::string> files);
+
+    /**
+     * Move loading along, calling construct in between. True once the
+     * constructed scene is ready to take over.
+     */
+    bool advance(screen* s);
+
+    /** Stop loading, discarding whatever was loaded so far. */
+    void cancel();
+
+    virtual void construct(screen* s) = 0;
+    virtual void discard() = 0;
+
+  private:
+    enum stage_t { IDLE, READING, UPLOADING };
+
+    job_system* _jobs;
+    stage_t _stage = IDLE;
+    std::vector<std::string> _files;
+    std::atomic<int> _files_read{0};
+    job_counter _read;
+    asset_cache _cache;
+    upload_queue _uploads;
+    float _budget_ms = 2;
+};
+
+/**
+ * The scene_loader an application with CONTEXT has.
+ */
+template <typename CONTEXT>
+class scene_loader_for : public scene_loader {
+  public:
+    scene_loader_for(job_system* jobs, const CONTEXT* ctx) : scene_loader(jobs), _ctx(ctx)
+    {
+    }
+
+    ~scene_loader_for() override
+    {
+        cancel();
+    }
+
+    /** Start loading SCENE, see scene_loader::load. */
+    template <typename SCENE>
+    void load(std::vector<std::string> files);
+
+    /**
+     * Called by the application once per frame. Moves loading along and
+     * returns the new scene once it's ready to take over, nullptr
+     * before that.
+     */
+    std::unique_ptr<scene<CONTEXT>> update(screen* s)
+    {
+        if (!advance(s)) return nullptr;
+        return std::move(_next);
+    }
+
+  private:
+    using factory = std::unique_ptr<scene<CONTEXT>> (*)(const CONTEXT& ctx, screen* s);
+
+    void construct(screen* s) override
+    {
+        _next = _create(*_ctx, s);
+    }
+
+    void discard() override
+    {
+        _next.reset();
+    }
+
+    const CONTEXT* _ctx;
+    factory _create = nullptr;
+    std::unique_ptr<scene<CONTEXT>> _next;
+};
+
+// IMPLEMENTATIONS
+
+template <typename SCENE, typename CONTEXT>
+void scene_loader::load([[maybe_unused]] const CONTEXT& ctx, std::vector<std::string> files)
+{
+    static_assert(std::is_base_of<scene<CONTEXT>, SCENE>::value,
+                  "SCENE has to be a scene of the application's context");
+    // ctx.scenes is the application's loader, the one for its context
+    static_cast<scene_loader_for<CONTEXT>*>(this)->template load<SCENE>(std::move(files));
+}
+
+template <typename CONTEXT>
+template <typename SCENE>
+void scene_loader_for<CONTEXT>::load(std::vector<std::string> files)
+{
+    static_assert(std::is_base_of<scene<CONTEXT>, SCENE>::value,
+                  "SCENE has to be a scene of the application's context");
+    if (!start(std::move(files))) return;
+    _create = [](const CONTEXT& ctx, screen* s) -> std::unique_ptr<scene<CONTEXT>> {
+        return std::make_unique<SCENE>(ctx, s);
+    };
+}
+}
+
+#endif  // GDT_SCENE_LOADER_HEADER_INCLUDED
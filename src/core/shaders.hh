@@ -2,6 +2,7 @@
 #define SRC_CONSTRUCTS_SHADERS_HH_INCLUDED
 
 #include "imgui/imgui.h"
+#include "culling.hh"
 #include "extensions.hh"
 #include "light.hh"
 #include "camera.hh"
@@ -100,6 +101,26 @@ class pipeline : public GRAPHICS::base_pipeline {
         return static_cast<const T&>(*this);
     }
     typedef pipeline_proxy<GRAPHICS, T> proxy;
+
+  protected:
+    /**
+     * Draw all the instances of what, or only those in the camera
+     * frustum set by set_camera.
+     */
+    template <typename SOMETHING>
+    void draw_instances_of(const SOMETHING& what, culling c) const
+    {
+        const auto& t = what.get_transformable();
+        if (c == culling::frustum) {
+            what.get_drawable().draw_instances(this->adhoc_context(), static_cast<const T&>(*this),
+                                               t.get_transforms(), t.size(), _culler);
+        } else {
+            what.get_drawable().draw_instances(this->adhoc_context(), static_cast<const T&>(*this),
+                                               t.get_transforms(), t.size());
+        }
+    }
+
+    mutable instance_culler _culler;
 };
 
 /**
@@ -155,13 +176,14 @@ class forward_pipeline : public pipeline<GRAPHICS, forward_pipeline<GRAPHICS>> {
         _itfm = this->add_attrib("am4_transform");
     }
 
+    /**
+     * Draw what's instances. With culling::frustum, instances outside
+     * the camera given to set_camera are left out.
+     */
     template <typename SOMETHING>
-    const forward_pipeline& draw(const SOMETHING& what) const
+    const forward_pipeline& draw(const SOMETHING& what, culling c = culling::none) const
     {
-        what.get_drawable().draw_instances(this->adhoc_context(),
-                                           *this,
-                                           what.get_transformable().get_transforms(),
-                                           what.get_transformable().size());
+        this->draw_instances_of(what, c);
         return *this;
     }
 
@@ -239,8 +261,10 @@ class forward_pipeline : public pipeline<GRAPHICS, forward_pipeline<GRAPHICS>> {
     template <typename CAMERA>
     const forward_pipeline& set_camera(const CAMERA & c) const
     {
+        gdt::math::mat4 mvp = c.entity().proj * c.get_transformable().get_transforms()[0];
         set_eyepos(c.entity().pos);
-        set_modelview(c.entity().proj * c.get_transformable().get_transforms()[0]);
+        set_modelview(mvp);
+        this->_culler.set_frustum(gdt::math::frustum(mvp));
         return *this;
     }
 
@@ -296,13 +320,14 @@ class geom_pipeline : public pipeline<GRAPHICS, geom_pipeline<GRAPHICS>> {
 
     using material = gdt::material<GRAPHICS>;
 
+    /**
+     * Draw what's instances. With culling::frustum, instances outside
+     * the camera given to set_camera are left out.
+     */
     template <typename SOMETHING>
-    const geom_pipeline& draw(const SOMETHING& what) const
+    const geom_pipeline& draw(const SOMETHING& what, culling c = culling::none) const
     {
-        what.get_drawable().draw_instances(this->adhoc_context(),
-                                           *this,
-                                           what.get_transformable().get_transforms(),
-                                           what.get_transformable().size());
+        this->draw_instances_of(what, c);
         return *this;
     }
 
@@ -357,7 +382,9 @@ class geom_pipeline : public pipeline<GRAPHICS, geom_pipeline<GRAPHICS>> {
     template <typename CAMERA>
     const geom_pipeline& set_camera(const CAMERA & c) const
     {
-        set_modelview(c.entity().proj * c.get_transformable().get_transforms()[0]);
+        gdt::math::mat4 mvp = c.entity().proj * c.get_transformable().get_transforms()[0];
+        set_modelview(mvp);
+        this->_culler.set_frustum(gdt::math::frustum(mvp));
         return *this;
     }
 
@@ -639,7 +666,12 @@ class light_pipeline : public pipeline<GRAPHICS, light_pipeline<GRAPHICS>> {
         return *this;
     }
 
-    const light_pipeline& set_lights(const std::vector<light>& lights) const
+    /**
+     * Any container of gdt::light will do, a gdt::frame_vector for a
+     * list built every frame.
+     */
+    template <typename LIGHTS>
+    const light_pipeline& set_lights(const LIGHTS& lights) const
     {
         if (lights.size() > 32) throw std::runtime_error("too many lights");
         int index = 0;
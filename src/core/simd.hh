@@ -0,0 +1,149 @@
+#ifndef GDT_SIMD_HEADER_INCLUDED
+#define GDT_SIMD_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Fixed width float vectors for GDT's batched code paths.
+ *
+ * These are built on the GCC and Clang generic vector extension, so the same
+ * code becomes SSE or NEON for 4 lanes and AVX (or two SSE registers) for 8,
+ * depending on the target flags. Arithmetic, comparisons and the ternary
+ * operator work lane-wise:
+ *
+ *     simd::lanes8 x, r;
+ *     simd::load(x, xs + i);
+ *     r = x < 0.5f ? x * x : x;
+ *
+ * GDT_HAS_SIMD is defined when these are available. Code using them should
+ * always keep a scalar fallback.
+ */
+#if defined(__GNUC__)
+#define GDT_HAS_SIMD 1
+
+// Passing 8 lane vectors by value without AVX enabled is fine for our
+// internal helpers, even if it changes the (unused) ABI. Only these are
+// let off, not the code including them.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace gdt::simd {
+
+typedef float lanes4 __attribute__((vector_size(16)));
+typedef float lanes8 __attribute__((vector_size(32)));
+typedef int32_t ilanes4 __attribute__((vector_size(16)));
+typedef int32_t ilanes8 __attribute__((vector_size(32)));
+
+/**
+ * The widest lanes the target handles natively. Without AVX, 8 lanes are
+ * split in two and lane-wise selects fall back to scalar code.
+ */
+#if defined(__AVX__)
+typedef lanes8 lanes;
+#else
+typedef lanes4 lanes;
+#endif
+
+template <typename LANES>
+struct lanes_of;
+
+template <>
+struct lanes_of<lanes4> {
+    using ints = ilanes4;
+    static const int width = 4;
+};
+
+template <>
+struct lanes_of<lanes8> {
+    using ints = ilanes8;
+    static const int width = 8;
+};
+
+template <typename LANES>
+inline void load(LANES &v, const float *p)
+{
+    memcpy(&v, p, sizeof(LANES));
+}
+
+template <typename LANES>
+inline void store(float *p, const LANES &v)
+{
+    memcpy(p, &v, sizeof(LANES));
+}
+
+template <typename LANES>
+inline LANES splat(float x)
+{
+    return LANES{} + x;
+}
+
+template <typename LANES>
+inline LANES floor(LANES x)
+{
+    using ints = typename lanes_of<LANES>::ints;
+    LANES t = __builtin_convertvector(__builtin_convertvector(x, ints), LANES);
+    // truncation rounds negative values up, step those back down
+    return t + __builtin_convertvector(t > x, LANES);
+}
+
+/** Square root using a refined reciprocal square root estimate. */
+template <typename LANES>
+inline LANES sqrt(LANES x)
+{
+    using ints = typename lanes_of<LANES>::ints;
+    LANES zero = LANES{};
+    ints i = (ints)x;
+    i = 0x5f3759df - (i >> 1);
+    LANES y = (LANES)i;
+    for (int n = 0; n < 3; n++) {
+        y = y * (1.5f - 0.5f * x * y * y);
+    }
+    return x > zero ? x * y : zero;
+}
+
+/** Sine with Cody-Waite range reduction, accurate to about 1e-6. */
+template <typename LANES>
+inline LANES sin(LANES x)
+{
+    using ints = typename lanes_of<LANES>::ints;
+    LANES j = floor(x * 0.63661977236758134f + 0.5f);
+    LANES y = ((x - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+    LANES z = y * y;
+    LANES s = y + y * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+    LANES c = 1.0f - 0.5f * z +
+              z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f +
+                                                     z * 2.443315711809948e-5f));
+    ints q = __builtin_convertvector(j, ints) & 3;
+    LANES r = (q & 1) != 0 ? c : s;
+    return (q & 2) != 0 ? -r : r;
+}
+
+template <typename LANES>
+inline LANES cos(LANES x)
+{
+    return sin(x + 1.57079632679489661923f);
+}
+
+/** Base 2 exponent, accurate to about 1e-7 relative error. */
+template <typename LANES>
+inline LANES exp2(LANES x)
+{
+    using ints = typename lanes_of<LANES>::ints;
+    LANES lo = splat<LANES>(-126.0f);
+    LANES hi = splat<LANES>(126.0f);
+    x = x < lo ? lo : x;
+    x = x > hi ? hi : x;
+    LANES i = floor(x);
+    LANES f = x - i;
+    LANES p = 1.0f + f * (0.693147182f + f * (0.240226507f + f * (0.0555041087f +
+                       f * (0.00961812911f + f * 0.00133335581f))));
+    ints e = (__builtin_convertvector(i, ints) + 127) << 23;
+    return p * (LANES)e;
+}
+}
+
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // GDT_SIMD_HEADER_INCLUDED
@@ -0,0 +1,164 @@
+#include "soa_transforms.hh"
+
+#include "simd.hh"
+
+namespace gdt {
+
+namespace {
+
+struct trs {
+    const float *px, *py, *pz;
+    const float *qx, *qy, *qz, *qw;
+    const float *sx, *sy, *sz;
+};
+
+// the same as mat4::world(p, s, q).transpose(), without the products
+void compose_one(const trs &a, int i, math::mat4 *out)
+{
+    float x2 = a.qx[i] + a.qx[i];
+    float y2 = a.qy[i] + a.qy[i];
+    float z2 = a.qz[i] + a.qz[i];
+    float xx = a.qx[i] * x2;
+    float yy = a.qy[i] * y2;
+    float zz = a.qz[i] * z2;
+    float xy = a.qx[i] * y2;
+    float xz = a.qx[i] * z2;
+    float yz = a.qy[i] * z2;
+    float wx = a.qw[i] * x2;
+    float wy = a.qw[i] * y2;
+    float wz = a.qw[i] * z2;
+    float sx = a.sx[i];
+    float sy = a.sy[i];
+    float sz = a.sz[i];
+    out[i] = math::mat4((1 - (yy + zz)) * sx, (xy + wz) * sx, (xz - wy) * sx, 0,
+                        (xy - wz) * sy, (1 - (xx + zz)) * sy, (yz + wx) * sy, 0,
+                        (xz + wy) * sz, (yz - wx) * sz, (1 - (xx + yy)) * sz, 0,
+                        a.px[i], a.py[i], a.pz[i], 1);
+}
+
+#if defined(GDT_HAS_SIMD)
+// the instances first..first + W, writing those whose bit is set in mask
+template <typename LANES>
+void compose_wide(const trs &a, int first, uint32_t mask, math::mat4 *out)
+{
+    constexpr int W = sizeof(LANES) / sizeof(float);
+    LANES qx, qy, qz, qw, sx, sy, sz;
+    simd::load(qx, a.qx + first);
+    simd::load(qy, a.qy + first);
+    simd::load(qz, a.qz + first);
+    simd::load(qw, a.qw + first);
+    simd::load(sx, a.sx + first);
+    simd::load(sy, a.sy + first);
+    simd::load(sz, a.sz + first);
+    LANES x2 = qx + qx;
+    LANES y2 = qy + qy;
+    LANES z2 = qz + qz;
+    LANES xx = qx * x2;
+    LANES yy = qy * y2;
+    LANES zz = qz * z2;
+    LANES xy = qx * y2;
+    LANES xz = qx * z2;
+    LANES yz = qy * z2;
+    LANES wx = qw * x2;
+    LANES wy = qw * y2;
+    LANES wz = qw * z2;
+    // spill the columns, picking single lanes out of registers is slow
+    float m[9][W];
+    simd::store(m[0], (1 - (yy + zz)) * sx);
+    simd::store(m[1], (xy + wz) * sx);
+    simd::store(m[2], (xz - wy) * sx);
+    simd::store(m[3], (xy - wz) * sy);
+    simd::store(m[4], (1 - (xx + zz)) * sy);
+    simd::store(m[5], (yz + wx) * sy);
+    simd::store(m[6], (xz + wy) * sz);
+    simd::store(m[7], (yz - wx) * sz);
+    simd::store(m[8], (1 - (xx + yy)) * sz);
+    for (int l = 0; l < W; l++) {
+        if (!((mask >> l) & 1)) continue;
+        int i = first + l;
+        out[i] = math::mat4(m[0][l], m[1][l], m[2][l], 0, m[3][l], m[4][l], m[5][l], 0,
+                            m[6][l], m[7][l], m[8][l], 0, a.px[i], a.py[i], a.pz[i], 1);
+    }
+}
+#endif
+}
+
+soa_transforms::soa_transforms(int count)
+{
+    resize(count);
+}
+
+int soa_transforms::add(math::vec3 position, math::quat rotation, math::vec3 scale)
+{
+    int i = size();
+    resize(i + 1);
+    set_position(i, position);
+    set_rotation(i, rotation);
+    set_scale(i, scale);
+    return i;
+}
+
+void soa_transforms::resize(int count)
+{
+    int old = size();
+    for (floats *f : {&_px, &_py, &_pz, &_qx, &_qy, &_qz}) f->resize(count, 0);
+    for (floats *f : {&_qw, &_sx, &_sy, &_sz}) f->resize(count, 1);
+    _dirty.resize((count + 63) / 64, 0);
+    // clear the marks past the end, compose must not see them
+    if (count & 63) _dirty.back() &= (uint64_t(1) << (count & 63)) - 1;
+    if (count > old) mark_dirty(old, count - old);
+}
+
+void soa_transforms::mark_dirty(int first, int count)
+{
+    for (int i = first; i < first + count;) {
+        if ((i & 63) == 0 && i + 64 <= first + count) {
+            _dirty[i >> 6] = ~uint64_t(0);
+            i += 64;
+        } else {
+            mark_dirty(i++);
+        }
+    }
+}
+
+int soa_transforms::compose(math::mat4 *out, int width)
+{
+    trs a = {_px.data(), _py.data(), _pz.data(), _qx.data(), _qy.data(),
+             _qz.data(), _qw.data(), _sx.data(), _sy.data(), _sz.data()};
+    int n = size();
+    int written = 0;
+    _ranges.clear();
+    for (size_t w = 0; w < _dirty.size(); w++) {
+        uint64_t bits = _dirty[w];
+        if (!bits) continue;
+        _dirty[w] = 0;
+        int base = int(w) * 64;
+        int lane = 0;
+#if defined(GDT_HAS_SIMD)
+        int W = width >= 8 ? 8 : width >= 4 ? 4 : 0;
+        for (; W && lane < 64 && base + lane + W <= n; lane += W) {
+            uint32_t mask = uint32_t(bits >> lane) & ((1u << W) - 1);
+            if (!mask) continue;
+            if (W == 8) {
+                compose_wide<simd::lanes8>(a, base + lane, mask, out);
+            } else {
+                compose_wide<simd::lanes4>(a, base + lane, mask, out);
+            }
+        }
+#endif
+        for (uint64_t rest = lane < 64 ? bits >> lane << lane : 0; rest; rest &= rest - 1) {
+            compose_one(a, base + __builtin_ctzll(rest), out);
+        }
+        for (; bits; bits &= bits - 1) {
+            int i = base + __builtin_ctzll(bits);
+            written++;
+            if (!_ranges.empty() && i <= _ranges.back().first + _ranges.back().count + _merge_gap) {
+                _ranges.back().count = i - _ranges.back().first + 1;
+            } else {
+                _ranges.push_back({i, 1});
+            }
+        }
+    }
+    return written;
+}
+}
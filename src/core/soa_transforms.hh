@@ -0,0 +1,164 @@
+#ifndef GDT_SOA_TRANSFORMS_HEADER_INCLUDED
+#define GDT_SOA_TRANSFORMS_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+#include "math.hh"
+#include "utils/memory.hh"
+
+namespace gdt {
+
+/**
+ * Position, rotation and scale of many instances, kept as separate
+ * arrays, one per component, and composed into instance matrices once a
+ * frame rather than on every change.
+ *
+ * Setting any part of an instance marks it dirty. compose then builds
+ * the matrices of the dirty instances only, 4 or 8 at a time where the
+ * target has SIMD, writes them into an instance buffer, transposed the
+ * way pipelines expect, and clears the marks:
+ *
+ *     gdt::soa_transforms _soa;
+ *     gdt::instances<rock, 4096> _rocks;
+ *     ...
+ *     for (int i : _moved) _soa.set_position(i, _positions[i]);
+ *     _soa.compose(_rocks.begin());
+ *     _rocks.update(ctx);
+ *
+ * Code that moves everything at once can write the arrays directly,
+ * see x, y and z, and mark the whole range with mark_dirty.
+ *
+ * A backend keeping the instance buffer on the GPU only needs to update
+ * what compose wrote, upload_ranges lists those spans.
+ */
+class soa_transforms {
+  public:
+    /** A span of instances written by compose. */
+    struct range {
+        int first;
+        int count;
+    };
+
+    explicit soa_transforms(int count = 0);
+
+    /**
+     * Add an instance.
+     *
+     * @return its index
+     */
+    int add(math::vec3 position = {0, 0, 0}, math::quat rotation = {0, 0, 0, 1},
+            math::vec3 scale = {1, 1, 1});
+
+    /** Grow or shrink to count instances, new ones at the origin. */
+    void resize(int count);
+
+    int size() const
+    {
+        return int(_px.size());
+    }
+
+    void set_position(int i, math::vec3 p)
+    {
+        _px[i] = p.x;
+        _py[i] = p.y;
+        _pz[i] = p.z;
+        mark_dirty(i);
+    }
+
+    void set_rotation(int i, math::quat q)
+    {
+        _qx[i] = q.x;
+        _qy[i] = q.y;
+        _qz[i] = q.z;
+        _qw[i] = q.w;
+        mark_dirty(i);
+    }
+
+    void set_scale(int i, math::vec3 s)
+    {
+        _sx[i] = s.x;
+        _sy[i] = s.y;
+        _sz[i] = s.z;
+        mark_dirty(i);
+    }
+
+    math::vec3 position(int i) const
+    {
+        return {_px[i], _py[i], _pz[i]};
+    }
+
+    math::quat rotation(int i) const
+    {
+        return {_qx[i], _qy[i], _qz[i], _qw[i]};
+    }
+
+    math::vec3 scale(int i) const
+    {
+        return {_sx[i], _sy[i], _sz[i]};
+    }
+
+    /** The position arrays, for batch updates. Mark what you change. */
+    float *x()
+    {
+        return _px.data();
+    }
+    float *y()
+    {
+        return _py.data();
+    }
+    float *z()
+    {
+        return _pz.data();
+    }
+
+    void mark_dirty(int i)
+    {
+        _dirty[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+
+    void mark_dirty(int first, int count);
+
+    bool is_dirty(int i) const
+    {
+        return (_dirty[i >> 6] >> (i & 63)) & 1;
+    }
+
+    /**
+     * Write translation * rotation * scale of every dirty instance i,
+     * transposed, into out[i], and clear the dirty marks.
+     *
+     * @param out an instance buffer of at least size() matrices
+     * @param width number of lanes to compose at once: 1, 4 or 8
+     * @return the number of matrices written
+     */
+    int compose(math::mat4 *out, int width = 8);
+
+    /**
+     * The spans the last compose wrote, in order. Spans less than
+     * merge_gap apart are reported as one, as uploading a few clean
+     * matrices is cheaper than another upload call.
+     */
+    const std::vector<range> &upload_ranges() const
+    {
+        return _ranges;
+    }
+
+    void set_merge_gap(int gap)
+    {
+        _merge_gap = gap;
+    }
+
+  private:
+    using floats = std::vector<float, tagged_allocator<float, memory::INSTANCES>>;
+
+    floats _px, _py, _pz;
+    floats _qx, _qy, _qz, _qw;
+    floats _sx, _sy, _sz;
+    std::vector<uint64_t, tagged_allocator<uint64_t, memory::INSTANCES>> _dirty;
+    std::vector<range> _ranges;
+    int _merge_gap = 8;
+};
+}
+
+#endif  // GDT_SOA_TRANSFORMS_HEADER_INCLUDED
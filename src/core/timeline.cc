@@ -3,7 +3,6 @@ namespace gdt {
 
 timeline::timeline(bool paused)
 {
-    _current_span = _spans.end();
     _paused = paused;
 }
 
@@ -13,45 +12,102 @@ timeline::~timeline()
 
 timeline& timeline::wait(float t)
 {
-    return span(t, [](float elapsed, float progress) {});
+    _spans.push_back({t, t, span_callback_t()});
+    return *this;
 }
 
 timeline& timeline::span(float t, timeline::span_callback_t f)
 {
-    _spans.push_back({t, t, f});
-    _current_span = _spans.begin();
+    _spans.push_back({t, t, std::move(f)});
     return *this;
 }
 
 timeline& timeline::once(timeline::span_callback_t f)
 {
-    _spans.push_back({0, 0, f});
-    _current_span = _spans.begin();
+    _spans.push_back({0, 0, std::move(f)});
     return *this;
 }
 
 void timeline::update(const gdt::core_context& ctx)
+{
+    update(ctx.elapsed);
+}
+
+void timeline::update(float elapsed)
 {
     if (_paused) return;
-    float c = 0;
-    if (_current_span != _spans.end()) {
-        c = _current_span->time;
-        c = c - ctx.elapsed;
-        if (c <= 0.0) {
-            _current_span->span_callback(ctx.elapsed, 1.0);
-            _current_span->time = 0.0;
-            _current_span++;
-            c = _current_span->time + c;
+    float left = elapsed;
+    // finish every span the elapsed time covers, then report the
+    // progress of the one we end up in
+    while (_current_span < _spans.size()) {
+        stored_span& s = _spans[_current_span];
+        if (s.time > left) {
+            s.time -= left;
+            if (s.span_callback) s.span_callback(elapsed, 1.0 - s.time / s.otime);
+            return;
         }
-    }
-    if (_current_span != _spans.end()) {
-        _current_span->time = c;
-        _current_span->span_callback(ctx.elapsed,
-                                     1.0 - _current_span->time / _current_span->otime);
+        left -= s.time;
+        s.time = 0.0;
+        if (s.span_callback) s.span_callback(elapsed, 1.0);
+        _current_span++;
     }
 }
 
 bool timeline::is_done() const {
-    return _current_span == _spans.end();
+    return _current_span >= _spans.size();
+}
+
+void timeline::restart()
+{
+    for (auto& s : _spans) s.time = s.otime;
+    _current_span = 0;
+}
+
+void timeline::clear()
+{
+    _spans.clear();
+    _current_span = 0;
+}
+
+timeline& timeline_group::add(bool paused)
+{
+    timeline* t;
+    if (!_free.empty()) {
+        t = _free.back();
+        _free.pop_back();
+        t->clear();
+    } else {
+        _timelines.emplace_back();
+        t = &_timelines.back();
+    }
+    if (paused) t->pause(); else t->resume();
+    _active.push_back(t);
+    return *t;
+}
+
+void timeline_group::update(const gdt::core_context& ctx)
+{
+    update(ctx.elapsed);
+}
+
+void timeline_group::update(float elapsed)
+{
+    size_t n = _active.size();
+    for (size_t i = 0; i < n; i++) {
+        _active[i]->update(elapsed);
+    }
+    // move done timelines to the free list, keeping the order of the rest
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        timeline* t = _active[i];
+        if (t->is_done()) {
+            _free.push_back(t);
+        } else {
+            _active[kept++] = t;
+        }
+    }
+    // timelines added by callbacks during this update
+    for (size_t i = n; i < _active.size(); i++) _active[kept++] = _active[i];
+    _active.resize(kept);
 }
 }
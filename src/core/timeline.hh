@@ -1,9 +1,10 @@
 #ifndef SRC_CONSTRUCTS_TIMELINE_HH_INCLUDED
 #define SRC_CONSTRUCTS_TIMELINE_HH_INCLUDED
 
-#include <functional>
+#include <deque>
 #include <vector>
 
+#include "callback.hh"
 #include "context.hh"
 
 namespace gdt {
@@ -11,10 +12,21 @@ namespace gdt {
 /**
  * timeline
  *
+ * A sequence of spans, each calling its callback with the frame's elapsed
+ * time and its own progress, from 0 to 1, until its time is up:
+ *
+ *     _tl.wait(1.0f)
+ *        .span(0.5f, [this](float elapsed, float progress) { _alpha = progress; })
+ *        .once([this](float, float) { _done = true; });
+ *
+ * Callbacks are stored in place, so adding spans only allocates when the
+ * span list grows, and restarting a timeline never does. When a frame
+ * takes longer than the current span, update() finishes it and carries
+ * on with the following spans, so a long hitch never drifts the schedule.
  */
 class timeline {
   public:
-    using span_callback_t = std::function<void(float, float)>;
+    using span_callback_t = inplace_function<void(float, float)>;
 
     timeline(bool paused = false);
     timeline& operator=(const timeline&) = delete;
@@ -25,9 +37,19 @@ class timeline {
     timeline& span(float t, span_callback_t f);
     timeline& once(span_callback_t f);
     void update(const gdt::core_context& ctx);
+    void update(float elapsed);
+    void pause() { _paused = true; }
     void resume() { _paused = false; }
     bool is_done() const;
 
+    /** Rewind to the first span, keeping all the spans. */
+    void restart();
+
+    /** Remove all spans, keeping their memory for reuse. */
+    void clear();
+
+    void reserve(size_t spans) { _spans.reserve(spans); }
+
   private:
     struct stored_span {
         float otime;
@@ -35,8 +57,36 @@ class timeline {
         span_callback_t span_callback;
     };
     std::vector<stored_span> _spans;
-    std::vector<stored_span>::iterator _current_span;
+    size_t _current_span = 0;
     bool _paused = false;
 };
+
+/**
+ * A group of timelines updated together in one loop.
+ *
+ * Timelines are reused once they are done, so a group that keeps
+ * starting short sequences settles down to no allocations at all:
+ *
+ *     _effects.add().span(0.2f, flash).wait(0.1f).span(0.2f, fade);
+ *     ...
+ *     _effects.update(ctx);
+ *
+ * A timeline returned by add() belongs to the group, don't hold on to
+ * it once it's done.
+ */
+class timeline_group {
+  public:
+    timeline& add(bool paused = false);
+    void update(const gdt::core_context& ctx);
+    void update(float elapsed);
+
+    /** Number of timelines that are not done yet. */
+    size_t size() const { return _active.size(); }
+
+  private:
+    std::deque<timeline> _timelines;
+    std::vector<timeline*> _active;
+    std::vector<timeline*> _free;
+};
 }
 #endif  // SRC_CONSTRUCTS_TIMELINE_HH_INCLUDED
@@ -327,6 +327,47 @@ struct may_have_transformable<
     }
 };
 
+/**
+ * A view of contiguous objects, for functions taking a whole array of
+ * them at once.
+ */
+template <typename T>
+class span {
+  public:
+    span(T *data, int size) : _data(data), _size(size)
+    {
+    }
+
+    T *data() const
+    {
+        return _data;
+    }
+
+    int size() const
+    {
+        return _size;
+    }
+
+    T *begin() const
+    {
+        return _data;
+    }
+
+    T *end() const
+    {
+        return _data + _size;
+    }
+
+    T &operator[](int i) const
+    {
+        return _data[i];
+    }
+
+  private:
+    T *_data;
+    int _size;
+};
+
 template <typename ACTUAL>
 class asset : public is_entity<ACTUAL>,
               public is_drivable<ACTUAL>
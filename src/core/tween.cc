@@ -0,0 +1,291 @@
+#include "tween.hh"
+#include "simd.hh"
+
+namespace gdt {
+
+tween_handle tween_pool::to(float* target, float from, float to, float duration,
+                            easing_kind kind, done_callback_t done, void* user)
+{
+    return add(FLOAT, target, &from, &to, 1, duration, kind, done, user);
+}
+
+tween_handle tween_pool::to(math::vec3* target, const math::vec3& from, const math::vec3& to,
+                            float duration, easing_kind kind, done_callback_t done,
+                            void* user)
+{
+    float f[3] = {from.x, from.y, from.z};
+    float t[3] = {to.x, to.y, to.z};
+    return add(VEC3, target, f, t, 3, duration, kind, done, user);
+}
+
+tween_handle tween_pool::to(math::vec4* target, const math::vec4& from, const math::vec4& to,
+                            float duration, easing_kind kind, done_callback_t done,
+                            void* user)
+{
+    float f[4] = {from.x, from.y, from.z, from.w};
+    float t[4] = {to.x, to.y, to.z, to.w};
+    return add(VEC4, target, f, t, 4, duration, kind, done, user);
+}
+
+tween_handle tween_pool::to(math::quat* target, const math::quat& from, const math::quat& to,
+                            float duration, easing_kind kind, done_callback_t done,
+                            void* user)
+{
+    float f[4] = {from.x, from.y, from.z, from.w};
+    float t[4] = {to.x, to.y, to.z, to.w};
+    // take the shortest way around
+    if (f[0] * t[0] + f[1] * t[1] + f[2] * t[2] + f[3] * t[3] < 0) {
+        for (auto& c : t) c = -c;
+    }
+    return add(QUAT, target, f, t, 4, duration, kind, done, user);
+}
+
+static int channels_of(int type)
+{
+    return type == 0 ? 1 : (type == 1 ? 3 : 4);
+}
+
+tween_handle tween_pool::add(value_type type, void* target, const float* from,
+                             const float* to, int channels, float duration, easing_kind kind,
+                             done_callback_t done, void* user)
+{
+    uint32_t s;
+    if (!_free.empty()) {
+        s = _free.back();
+        _free.pop_back();
+    } else {
+        s = _slots.size();
+        _slots.emplace_back();
+    }
+    int k = kind * VALUE_TYPES + type;
+    bucket& b = _buckets[k];
+    _slots[s].bucket = k;
+    _slots[s].index = b.size();
+
+    b.elapsed.push_back(0);
+    b.rate.push_back(duration > 0 ? 1.0f / duration : FLT_MAX);
+    for (int c = 0; c < channels; c++) {
+        b.from[c].push_back(from[c]);
+        b.delta[c].push_back(to[c] - from[c]);
+    }
+    b.target.push_back(target);
+    b.done.push_back(done);
+    b.user.push_back(user);
+    b.slot.push_back(s);
+    _active++;
+    return {s, _slots[s].generation};
+}
+
+void tween_pool::remove(int k, uint32_t index)
+{
+    bucket& b = _buckets[k];
+    uint32_t last = b.size() - 1;
+    uint32_t s = b.slot[index];
+    auto pop = [index, last](auto& v) {
+        v[index] = v[last];
+        v.pop_back();
+    };
+    pop(b.elapsed);
+    pop(b.rate);
+    for (int c = 0; c < channels_of(k % VALUE_TYPES); c++) {
+        pop(b.from[c]);
+        pop(b.delta[c]);
+    }
+    pop(b.target);
+    pop(b.done);
+    pop(b.user);
+    pop(b.slot);
+    if (index != last) _slots[b.slot[index]].index = index;
+
+    _slots[s].generation++;
+    _slots[s].index = UINT32_MAX;
+    _free.push_back(s);
+    _active--;
+}
+
+bool tween_pool::is_active(tween_handle h) const
+{
+    return h.index < _slots.size() && _slots[h.index].generation == h.generation &&
+           _slots[h.index].index != UINT32_MAX;
+}
+
+void tween_pool::stop(tween_handle h)
+{
+    if (!is_active(h)) return;
+    remove(_slots[h.index].bucket, _slots[h.index].index);
+}
+
+void tween_pool::finish(tween_handle h)
+{
+    if (!is_active(h)) return;
+    const slot& s = _slots[h.index];
+    _buckets[s.bucket].elapsed[s.index] = FLT_MAX;
+}
+
+void tween_pool::clear()
+{
+    for (auto& b : _buckets) {
+        for (uint32_t s : b.slot) {
+            _slots[s].generation++;
+            _slots[s].index = UINT32_MAX;
+            _free.push_back(s);
+        }
+        b.elapsed.clear();
+        b.rate.clear();
+        for (int c = 0; c < 4; c++) {
+            b.from[c].clear();
+            b.delta[c].clear();
+        }
+        b.target.clear();
+        b.done.clear();
+        b.user.clear();
+        b.slot.clear();
+    }
+    _active = 0;
+}
+
+void tween_pool::reserve(easing_kind kind, size_t n)
+{
+    for (int type = 0; type < VALUE_TYPES; type++) {
+        bucket& b = _buckets[kind * VALUE_TYPES + type];
+        b.elapsed.reserve(n);
+        b.rate.reserve(n);
+        for (int c = 0; c < channels_of(type); c++) {
+            b.from[c].reserve(n);
+            b.delta[c].reserve(n);
+        }
+        b.target.reserve(n);
+        b.done.reserve(n);
+        b.user.reserve(n);
+        b.slot.reserve(n);
+    }
+    _slots.reserve(_slots.size() + n);
+    _free.reserve(_slots.size() + n);
+}
+
+void tween_pool::write(value_type type, bucket& b, size_t first, size_t n, const float* e)
+{
+    void* const* target = b.target.data() + first;
+    const float* f[4];
+    const float* d[4];
+    for (int c = 0; c < channels_of(type); c++) {
+        f[c] = b.from[c].data() + first;
+        d[c] = b.delta[c].data() + first;
+    }
+    switch (type) {
+        case FLOAT:
+            for (size_t i = 0; i < n; i++) {
+                *static_cast<float*>(target[i]) = f[0][i] + d[0][i] * e[i];
+            }
+            break;
+        case VEC3:
+            for (size_t i = 0; i < n; i++) {
+                auto* v = static_cast<math::vec3*>(target[i]);
+                v->x = f[0][i] + d[0][i] * e[i];
+                v->y = f[1][i] + d[1][i] * e[i];
+                v->z = f[2][i] + d[2][i] * e[i];
+            }
+            break;
+        case VEC4:
+            for (size_t i = 0; i < n; i++) {
+                auto* v = static_cast<math::vec4*>(target[i]);
+                v->x = f[0][i] + d[0][i] * e[i];
+                v->y = f[1][i] + d[1][i] * e[i];
+                v->z = f[2][i] + d[2][i] * e[i];
+                v->w = f[3][i] + d[3][i] * e[i];
+            }
+            break;
+        case QUAT:
+            for (size_t i = 0; i < n; i++) {
+                float x = f[0][i] + d[0][i] * e[i];
+                float y = f[1][i] + d[1][i] * e[i];
+                float z = f[2][i] + d[2][i] * e[i];
+                float w = f[3][i] + d[3][i] * e[i];
+                float len = sqrtf(x * x + y * y + z * z + w * w);
+                float inv = len > 0 ? 1.0f / len : 0;
+                auto* q = static_cast<math::quat*>(target[i]);
+                q->x = x * inv;
+                q->y = y * inv;
+                q->z = z * inv;
+                q->w = w * inv;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Adds elapsed to n tweens and writes their clamped progress to e.
+// Returns true if any of them reached the end.
+static bool advance(float* t, const float* rate, float* e, int n, float elapsed)
+{
+    int i = 0;
+    bool finished = false;
+#if defined(GDT_HAS_SIMD)
+    using simd::lanes;
+    const int W = simd::lanes_of<lanes>::width;
+    lanes dt = simd::splat<lanes>(elapsed);
+    lanes one = simd::splat<lanes>(1.0f);
+    simd::lanes_of<lanes>::ints done = {};
+    for (; i + W <= n; i += W) {
+        lanes x, r;
+        simd::load(x, t + i);
+        simd::load(r, rate + i);
+        x += dt;
+        simd::store(t + i, x);
+        x *= r;
+        done |= x >= one;
+        simd::store(e + i, x < one ? x : one);
+    }
+    for (int l = 0; l < W; l++) finished |= done[l] != 0;
+#endif
+    for (; i < n; i++) {
+        t[i] += elapsed;
+        float p = t[i] * rate[i];
+        finished |= p >= 1.0f;
+        e[i] = p < 1.0f ? p : 1.0f;
+    }
+    return finished;
+}
+
+void tween_pool::update(const gdt::core_context& ctx)
+{
+    update(ctx.elapsed);
+}
+
+void tween_pool::update(float elapsed)
+{
+    // Tweens are eased in small chunks, so the eased values never
+    // leave the cache between easing and writing them out.
+    static const int CHUNK = 256;
+    float e[CHUNK];
+    for (int k = 0; k < EASE_KINDS * VALUE_TYPES; k++) {
+        bucket& b = _buckets[k];
+        int n = b.size();
+        if (n == 0) continue;
+        float* t = b.elapsed.data();
+        const float* rate = b.rate.data();
+        bool finished = false;
+        for (int first = 0; first < n; first += CHUNK) {
+            int m = std::min(CHUNK, n - first);
+            finished |= advance(t + first, rate + first, e, m, elapsed);
+            ease_n(easing_kind(k / VALUE_TYPES), e, e, m);
+            write(value_type(k % VALUE_TYPES), b, first, m, e);
+        }
+        if (!finished) continue;
+
+        for (int i = n - 1; i >= 0; i--) {
+            if (t[i] * rate[i] >= 1.0f) {
+                if (b.done[i]) _finished.push_back({b.done[i], b.user[i]});
+                remove(k, i);
+            }
+        }
+    }
+
+    // callbacks may start new tweens, so they only run once all buckets are done
+    for (size_t i = 0; i < _finished.size(); i++) {
+        _finished[i].done(_finished[i].user);
+    }
+    _finished.clear();
+}
+}
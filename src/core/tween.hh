@@ -0,0 +1,142 @@
+#ifndef GDT_TWEEN_HEADER_INCLUDED
+#define GDT_TWEEN_HEADER_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+#include "context.hh"
+#include "easing.hh"
+#include "math.hh"
+
+namespace gdt {
+
+/**
+ * A handle to a tween in a tween_pool. Handles stay safe to use after
+ * their tween finished or was stopped, the pool will simply ignore them.
+ */
+struct tween_handle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+/**
+ * A pool of tweens, each moving a float, vec3, vec4 or quat property
+ * from one value to another over time.
+ *
+ * Where a timeline is great for scripting a sequence of events, a tween
+ * pool is the one to use for animating many properties at once, like UI
+ * elements, lights or props:
+ *
+ *     _tweens.to(&_light.color, math::vec3(0, 0, 0), _color, 0.5f, EASE_SINE_OUT);
+ *     _tweens.to(&_height, 10.0f, 0.0f, 2.0f, EASE_BOUNCE_OUT);
+ *
+ * and somewhere in your scene update:
+ *
+ *     _tweens.update(ctx);
+ *
+ * Tweens are stored as structures of arrays, grouped by their easing and
+ * value type, so one update eases each group with a single ease_n() call
+ * and writes its targets in one branch free pass. Targets are raw pointers and must outlive
+ * their tweens, or be stopped before they go away.
+ *
+ * Quaternion tweens use normalized linear interpolation, always taking
+ * the shortest path.
+ *
+ * A completion callback is a plain function pointer and a user pointer,
+ * so starting a tween never allocates once the pool has grown to size:
+ *
+ *     _tweens.to(&_alpha, 1.0f, 0.0f, 0.3f, EASE_LINEAR,
+ *                [](void* self) { static_cast<menu*>(self)->hide(); }, this);
+ *
+ * Callbacks run at the end of update() and may start new tweens.
+ */
+class tween_pool {
+  public:
+    using done_callback_t = void (*)(void* user);
+
+    tween_pool() = default;
+    tween_pool& operator=(const tween_pool&) = delete;
+    tween_pool(const tween_pool&) = delete;
+
+    tween_handle to(float* target, float from, float to, float duration,
+                    easing_kind kind = EASE_LINEAR, done_callback_t done = nullptr,
+                    void* user = nullptr);
+    tween_handle to(math::vec3* target, const math::vec3& from, const math::vec3& to,
+                    float duration, easing_kind kind = EASE_LINEAR,
+                    done_callback_t done = nullptr, void* user = nullptr);
+    tween_handle to(math::vec4* target, const math::vec4& from, const math::vec4& to,
+                    float duration, easing_kind kind = EASE_LINEAR,
+                    done_callback_t done = nullptr, void* user = nullptr);
+    tween_handle to(math::quat* target, const math::quat& from, const math::quat& to,
+                    float duration, easing_kind kind = EASE_LINEAR,
+                    done_callback_t done = nullptr, void* user = nullptr);
+
+    /**
+     * Stop a tween, leaving its target where it is. The completion
+     * callback is not called.
+     */
+    void stop(tween_handle h);
+
+    /**
+     * Make a tween reach its end value, and call its callback, on the
+     * next update.
+     */
+    void finish(tween_handle h);
+
+    bool is_active(tween_handle h) const;
+
+    /** Number of active tweens. */
+    size_t size() const { return _active; }
+
+    /** Stop all tweens and keep the memory for reuse. */
+    void clear();
+
+    /** Reserve room for n tweens of the given easing. */
+    void reserve(easing_kind kind, size_t n);
+
+    void update(const gdt::core_context& ctx);
+    void update(float elapsed);
+
+  private:
+    enum value_type : uint8_t { FLOAT, VEC3, VEC4, QUAT, VALUE_TYPES };
+
+    struct bucket {
+        std::vector<float> elapsed;
+        std::vector<float> rate;
+        std::vector<float> from[4];
+        std::vector<float> delta[4];
+        std::vector<void*> target;
+        std::vector<done_callback_t> done;
+        std::vector<void*> user;
+        std::vector<uint32_t> slot;
+
+        size_t size() const { return slot.size(); }
+    };
+
+    struct slot {
+        uint32_t generation = 0;
+        uint16_t bucket = 0;
+        uint32_t index = UINT32_MAX;
+    };
+
+    struct finished {
+        done_callback_t done;
+        void* user;
+    };
+
+    tween_handle add(value_type type, void* target, const float* from, const float* to,
+                     int channels, float duration, easing_kind kind, done_callback_t done,
+                     void* user);
+    void remove(int bucket, uint32_t index);
+    void write(value_type type, bucket& b, size_t first, size_t n, const float* e);
+
+    // one bucket per easing kind and value type, at kind * VALUE_TYPES + type
+    bucket _buckets[EASE_KINDS * VALUE_TYPES];
+    std::vector<slot> _slots;
+    std::vector<uint32_t> _free;
+    std::vector<finished> _finished;
+    size_t _active = 0;
+};
+}
+
+#endif  // GDT_TWEEN_HEADER_INCLUDED
@@ -2,6 +2,7 @@
 #define GDT_INCLUDED
 
 #include "core/application.hh"
+#include "core/bounds.hh"
 #include "core/drivers.hh"
 #include "core/extensions.hh"
 #include "core/renderer.hh"
@@ -11,6 +12,17 @@
 #include "core/font.hh"
 #include "core/timeline.hh"
 #include "core/easing.hh"
+#include "core/tween.hh"
+#include "core/jobs.hh"
+#include "core/arena.hh"
+#include "core/replay.hh"
+#include "core/scene_loader.hh"
+#include "core/soa_transforms.hh"
+#include "core/hierarchy.hh"
+#include "core/ecs.hh"
+#include "core/aabb_tree.hh"
+#include "core/culling.hh"
+#include "core/render_queue.hh"
 
 #endif // GDT_INCLUDED
 
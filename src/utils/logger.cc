@@ -1,9 +1,640 @@
 #include "logger.hh"
 
+#include <strings.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 namespace gdt {
-log_recorder logger::recorder;
-logger::severity logger::level = logger::DEBUG;
-bool logger::check_level(logger::severity s) {
-    return (s >= logger::level);
+
+namespace {
+
+// ring slots, each record takes as many as it needs
+const size_t SLOTS = 8192;
+const size_t SLOT_SIZE = 120;
+// longer messages get cut
+const size_t MAX_TEXT = 8 * 1024;
+
+struct record_header {
+    uint64_t time;
+    const char* file;
+    // set for binary messages, which carry raw arguments instead of text
+    const log_site* site;
+    int32_t line;
+    uint32_t size;
+    int32_t severity;
+};
+
+struct alignas(64) slot {
+    std::atomic<uint64_t> sequence;
+    char data[SLOT_SIZE];
+};
+
+size_t slots_for(size_t bytes)
+{
+    return (bytes + SLOT_SIZE - 1) / SLOT_SIZE;
+}
+
+/*
+ * A bounded multi-producer, single-consumer ring, after Dmitry Vyukov's
+ * bounded queue. Every slot carries the position it's free for, or that
+ * position + 1 once it holds data, so producers claim a run of slots
+ * with a single CAS on _head and publish each slot on its own.
+ */
+class ring {
+  public:
+    ring() : _slots(new slot[SLOTS])
+    {
+        for (size_t i = 0; i < SLOTS; i++) _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // false when full
+    bool push(const record_header& h, const char* text)
+    {
+        size_t bytes = sizeof(h) + h.size;
+        uint64_t n = slots_for(bytes);
+        uint64_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            // the consumer frees slots in order, when the last one is
+            // free all of them are
+            uint64_t last = pos + n - 1;
+            uint64_t seq = at(last).sequence.load(std::memory_order_acquire);
+            int64_t diff = int64_t(seq) - int64_t(last);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        size_t done = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            slot& s = at(pos + i);
+            size_t chunk = std::min(SLOT_SIZE, bytes - done);
+            copy(s.data, done, chunk, h, text);
+            done += chunk;
+            s.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // appends the next record's text to out, false when empty
+    bool pop(record_header& h, std::string& out)
+    {
+        if (!ready(_tail)) return false;
+        slot& first = at(_tail);
+        std::memcpy(&h, first.data, sizeof(h));
+        size_t bytes = sizeof(h) + h.size;
+        uint64_t n = slots_for(bytes);
+        size_t done = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            uint64_t pos = _tail + i;
+            // the producer may still be filling the rest in
+            while (!ready(pos)) std::this_thread::yield();
+            slot& s = at(pos);
+            size_t chunk = std::min(SLOT_SIZE, bytes - done);
+            size_t skip = done < sizeof(h) ? std::min(chunk, sizeof(h) - done) : 0;
+            out.append(s.data + skip, chunk - skip);
+            done += chunk;
+            s.sequence.store(pos + SLOTS, std::memory_order_release);
+        }
+        _tail += n;
+        return true;
+    }
+
+    uint64_t head() const
+    {
+        return _head.load(std::memory_order_relaxed);
+    }
+
+  private:
+    slot& at(uint64_t pos)
+    {
+        return _slots[pos & (SLOTS - 1)];
+    }
+
+    bool ready(uint64_t pos)
+    {
+        return at(pos).sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    // copies bytes [offset, offset + size) of header + text
+    static void copy(char* to, size_t offset, size_t size, const record_header& h,
+                     const char* text)
+    {
+        if (offset < sizeof(h)) {
+            size_t n = std::min(size, sizeof(h) - offset);
+            std::memcpy(to, reinterpret_cast<const char*>(&h) + offset, n);
+            to += n;
+            offset += n;
+            size -= n;
+        }
+        if (size) std::memcpy(to, text + offset - sizeof(h), size);
+    }
+
+    std::unique_ptr<slot[]> _slots;
+    alignas(64) std::atomic<uint64_t> _head{0};
+    alignas(64) uint64_t _tail = 0;
+};
+
+class writer {
+  public:
+    writer()
+    {
+        _sinks.push_back(std::make_unique<console_sink>());
+        _thread = std::thread([this]() { run(); });
+        _running.store(true, std::memory_order_release);
+        std::atexit([]() { instance().stop(); });
+    }
+
+    static writer& instance()
+    {
+        // never destroyed, so log calls from static destructors still
+        // find it
+        static writer* w = new writer();
+        return *w;
+    }
+
+    void submit(const record_header& h, const char* text)
+    {
+        if (!_running.load(std::memory_order_acquire)) {
+            write_now(h, text);
+            return;
+        }
+        while (!_ring.push(h, text)) {
+            _wake.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+    void flush()
+    {
+        if (!_running.load(std::memory_order_acquire)) return;
+        uint64_t target = _ring.head();
+        std::unique_lock<std::mutex> lock(_lock);
+        _flush_requested = true;
+        _wake.notify_one();
+        _flushed.wait(lock, [&]() { return _written >= target; });
+    }
+
+    void stop()
+    {
+        if (!_running.exchange(false)) return;
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _stopping = true;
+        }
+        _wake.notify_one();
+        _thread.join();
+        // whatever came in while the thread was on its way out
+        record_header h;
+        std::string text;
+        while (_ring.pop(h, text)) {
+            write_now(h, text.data());
+            text.clear();
+        }
+    }
+
+    void add_sink(std::unique_ptr<log_sink> sink)
+    {
+        std::lock_guard<std::mutex> lock(_sinks_lock);
+        _sinks.push_back(std::move(sink));
+    }
+
+    std::vector<std::unique_ptr<log_sink>> take_sinks()
+    {
+        // the sinks still owe what was logged before
+        flush();
+        std::vector<std::unique_ptr<log_sink>> taken;
+        std::lock_guard<std::mutex> lock(_sinks_lock);
+        taken.swap(_sinks);
+        return taken;
+    }
+
+  private:
+    void run()
+    {
+        record_header h;
+        std::string text;
+        uint64_t written = 0;
+        for (;;) {
+            bool any = false;
+            {
+                std::lock_guard<std::mutex> lock(_sinks_lock);
+                text.clear();
+                while (_ring.pop(h, text)) {
+                    write(h, text.data());
+                    written += slots_for(sizeof(h) + h.size);
+                    text.clear();
+                    any = true;
+                }
+                if (any) {
+                    for (auto& s : _sinks) s->flush();
+                }
+            }
+            std::unique_lock<std::mutex> lock(_lock);
+            _written = written;
+            if (any || _flush_requested) _flushed.notify_all();
+            _flush_requested = false;
+            if (_stopping) break;
+            if (!any) {
+                _wake.wait_for(lock, std::chrono::milliseconds(2),
+                               [&]() { return _flush_requested || _stopping; });
+            }
+        }
+    }
+
+    void write_now(const record_header& h, const char* text)
+    {
+        std::lock_guard<std::mutex> lock(_sinks_lock);
+        write(h, text);
+        for (auto& s : _sinks) s->flush();
+    }
+
+    // with _sinks_lock held
+    void write(const record_header& h, const char* text)
+    {
+        bool formatted = false;
+        for (auto& s : _sinks) {
+            if (h.severity < s->level()) continue;
+            if (h.site && s->write_binary(*h.site, h.time, text, h.size)) continue;
+            if (!formatted) {
+                _line.clear();
+                logger::format_prefix(_line, h.time, logger::severity(h.severity), h.file,
+                                      h.line);
+                if (h.site) {
+                    logger::format_args(_line, *h.site, text, h.size);
+                } else {
+                    _line.append(text, h.size);
+                }
+                _line += '\n';
+                formatted = true;
+            }
+            s->write(_line.data(), _line.size());
+        }
+    }
+
+    ring _ring;
+    std::thread _thread;
+    std::atomic<bool> _running{false};
+
+    std::mutex _lock;
+    std::condition_variable _wake;
+    std::condition_variable _flushed;
+    bool _flush_requested = false;
+    bool _stopping = false;
+    uint64_t _written = 0;
+
+    std::mutex _sinks_lock;
+    std::vector<std::unique_ptr<log_sink>> _sinks;
+    std::string _line;
+};
+
+int initial_level()
+{
+    const char* env = std::getenv("GDT_LOG_LEVEL");
+    if (!env) return logger::DEBUG;
+    for (int s = logger::DEBUG; s <= logger::ERROR; s++) {
+        if (strcasecmp(env, logger::name(logger::severity(s))) == 0) return s;
+    }
+    return logger::DEBUG;
+}
+}
+
+std::atomic<int> logger::_level{initial_level()};
+
+void logger::set_level(severity s)
+{
+    _level.store(s, std::memory_order_relaxed);
+}
+
+logger::severity logger::level()
+{
+    return severity(_level.load(std::memory_order_relaxed));
+}
+
+void logger::add_sink(std::unique_ptr<log_sink> sink)
+{
+    writer::instance().add_sink(std::move(sink));
+}
+
+void logger::clear_sinks()
+{
+    writer::instance().take_sinks();
+}
+
+std::vector<std::unique_ptr<log_sink>> logger::take_sinks()
+{
+    return writer::instance().take_sinks();
+}
+
+void logger::flush()
+{
+    writer::instance().flush();
+}
+
+void logger::submit(severity s, const char* file, int line, uint64_t time, const char* text,
+                    size_t size)
+{
+    record_header h;
+    h.time = time;
+    h.file = file;
+    h.site = nullptr;
+    h.line = line;
+    h.size = uint32_t(std::min(size, MAX_TEXT));
+    h.severity = s;
+    writer::instance().submit(h, text);
+}
+
+void logger::submit_binary(const log_site& site, const char* args, size_t size)
+{
+    record_header h;
+    h.time = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    h.file = site.file;
+    h.site = &site;
+    h.line = site.line;
+    h.size = uint32_t(size);
+    h.severity = site.severity;
+    writer::instance().submit(h, args);
+}
+
+const char* logger::name(severity s)
+{
+    static const char* names[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+    return names[s];
+}
+
+void logger::format_prefix(std::string& out, uint64_t time, severity s, const char* file,
+                           int line)
+{
+    char text[64];
+    int n = snprintf(text, sizeof(text), "%llu [%s] (", (unsigned long long)time, name(s));
+    out.append(text, n);
+    out += file;
+    n = snprintf(text, sizeof(text), ":%d) ", line);
+    out.append(text, n);
+}
+
+void logger::format_args(std::string& out, const log_site& site, const char* args, size_t size)
+{
+    const char* end = args + size;
+    const char* types = site.types;
+    char text[64];
+    for (const char* f = site.format; *f; f++) {
+        if (f[0] != '{' || f[1] != '}' || !*types) {
+            out += *f;
+            continue;
+        }
+        f++;
+        char type = *types++;
+        size_t need = type == 's' ? 4 : type == 'b' || type == 'c' ? 1 : 8;
+        if (args + need > end) {
+            out += "{?}";
+            continue;
+        }
+        int n = 0;
+        switch (type) {
+            case 'b':
+                out += *args ? "true" : "false";
+                break;
+            case 'c':
+                out += *args;
+                break;
+            case 's': {
+                uint32_t length;
+                memcpy(&length, args, 4);
+                length = std::min<size_t>(length, end - args - 4);
+                out.append(args + 4, length);
+                args += length;
+                break;
+            }
+            case 'i': {
+                int64_t v;
+                memcpy(&v, args, 8);
+                n = snprintf(text, sizeof(text), "%lld", (long long)v);
+                break;
+            }
+            case 'u': {
+                uint64_t v;
+                memcpy(&v, args, 8);
+                n = snprintf(text, sizeof(text), "%llu", (unsigned long long)v);
+                break;
+            }
+            case 'p': {
+                uint64_t v;
+                memcpy(&v, args, 8);
+                n = snprintf(text, sizeof(text), "0x%llx", (unsigned long long)v);
+                break;
+            }
+            default: {
+                double v;
+                memcpy(&v, args, 8);
+                n = snprintf(text, sizeof(text), "%g", v);
+                break;
+            }
+        }
+        out.append(text, n);
+        args += need;
+    }
+}
+
+void console_sink::write(const char* line, size_t size)
+{
+    std::cout.write(line, size);
+}
+
+void console_sink::flush()
+{
+    std::cout.flush();
+}
+
+file_sink::file_sink(const std::string& path, logger::severity level)
+    : log_sink(level), _file(std::fopen(path.c_str(), "a"))
+{
+    if (!_file) throw std::runtime_error("cannot open log file " + path);
+}
+
+file_sink::~file_sink()
+{
+    std::fclose(_file);
+}
+
+void file_sink::write(const char* line, size_t size)
+{
+    std::fwrite(line, 1, size, _file);
+}
+
+void file_sink::flush()
+{
+    std::fflush(_file);
+}
+
+rotating_file_sink::rotating_file_sink(const std::string& path, size_t max_bytes, int max_files,
+                                       logger::severity level)
+    : log_sink(level), _path(path), _max_bytes(max_bytes), _max_files(max_files)
+{
+    _file = std::fopen(path.c_str(), "a");
+    if (!_file) throw std::runtime_error("cannot open log file " + path);
+    std::fseek(_file, 0, SEEK_END);
+    _size = std::ftell(_file);
+}
+
+rotating_file_sink::~rotating_file_sink()
+{
+    if (_file) std::fclose(_file);
+}
+
+void rotating_file_sink::write(const char* line, size_t size)
+{
+    if (_size > 0 && _size + size > _max_bytes) rotate();
+    if (!_file) return;
+    _size += std::fwrite(line, 1, size, _file);
+}
+
+void rotating_file_sink::flush()
+{
+    if (_file) std::fflush(_file);
+}
+
+void rotating_file_sink::rotate()
+{
+    std::fclose(_file);
+    for (int i = _max_files - 1; i >= 1; i--) {
+        std::string from = _path + "." + std::to_string(i);
+        std::string to = _path + "." + std::to_string(i + 1);
+        std::rename(from.c_str(), to.c_str());
+    }
+    if (_max_files > 0) {
+        std::rename(_path.c_str(), (_path + ".1").c_str());
+    }
+    // no one to tell if this fails but the console
+    _file = std::fopen(_path.c_str(), "w");
+    if (!_file) std::cerr << "cannot reopen log file " << _path << std::endl;
+    _size = 0;
+}
+
+const char binary_file_sink::MAGIC[8] = {'G', 'D', 'T', 'L', 'O', 'G', '1', '\n'};
+
+binary_file_sink::binary_file_sink(const std::string& path, logger::severity level)
+    : log_sink(level), _file(std::fopen(path.c_str(), "wb"))
+{
+    if (!_file) throw std::runtime_error("cannot open log file " + path);
+    std::fwrite(MAGIC, 1, sizeof(MAGIC), _file);
+}
+
+binary_file_sink::~binary_file_sink()
+{
+    std::fclose(_file);
+}
+
+namespace {
+
+template <typename T>
+void put(std::FILE* f, T value)
+{
+    std::fwrite(&value, sizeof(value), 1, f);
+}
+
+void put_string(std::FILE* f, const char* s)
+{
+    uint32_t n = strlen(s);
+    put(f, n);
+    std::fwrite(s, 1, n, f);
+}
+}
+
+void binary_file_sink::write(const char* line, size_t size)
+{
+    put(_file, 'T');
+    put(_file, uint32_t(size));
+    std::fwrite(line, 1, size, _file);
+}
+
+bool binary_file_sink::write_binary(const log_site& site, uint64_t time, const char* args,
+                                    size_t size)
+{
+    auto it = _sites.find(&site);
+    if (it == _sites.end()) {
+        it = _sites.emplace(&site, uint32_t(_sites.size())).first;
+        put(_file, 'S');
+        put(_file, it->second);
+        put(_file, int32_t(site.severity));
+        put(_file, int32_t(site.line));
+        put_string(_file, site.file);
+        put_string(_file, site.format);
+        put_string(_file, site.types);
+    }
+    put(_file, 'B');
+    put(_file, it->second);
+    put(_file, time);
+    put(_file, uint32_t(size));
+    std::fwrite(args, 1, size, _file);
+    return true;
+}
+
+void binary_file_sink::flush()
+{
+    std::fflush(_file);
+}
+
+// every thread formats into a buffer of its own, reused from message to
+// message
+struct log_record::buffer : std::streambuf {
+    std::string text;
+    std::ostream stream{this};
+    bool busy = false;
+
+    void begin()
+    {
+        text.clear();
+        stream.flags(std::ios_base::dec | std::ios_base::skipws);
+        stream.precision(6);
+        stream.width(0);
+        stream.fill(' ');
+        busy = true;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (c != traits_type::eof()) text += traits_type::to_char_type(c);
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        text.append(s, n);
+        return n;
+    }
+};
+
+log_record::log_record(logger::severity s, const char* file, int line)
+    : _severity(s),
+      _file(file),
+      _line(line),
+      _time(std::chrono::high_resolution_clock::now().time_since_epoch().count())
+{
+    static thread_local buffer local;
+    // logging from inside another message's operator<<
+    _nested = local.busy;
+    _buffer = _nested ? new buffer() : &local;
+    _buffer->begin();
+    _stream = &_buffer->stream;
+}
+
+log_record::~log_record()
+{
+    logger::submit(_severity, _file, _line, _time, _buffer->text.data(), _buffer->text.size());
+    if (_nested) {
+        delete _buffer;
+    } else {
+        _buffer->busy = false;
+    }
 }
 }
@@ -1,105 +1,444 @@
 #ifndef SRC_UTILS_LOGGER_HH_INCLUDED
 #define SRC_UTILS_LOGGER_HH_INCLUDED
 
-#include <iostream>
-#include <sstream>
-#include <chrono>
+#include <stdint.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 #define UNUSED(x) (void)(x)
 
 namespace gdt {
-    class log_record;
-    class log_recorder {
-        public:
-            void operator <<(log_record&& t) {
-                UNUSED(t);
-            }
-    };
+
+class log_sink;
+struct log_site;
+
+/**
+ * GDT provides a stream logger you can use just like you would use
+ * std::cout, with an added severity filtering functionality.
+ *
+ * You don't normally use the logger class directly. Instead, use
+ * the predefined macros (yes, unfortunately macros):
+ *
+ *     LOG_DEBUG << "your debug message " << "goes here..";
+ *     LOG_INFO << "your info message " << "goes here..";
+ *     LOG_WARNING << "your warning message " << "goes here..";
+ *     LOG_ERROR << "your error message " << "goes here..";
+ *
+ * A message below the current level costs a single load, nothing after
+ * the macro is evaluated. The level starts at DEBUG, or at whatever the
+ * GDT_LOG_LEVEL environment variable says (debug, info, warning or
+ * error), and can be changed at any time:
+ *
+ *     gdt::logger::set_level(gdt::logger::WARNING);
+ *
+ * Messages are formatted on the calling thread into a buffer of its
+ * own and pushed to a lock-free ring, from any thread. A background
+ * thread takes them from there and writes them to the sinks, so a log
+ * call never waits on the console or on the disk. Only when the ring is
+ * full does the caller wait for the writer to catch up, so no message
+ * ever gets lost.
+ *
+ * Messages go to the console by default. Add sinks to send them
+ * elsewhere:
+ *
+ *     gdt::logger::add_sink(std::make_unique<gdt::rotating_file_sink>(
+ *         "game.log", 4 * 1024 * 1024, 3));
+ *
+ * The DEBUG_LOGS, INFO_LOGS, WARNING_LOGS and ERROR_LOGS definitions
+ * still take whole levels out at compile time.
+ *
+ * For messages logged very often, say per physics body or per draw
+ * call, there's LOG_BINARY. Its format string is fixed at compile time
+ * and only the raw arguments, numbers, pointers and strings, go
+ * through the ring, so a call costs tens of nanoseconds. Formatting
+ * waits for the background thread, or for later:
+ *
+ *     LOG_BINARY(gdt::logger::DEBUG, "body {} at {} {} {}", id, p.x, p.y, p.z);
+ *
+ * A binary_file_sink keeps such messages unformatted, and the
+ * gdt_log_decode tool turns its file into text.
+ */
+class logger {
+  public:
+    enum severity { DEBUG = 0, INFO, WARNING, ERROR };
+
+    static bool check_level(severity s)
+    {
+        return s >= _level.load(std::memory_order_relaxed);
+    }
+
+    static void set_level(severity s);
+    static severity level();
+
+    /** Send messages to another sink too. Takes effect right away. */
+    static void add_sink(std::unique_ptr<log_sink> sink);
 
     /**
-     * GDT provides a stream logger you can use just like you would use
-     * std::cout, with an added severity filtering functionality.
-     *
-     * You don't normally use the logger class directly. Instead, use
-     * the predefined macros (yes, unfortunately macros):
-     *
-     *     LOG_DEBUG << "your debug message " << "goes here..";
-     *     LOG_INFO << "your info message " << "goes here..";
-     *     LOG_WARNING << "your warning message " << "goes here..";
-     *     LOG_ERROR << "your error message " << "goes here..";
-     *
+     * Remove all sinks, the console one included, once they've written
+     * what was logged so far.
+     */
+    static void clear_sinks();
+
+    /**
+     * Remove all sinks like clear_sinks, handing them over instead of
+     * destroying them, so they can be added back later.
+     */
+    static std::vector<std::unique_ptr<log_sink>> take_sinks();
+
+    /**
+     * Wait until everything logged so far is written and the sinks are
+     * flushed. Done for you at exit.
+     */
+    static void flush();
+
+    /**
+     * Queue a formatted message. You don't normally call this directly,
+     * the macros do.
+     */
+    static void submit(severity s, const char* file, int line, uint64_t time, const char* text,
+                       size_t size);
+
+    /**
+     * Queue a binary message. You don't normally call this directly,
+     * LOG_BINARY does.
+     */
+    static void submit_binary(const log_site& site, const char* args, size_t size);
+
+    static const char* name(severity s);
+
+    /** Append a line's "time [LEVEL] (file:line) " prefix to out. */
+    static void format_prefix(std::string& out, uint64_t time, severity s, const char* file,
+                              int line);
+
+    /** Append a binary message's text to out. */
+    static void format_args(std::string& out, const log_site& site, const char* args,
+                            size_t size);
+
+  private:
+    static std::atomic<int> _level;
+};
+
+/**
+ * Where the logger's background thread writes messages to. Every sink
+ * gets the fully formatted line, newline included, and can have a level
+ * of its own on top of the logger's.
+ */
+class log_sink {
+  public:
+    explicit log_sink(logger::severity level = logger::DEBUG) : _level(level)
+    {
+    }
+    virtual ~log_sink() = default;
+
+    virtual void write(const char* line, size_t size) = 0;
+    virtual void flush()
+    {
+    }
+
+    /**
+     * Take a binary message as it is. Sinks that don't, which is the
+     * default, get it formatted through write.
      *
+     * @return false to have the message formatted
      */
-    class logger {
-        public:
-            enum severity {
-                DEBUG = 0,
-                INFO,
-                WARNING,
-                ERROR
-            };
-
-            static log_recorder recorder;
-            static severity level;
-            static bool check_level(severity s);
-    };
-
-    class log_record {
-        private:
-            std::stringstream _stream;
-        public:
-            log_record() {
-                std::cout << std::chrono::high_resolution_clock::now().time_since_epoch().count() << " ";
-            }
-            virtual ~log_record() {
-                std::cout << str() << std::endl;
-            }
-            operator std::stringstream&() {
-                return _stream;
-            }
-            template <typename T>
-            std::stringstream & operator <<(T&& t) {
-                _stream << t;
-                return _stream;
-            }
-            std::string str() const { return _stream.str(); }
-
-
-    };
+    virtual bool write_binary(const log_site& site, uint64_t time, const char* args, size_t size)
+    {
+        UNUSED(site);
+        UNUSED(time);
+        UNUSED(args);
+        UNUSED(size);
+        return false;
+    }
+
+    logger::severity level() const
+    {
+        return _level;
+    }
 
+  private:
+    logger::severity _level;
+};
 
+/** Writes to std::cout. */
+class console_sink : public log_sink {
+  public:
+    using log_sink::log_sink;
+    void write(const char* line, size_t size) override;
+    void flush() override;
+};
+
+/** Appends to a file. */
+class file_sink : public log_sink {
+  public:
+    explicit file_sink(const std::string& path, logger::severity level = logger::DEBUG);
+    ~file_sink() override;
+    void write(const char* line, size_t size) override;
+    void flush() override;
+
+  private:
+    std::FILE* _file;
+};
+
+/**
+ * Writes to a file until it grows past max_bytes, then renames it to
+ * path.1, path.1 to path.2 and so on, keeping max_files old files, and
+ * starts over.
+ */
+class rotating_file_sink : public log_sink {
+  public:
+    rotating_file_sink(const std::string& path, size_t max_bytes, int max_files,
+                       logger::severity level = logger::DEBUG);
+    ~rotating_file_sink() override;
+    void write(const char* line, size_t size) override;
+    void flush() override;
+
+  private:
+    void rotate();
+
+    std::string _path;
+    size_t _max_bytes;
+    int _max_files;
+    std::FILE* _file = nullptr;
+    size_t _size = 0;
+};
+
+/**
+ * Writes binary messages unformatted, and everything else as text, to
+ * a file for gdt_log_decode:
+ *
+ *     gdt_log_decode game.binlog > game.log
+ *
+ * Every LOG_BINARY site is written once, the first time it logs, with
+ * its format. Each message after that is the site, the time and the
+ * raw arguments, in the byte order of the machine that wrote them.
+ */
+class binary_file_sink : public log_sink {
+  public:
+    static const char MAGIC[8];
+
+    explicit binary_file_sink(const std::string& path, logger::severity level = logger::DEBUG);
+    ~binary_file_sink() override;
+    void write(const char* line, size_t size) override;
+    bool write_binary(const log_site& site, uint64_t time, const char* args,
+                      size_t size) override;
+    void flush() override;
+
+  private:
+    std::FILE* _file;
+    std::unordered_map<const log_site*, uint32_t> _sites;
+};
+
+/**
+ * A LOG_BINARY line's static descriptor. You don't normally use this
+ * directly, the macro declares one for you.
+ *
+ * types holds a character per argument: i for signed integers and
+ * enums, u for unsigned ones, f for floating point, b for bool, c for
+ * char, p for pointers and s for strings.
+ */
+struct log_site {
+    logger::severity severity;
+    const char* file;
+    int line;
+    const char* format;
+    const char* types;
+};
+
+/**
+ * A single message. You don't normally use this directly, the macros
+ * create one for you. It streams into a buffer kept by the calling
+ * thread and queues the result when it goes out of scope.
+ */
+class log_record {
+  public:
+    log_record(logger::severity s, const char* file, int line);
+    ~log_record();
+    log_record(const log_record&) = delete;
+    log_record& operator=(const log_record&) = delete;
+
+    template <typename T>
+    std::ostream& operator<<(const T& t)
+    {
+        return *_stream << t;
+    }
+
+  private:
+    struct buffer;
+
+    logger::severity _severity;
+    const char* _file;
+    int _line;
+    uint64_t _time;
+    buffer* _buffer;
+    bool _nested;
+    std::ostream* _stream;
+};
+
+/** Longest string a LOG_BINARY argument keeps, longer ones get cut. */
+static const size_t LOG_BINARY_STRING = 255;
+
+template <typename T>
+constexpr char log_type_code()
+{
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same<D, bool>::value) {
+        return 'b';
+    } else if constexpr (std::is_same<D, char>::value) {
+        return 'c';
+    } else if constexpr (std::is_same<D, const char*>::value || std::is_same<D, char*>::value ||
+                         std::is_same<D, std::string>::value) {
+        return 's';
+    } else if constexpr (std::is_enum<D>::value ||
+                         (std::is_integral<D>::value && std::is_signed<D>::value)) {
+        return 'i';
+    } else if constexpr (std::is_integral<D>::value) {
+        return 'u';
+    } else if constexpr (std::is_floating_point<D>::value) {
+        return 'f';
+    } else if constexpr (std::is_pointer<D>::value) {
+        return 'p';
+    } else {
+        return 0;
+    }
 }
 
-//#define IF_LOG_(SEVERITY) \
-//    !gdt::logger::check_level(SEVERITY) ? void(0) :
+template <typename... A>
+struct log_types {
+    static_assert(((log_type_code<A>() != 0) && ... && true),
+                  "LOG_BINARY arguments must be numbers, pointers or strings");
+    static constexpr char codes[] = {log_type_code<A>()..., 0};
+    static constexpr size_t count = sizeof...(A);
+    // encoded size, with every string as long as it gets
+    static constexpr size_t max_size =
+        (0 + ... + (log_type_code<A>() == 's' ? 4 + LOG_BINARY_STRING
+                                              : log_type_code<A>() == 'b' ||
+                                                        log_type_code<A>() == 'c'
+                                                    ? 1
+                                                    : 8));
+};
+
+// only ever used in decltype, see LOG_BINARY
+template <typename... A>
+log_types<A...> log_types_of(const A&...);
+
+constexpr size_t log_placeholders(const char* format)
+{
+    size_t n = 0;
+    for (; *format; format++) {
+        if (format[0] == '{' && format[1] == '}') {
+            n++;
+            format++;
+        }
+    }
+    return n;
+}
+
+template <typename T>
+void log_put(char*& p, const T& value)
+{
+    constexpr char code = log_type_code<T>();
+    if constexpr (code == 's') {
+        const char* s;
+        size_t n;
+        if constexpr (std::is_same<std::decay_t<T>, std::string>::value) {
+            s = value.data();
+            n = value.size();
+        } else {
+            s = value;
+            if (!s) s = "(null)";
+            n = strlen(s);
+        }
+        uint32_t size = n < LOG_BINARY_STRING ? n : LOG_BINARY_STRING;
+        memcpy(p, &size, 4);
+        memcpy(p + 4, s, size);
+        p += 4 + size;
+    } else if constexpr (code == 'b' || code == 'c') {
+        *p++ = char(value);
+    } else {
+        using wide = std::conditional_t<
+            code == 'i', int64_t,
+            std::conditional_t<code == 'u' || code == 'p', uint64_t, double>>;
+        wide w;
+        if constexpr (code == 'p') {
+            w = uint64_t(reinterpret_cast<uintptr_t>(value));
+        } else {
+            w = wide(value);
+        }
+        memcpy(p, &w, 8);
+        p += 8;
+    }
+}
+
+/**
+ * Copy a LOG_BINARY line's arguments and queue them. You don't
+ * normally call this directly, the macro does.
+ */
+template <typename... A>
+void log_binary(const log_site& site, const A&... args)
+{
+    char data[log_types<A...>::max_size + 1];
+    char* p = data;
+    (log_put(p, args), ...);
+    logger::submit_binary(site, data, p - data);
+}
+
+/** Swallows the stream at the end of a LOG_ line, see GDT_LOG_. */
+struct log_voidify {
+    void operator&(std::ostream&)
+    {
+    }
+    void operator&(const log_record&)
+    {
+    }
+};
+}
+
+#define GDT_LOG_(SEVERITY)                                               \
+    !gdt::logger::check_level(SEVERITY) ? (void)0                        \
+                                        : gdt::log_voidify() &           \
+                                              gdt::log_record(SEVERITY, __FILE__, __LINE__)
+
+#define GDT_NO_LOG_(SEVERITY) \
+    true ? (void)0 : gdt::log_voidify() & gdt::log_record(SEVERITY, __FILE__, __LINE__)
+
+#define LOG_BINARY(SEVERITY, FORMAT, ...)                                                      \
+    do {                                                                                       \
+        using gdt_log_types_ = decltype(gdt::log_types_of(__VA_ARGS__));                      \
+        static_assert(gdt::log_placeholders(FORMAT) == gdt_log_types_::count,                  \
+                      "LOG_BINARY needs a {} for every argument");                             \
+        static const gdt::log_site gdt_log_site_ = {SEVERITY, __FILE__, __LINE__, FORMAT,      \
+                                                    gdt_log_types_::codes};                    \
+        if (gdt::logger::check_level(SEVERITY)) gdt::log_binary(gdt_log_site_, ##__VA_ARGS__); \
+    } while (0)
+
 #ifdef DEBUG_LOGS
-#define LOG_DEBUG \
-    gdt::log_record() << "[DEBUG] (" << __FILE__ << ":" << __LINE__ << ") "
+#define LOG_DEBUG GDT_LOG_(gdt::logger::DEBUG)
 #else
-#define LOG_DEBUG  if (0) gdt::log_record()
+#define LOG_DEBUG GDT_NO_LOG_(gdt::logger::DEBUG)
 #endif
 
 #ifdef INFO_LOGS
-#define LOG_INFO \
-    gdt::log_record() << "[INFO] (" << __FILE__ << ":" << __LINE__ << ") "
+#define LOG_INFO GDT_LOG_(gdt::logger::INFO)
 #else
-#define LOG_INFO  if (0) gdt::log_record()
+#define LOG_INFO GDT_NO_LOG_(gdt::logger::INFO)
 #endif
 
 #ifdef WARNING_LOGS
-#define LOG_WARNING \
-    gdt::log_record() << "[WARNING] (" << __FILE__ << ":" << __LINE__ << ") "
+#define LOG_WARNING GDT_LOG_(gdt::logger::WARNING)
 #else
-#define LOG_WARNING  if (0) gdt::log_record()
+#define LOG_WARNING GDT_NO_LOG_(gdt::logger::WARNING)
 #endif
 
 #ifdef ERROR_LOGS
-#define LOG_ERROR \
-    gdt::log_record() << "[ERROR] (" << __FILE__ << ":" << __LINE__ << ") "
+#define LOG_ERROR GDT_LOG_(gdt::logger::ERROR)
 #else
-#define LOG_ERROR  if (0) gdt::log_record()
+#define LOG_ERROR GDT_NO_LOG_(gdt::logger::ERROR)
 #endif
 
-
-//    IF_LOG_(gdt::logger::INFO) gdt::log_record() << gdt::logger::ts() << "[INFO] (" << __FILE__ << ":" << __LINE__ << ") "
-
 #endif  // SRC_UTILS_LOGGER_HH_INCLUDED
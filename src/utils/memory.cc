@@ -0,0 +1,251 @@
+#include "memory.hh"
+
+#include <atomic>
+#include <cstdio>
+#include <initializer_list>
+
+#include "imgui/imgui.h"
+
+namespace gdt {
+
+static const char* TAG_NAMES[memory::TAG_COUNT] = {
+    "general", "assets", "meshes", "textures", "instances",
+    "physics", "audio",  "animation", "game",  "debug"};
+
+const char* memory::name(tag t)
+{
+    return t < TAG_COUNT ? TAG_NAMES[t] : "?";
+}
+
+#ifdef MEMORY_TRACKING_IS_ENABLED
+
+namespace {
+
+struct counters {
+    std::atomic<int64_t> current{0};
+    std::atomic<int64_t> peak{0};
+    std::atomic<int64_t> gpu_current{0};
+    std::atomic<int64_t> gpu_peak{0};
+    std::atomic<int64_t> allocations{0};
+    std::atomic<int64_t> allocated_bytes{0};
+    std::atomic<int> frame_allocations{0};
+    std::atomic<int64_t> frame_bytes{0};
+    std::atomic<int> last_frame_allocations{0};
+    std::atomic<int64_t> last_frame_bytes{0};
+};
+
+// Constant initialized, so it's there for allocations made before main.
+counters tag_counters[memory::TAG_COUNT];
+
+thread_local memory::tag current_tag = memory::GENERAL;
+
+// In front of every tracked block, sized to keep the block as aligned
+// as malloc's.
+struct header {
+    uint64_t size;
+    uint64_t tag;
+};
+static_assert(sizeof(header) % alignof(std::max_align_t) == 0, "misaligned header");
+
+void raise_peak(std::atomic<int64_t>& peak, int64_t value)
+{
+    int64_t p = peak.load(std::memory_order_relaxed);
+    while (value > p && !peak.compare_exchange_weak(p, value, std::memory_order_relaxed)) {
+    }
+}
+
+void format_bytes(char* buf, size_t n, int64_t bytes)
+{
+    double b = bytes;
+    if (b >= 1024.0 * 1024.0) {
+        snprintf(buf, n, "%.1f MB", b / (1024.0 * 1024.0));
+    } else if (b >= 1024.0) {
+        snprintf(buf, n, "%.1f KB", b / 1024.0);
+    } else {
+        snprintf(buf, n, "%lld B", (long long)bytes);
+    }
+}
+
+void bytes_column(int64_t bytes)
+{
+    char buf[32];
+    format_bytes(buf, sizeof(buf), bytes);
+    ImGui::Text("%s", buf);
+    ImGui::NextColumn();
+}
+}
+
+void* memory::allocate(size_t bytes, tag t)
+{
+    header* h = static_cast<header*>(std::malloc(sizeof(header) + bytes));
+    if (!h) return nullptr;
+    h->size = bytes;
+    h->tag = t;
+    counters& c = tag_counters[t];
+    int64_t now = c.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    raise_peak(c.peak, now);
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    c.frame_allocations.fetch_add(1, std::memory_order_relaxed);
+    c.frame_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return h + 1;
+}
+
+void memory::deallocate(void* p)
+{
+    if (!p) return;
+    header* h = static_cast<header*>(p) - 1;
+    tag_counters[h->tag].current.fetch_sub(h->size, std::memory_order_relaxed);
+    std::free(h);
+}
+
+void memory::gpu_alloc(tag t, int64_t bytes)
+{
+    counters& c = tag_counters[t];
+    int64_t now = c.gpu_current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    raise_peak(c.gpu_peak, now);
+}
+
+void memory::gpu_free(tag t, int64_t bytes)
+{
+    tag_counters[t].gpu_current.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+memory::tag memory::set_current(tag t)
+{
+    tag previous = current_tag;
+    current_tag = t;
+    return previous;
+}
+
+memory::tag memory::current()
+{
+    return current_tag;
+}
+
+void memory::frame()
+{
+    for (auto& c : tag_counters) {
+        c.last_frame_allocations.store(c.frame_allocations.exchange(0));
+        c.last_frame_bytes.store(c.frame_bytes.exchange(0));
+    }
+}
+
+memory::stats memory::get(tag t)
+{
+    const counters& c = tag_counters[t];
+    stats s;
+    s.current = c.current.load(std::memory_order_relaxed);
+    s.peak = c.peak.load(std::memory_order_relaxed);
+    s.gpu_current = c.gpu_current.load(std::memory_order_relaxed);
+    s.gpu_peak = c.gpu_peak.load(std::memory_order_relaxed);
+    s.allocations = c.allocations.load(std::memory_order_relaxed);
+    s.allocated_bytes = c.allocated_bytes.load(std::memory_order_relaxed);
+    s.frame_allocations = c.last_frame_allocations.load(std::memory_order_relaxed);
+    s.frame_bytes = c.last_frame_bytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+void memory::imgui()
+{
+    ImGui::Columns(7, "memory");
+    for (const char* h : {"tag", "heap", "heap peak", "allocs/frame", "bytes/frame", "gpu",
+                          "gpu peak"}) {
+        ImGui::Text("%s", h);
+        ImGui::NextColumn();
+    }
+    ImGui::Separator();
+    stats total;
+    for (int t = 0; t < TAG_COUNT; t++) {
+        stats s = get(tag(t));
+        if (s.allocations == 0 && s.gpu_peak == 0) continue;
+        ImGui::Text("%s", name(tag(t)));
+        ImGui::NextColumn();
+        bytes_column(s.current);
+        bytes_column(s.peak);
+        ImGui::Text("%d", s.frame_allocations);
+        ImGui::NextColumn();
+        bytes_column(s.frame_bytes);
+        bytes_column(s.gpu_current);
+        bytes_column(s.gpu_peak);
+        total.current += s.current;
+        total.gpu_current += s.gpu_current;
+        total.frame_allocations += s.frame_allocations;
+        total.frame_bytes += s.frame_bytes;
+    }
+    ImGui::Separator();
+    ImGui::Text("total");
+    ImGui::NextColumn();
+    bytes_column(total.current);
+    ImGui::NextColumn();
+    ImGui::Text("%d", total.frame_allocations);
+    ImGui::NextColumn();
+    bytes_column(total.frame_bytes);
+    bytes_column(total.gpu_current);
+    ImGui::NextColumn();
+    ImGui::Columns(1);
+}
+
+#endif
+}
+
+#ifdef MEMORY_TRACKING_IS_ENABLED
+
+// Every new and delete in the program goes through the tracker,
+// charged to the current thread's tag.
+
+void* operator new(size_t bytes)
+{
+    void* p = gdt::memory::allocate(bytes, gdt::memory::current());
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t bytes)
+{
+    void* p = gdt::memory::allocate(bytes, gdt::memory::current());
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+    return gdt::memory::allocate(bytes, gdt::memory::current());
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+    return gdt::memory::allocate(bytes, gdt::memory::current());
+}
+
+void operator delete(void* p) noexcept
+{
+    gdt::memory::deallocate(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    gdt::memory::deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    gdt::memory::deallocate(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    gdt::memory::deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    gdt::memory::deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    gdt::memory::deallocate(p);
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef SRC_UTILS_MEMORY_HH_INCLUDED
+#define SRC_UTILS_MEMORY_HH_INCLUDED
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace gdt {
+
+/**
+ * GDT keeps count of the memory every subsystem holds. Allocations are
+ * charged to a tag: the tag of the innermost memory::scope on the
+ * current thread,
+ *
+ *     {
+ *         gdt::memory::scope tag(gdt::memory::AUDIO);
+ *         _music = load_ogg("res/music.ogg");   // all charged to AUDIO
+ *     }
+ *
+ * or a fixed one, for containers using a tagged_allocator:
+ *
+ *     std::vector<contact, gdt::tagged_allocator<contact, gdt::memory::PHYSICS>> _contacts;
+ *
+ * Global operator new and delete are replaced to do the counting, so
+ * everything allocated with new is charged somewhere, GENERAL when no
+ * scope is open. Bullet allocates through memory::allocate, charged to
+ * PHYSICS.
+ *
+ * GPU memory can't be seen from here, so the graphics backends report
+ * an estimate for each buffer and texture they create with gpu_alloc
+ * and gpu_free.
+ *
+ * The current and peak bytes and the allocations made during the last
+ * frame show in core_context::imgui, or query them with memory::get.
+ *
+ * All of it compiles to plain malloc and free, and no global operator
+ * new, unless MEMORY_TRACKING_IS_ENABLED is defined (the
+ * MEMORY_TRACKING_IS_ENABLED CMake option, off by default). Leave it
+ * off for release builds: every heap block carries a 16 byte header
+ * while it's on.
+ */
+class memory {
+  public:
+    enum tag : uint8_t {
+        GENERAL,
+        ASSETS,
+        MESHES,
+        TEXTURES,
+        INSTANCES,
+        PHYSICS,
+        AUDIO,
+        ANIMATION,
+        GAME,
+        DEBUG,
+        TAG_COUNT
+    };
+
+    struct stats {
+        int64_t current = 0;
+        int64_t peak = 0;
+        int64_t gpu_current = 0;
+        int64_t gpu_peak = 0;
+        int64_t allocations = 0;
+        int64_t allocated_bytes = 0;
+        // during the last frame
+        int frame_allocations = 0;
+        int64_t frame_bytes = 0;
+    };
+
+#ifdef MEMORY_TRACKING_IS_ENABLED
+    /** Charges the current thread's allocations to t while alive. */
+    class scope {
+      public:
+        explicit scope(tag t) : _previous(memory::set_current(t))
+        {
+        }
+        ~scope()
+        {
+            memory::set_current(_previous);
+        }
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+      private:
+        tag _previous;
+    };
+
+    /** Allocate a heap block charged to t. Free it with deallocate. */
+    static void* allocate(size_t bytes, tag t);
+    static void deallocate(void* p);
+
+    static void gpu_alloc(tag t, int64_t bytes);
+    static void gpu_free(tag t, int64_t bytes);
+
+    /** Set the current thread's tag, returning the previous one. */
+    static tag set_current(tag t);
+    static tag current();
+
+    /**
+     * Close the current frame's allocation counts.
+     * Called by gdt::application at the end of every frame.
+     */
+    static void frame();
+
+    /** Draw the per tag table with ImGui. */
+    static void imgui();
+
+    static stats get(tag t);
+#else
+    class scope {
+      public:
+        explicit scope([[maybe_unused]] tag t)
+        {
+        }
+    };
+    static void* allocate(size_t bytes, [[maybe_unused]] tag t)
+    {
+        return std::malloc(bytes);
+    }
+    static void deallocate(void* p)
+    {
+        std::free(p);
+    }
+    static void gpu_alloc([[maybe_unused]] tag t, [[maybe_unused]] int64_t bytes)
+    {
+    }
+    static void gpu_free([[maybe_unused]] tag t, [[maybe_unused]] int64_t bytes)
+    {
+    }
+    static tag set_current([[maybe_unused]] tag t)
+    {
+        return GENERAL;
+    }
+    static tag current()
+    {
+        return GENERAL;
+    }
+    static void frame()
+    {
+    }
+    static void imgui()
+    {
+    }
+    static stats get([[maybe_unused]] tag t)
+    {
+        return stats();
+    }
+#endif
+
+    static const char* name(tag t);
+};
+
+/**
+ * A standard allocator charging everything to TAG, whichever scope is
+ * open at the time.
+ */
+template <typename T, memory::tag TAG>
+struct tagged_allocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = tagged_allocator<U, TAG>;
+    };
+
+    tagged_allocator() = default;
+    template <typename U>
+    tagged_allocator(const tagged_allocator<U, TAG>&)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        void* p = memory::allocate(n * sizeof(T), TAG);
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t)
+    {
+        memory::deallocate(p);
+    }
+};
+
+template <typename T, typename U, memory::tag TAG>
+bool operator==(const tagged_allocator<T, TAG>&, const tagged_allocator<U, TAG>&)
+{
+    return true;
+}
+
+template <typename T, typename U, memory::tag TAG>
+bool operator!=(const tagged_allocator<T, TAG>&, const tagged_allocator<U, TAG>&)
+{
+    return false;
+}
+}
+
+#endif  // SRC_UTILS_MEMORY_HH_INCLUDED
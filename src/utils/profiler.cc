@@ -0,0 +1,541 @@
+#include "profiler.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "imgui/imgui.h"
+#include "logger.hh"
+
+namespace gdt {
+
+namespace {
+
+enum event_kind : uint32_t { BEGIN, END, COUNTER };
+
+struct event {
+    uint64_t time;
+    uint32_t site;
+    uint32_t kind;
+    float value;
+};
+
+struct node {
+    uint32_t site;
+    int parent;
+    std::vector<int> children;
+    uint64_t frame_ns = 0;
+    int frame_calls = 0;
+    std::vector<float> history;
+    std::vector<int> calls;
+    int next = 0;
+    int filled = 0;
+};
+
+// Events are written by the owning thread only and read by whoever
+// calls profiler::frame, so a single producer single consumer ring
+// is all the synchronization we need.
+struct thread_ring {
+    static const uint32_t CAPACITY = 1 << 14;
+    event events[CAPACITY];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    std::string name;
+
+    // consumer side, touched by profiler::frame only
+    struct open_zone {
+        int node;
+        uint64_t start;
+    };
+    std::vector<node> nodes;
+    std::vector<open_zone> stack;
+    // raw events of the last captured frames, see profiler::set_capture
+    std::vector<std::vector<event>> captured;
+
+    void push(uint32_t site, uint32_t kind, float value = 0)
+    {
+        push_at(profiler::now(), site, kind, value);
+    }
+
+    void push_at(uint64_t time, uint32_t site, uint32_t kind, float value = 0)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events[h & (CAPACITY - 1)] = {time, site, kind, value};
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+// a site for a name only known at run time, see profiler::site_id
+struct named_site {
+    std::string name;
+    profiler::site site;
+    explicit named_site(const std::string& n) : name(n), site(name.c_str(), "", 0)
+    {
+    }
+};
+
+struct registry {
+    std::mutex lock;
+    std::vector<const profiler::site*> sites;
+    // threads and tracks, see profiler::add_track
+    std::vector<std::unique_ptr<thread_ring>> threads;
+    std::unordered_map<std::string, uint32_t> named;
+    std::vector<std::unique_ptr<named_site>> named_sites;
+    int window = 120;
+
+    // the last value of every counter, by site id, NAN for zones
+    std::vector<float> counters;
+
+    uint64_t frames = 0;
+    uint64_t last_frame = 0;
+
+    // capture ring, one slot per frame
+    int capture = 0;
+    int capture_next = 0;
+    int captured = 0;
+    std::vector<uint64_t> frame_begin;
+    std::vector<uint64_t> frame_end;
+
+    float threshold = 0;
+    std::string threshold_path;
+    uint64_t last_hitch = 0;
+};
+
+registry& get_registry()
+{
+    static registry r;
+    return r;
+}
+
+thread_local thread_ring* current_ring = nullptr;
+
+thread_ring* get_ring()
+{
+    if (current_ring) return current_ring;
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.threads.push_back(std::make_unique<thread_ring>());
+    current_ring = r.threads.back().get();
+    current_ring->name = "thread " + std::to_string(r.threads.size() - 1);
+    return current_ring;
+}
+
+int add_node(thread_ring& t, uint32_t site, int parent, int window)
+{
+    t.nodes.emplace_back();
+    node& n = t.nodes.back();
+    n.site = site;
+    n.parent = parent;
+    n.history.assign(window, 0);
+    n.calls.assign(window, 0);
+    int i = t.nodes.size() - 1;
+    if (parent >= 0) t.nodes[parent].children.push_back(i);
+    return i;
+}
+
+int child_of(thread_ring& t, int parent, uint32_t site, int window)
+{
+    for (int c : t.nodes[parent].children) {
+        if (t.nodes[c].site == site) return c;
+    }
+    return add_node(t, site, parent, window);
+}
+
+void drain(registry& r, thread_ring& t)
+{
+    int window = r.window;
+    if (t.nodes.empty()) add_node(t, UINT32_MAX, -1, window);
+    std::vector<event>* capture = nullptr;
+    if (r.capture > 0) {
+        if (int(t.captured.size()) != r.capture) t.captured.resize(r.capture);
+        capture = &t.captured[r.capture_next];
+        capture->clear();
+    }
+    uint32_t tail = t.tail.load(std::memory_order_relaxed);
+    uint32_t head = t.head.load(std::memory_order_acquire);
+    for (; tail != head; tail++) {
+        const event& e = t.events[tail & (thread_ring::CAPACITY - 1)];
+        if (capture) capture->push_back(e);
+        if (e.kind == COUNTER) {
+            r.counters[e.site] = e.value;
+            continue;
+        }
+        if (e.kind == BEGIN) {
+            int parent = t.stack.empty() ? 0 : t.stack.back().node;
+            t.stack.push_back({child_of(t, parent, e.site, window), e.time});
+            continue;
+        }
+        // an end without a matching begin, most likely dropped, is ignored,
+        // and zones left open inside it are closed along with it
+        auto match = std::find_if(t.stack.rbegin(), t.stack.rend(), [&](const auto& z) {
+            return t.nodes[z.node].site == e.site;
+        });
+        if (match == t.stack.rend()) continue;
+        while (!t.stack.empty()) {
+            auto z = t.stack.back();
+            t.stack.pop_back();
+            node& n = t.nodes[z.node];
+            n.frame_ns += e.time - z.start;
+            n.frame_calls++;
+            if (n.site == e.site) break;
+        }
+    }
+    t.tail.store(tail, std::memory_order_release);
+}
+
+void roll(thread_ring& t, int window)
+{
+    for (auto& n : t.nodes) {
+        n.history[n.next] = n.frame_ns / 1000000.0f;
+        n.calls[n.next] = n.frame_calls;
+        n.next = (n.next + 1) % window;
+        n.filled = std::min(n.filled + 1, window);
+        n.frame_ns = 0;
+        n.frame_calls = 0;
+    }
+}
+
+profiler::stats stats_of(const node& n)
+{
+    profiler::stats s;
+    if (n.filled == 0) return s;
+    std::vector<float> v(n.history.begin(), n.history.begin() + n.filled);
+    float total = 0;
+    int calls = 0;
+    for (int i = 0; i < n.filled; i++) {
+        total += v[i];
+        calls += n.calls[i];
+    }
+    auto range = std::minmax_element(v.begin(), v.end());
+    s.min = *range.first;
+    s.max = *range.second;
+    s.avg = total / n.filled;
+    s.calls = float(calls) / n.filled;
+    s.frames = n.filled;
+    int p = std::max(0, int(std::ceil(0.95f * n.filled)) - 1);
+    std::nth_element(v.begin(), v.begin() + p, v.end());
+    s.p95 = v[p];
+    return s;
+}
+
+uint64_t total_dropped(const registry& r)
+{
+    uint64_t d = 0;
+    for (auto& t : r.threads) d += t->dropped.load(std::memory_order_relaxed);
+    return d;
+}
+
+void write_name(std::ostream& os, const char* name)
+{
+    os << '"';
+    for (const char* c = name; *c; c++) {
+        if (*c == '"' || *c == '\\') os << '\\';
+        if (*c >= 0 && *c < 0x20) continue;
+        os << *c;
+    }
+    os << '"';
+}
+
+const char* name_of(const registry& r, const thread_ring& t, const node& n)
+{
+    return n.site == UINT32_MAX ? t.name.c_str() : r.sites[n.site]->name;
+}
+
+void imgui_node(const registry& r, const thread_ring& t, int i)
+{
+    const node& n = t.nodes[i];
+    auto s = stats_of(n);
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
+    if (n.children.empty()) flags |= ImGuiTreeNodeFlags_Leaf;
+    bool open;
+    if (n.site == UINT32_MAX) {
+        open = ImGui::TreeNodeEx(&n, flags, "%s", name_of(r, t, n));
+    } else {
+        open = ImGui::TreeNodeEx(&n, flags, "%s  avg %.3f  p95 %.3f  max %.3f ms  (%.1f calls)",
+                                 name_of(r, t, n), s.avg, s.p95, s.max, s.calls);
+    }
+    if (!open) return;
+    for (int c : n.children) imgui_node(r, t, c);
+    ImGui::TreePop();
+}
+}
+
+profiler::site::site(const char* name, const char* file, int line)
+    : name(name), file(file), line(line)
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    id = r.sites.size();
+    r.sites.push_back(this);
+    r.counters.push_back(NAN);
+}
+
+void profiler::begin(uint32_t site)
+{
+    get_ring()->push(site, BEGIN);
+}
+
+void profiler::end(uint32_t site)
+{
+    get_ring()->push(site, END);
+}
+
+void profiler::counter(uint32_t site, float value)
+{
+    get_ring()->push(site, COUNTER, value);
+}
+
+void profiler::frame()
+{
+    registry& r = get_registry();
+    std::string hitch;
+    float threshold = 0;
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        uint64_t time = now();
+        for (auto& t : r.threads) {
+            drain(r, *t);
+            roll(*t, r.window);
+        }
+        if (r.capture > 0) {
+            r.frame_begin[r.capture_next] = r.last_frame ? r.last_frame : time;
+            r.frame_end[r.capture_next] = time;
+            r.capture_next = (r.capture_next + 1) % r.capture;
+            r.captured = std::min(r.captured + 1, r.capture);
+        }
+        // write at most one capture per window, so a slow stretch
+        // doesn't turn into a trace per frame
+        float ms = r.last_frame ? (time - r.last_frame) / 1000000.0f : 0;
+        if (r.threshold > 0 && ms > r.threshold &&
+            (r.last_hitch == 0 || r.frames - r.last_hitch >= uint64_t(r.capture))) {
+            r.last_hitch = r.frames;
+            hitch = r.threshold_path;
+            threshold = r.threshold;
+        }
+        r.last_frame = time;
+        r.frames++;
+    }
+    if (!hitch.empty()) {
+        LOG_INFO << "frame took longer than " << threshold << "ms, writing " << hitch;
+        write_trace(hitch);
+    }
+}
+
+void profiler::imgui()
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (auto& t : r.threads) {
+        if (!t->nodes.empty()) imgui_node(r, *t, 0);
+    }
+    for (size_t i = 0; i < r.counters.size(); i++) {
+        if (!std::isnan(r.counters[i])) ImGui::Text("%s: %g", r.sites[i]->name, r.counters[i]);
+    }
+    uint64_t d = total_dropped(r);
+    if (d > 0) ImGui::Text("%llu events dropped", (unsigned long long)d);
+}
+
+bool profiler::find(const char* name, stats& out)
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (auto& t : r.threads) {
+        for (auto& n : t->nodes) {
+            if (n.site != UINT32_MAX && strcmp(r.sites[n.site]->name, name) == 0) {
+                out = stats_of(n);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void profiler::set_thread_name(const char* name)
+{
+    thread_ring* t = get_ring();
+    std::lock_guard<std::mutex> guard(get_registry().lock);
+    t->name = name;
+}
+
+void profiler::set_window(int frames)
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.window = std::max(1, frames);
+    for (auto& t : r.threads) {
+        for (auto& n : t->nodes) {
+            n.history.assign(r.window, 0);
+            n.calls.assign(r.window, 0);
+            n.next = 0;
+            n.filled = 0;
+        }
+    }
+}
+
+uint64_t profiler::dropped()
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    return total_dropped(r);
+}
+
+uint32_t profiler::site_id(const std::string& name)
+{
+    registry& r = get_registry();
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        auto it = r.named.find(name);
+        if (it != r.named.end()) return it->second;
+    }
+    // the site registers itself, so it's made without holding the lock
+    auto s = std::make_unique<named_site>(name);
+    std::lock_guard<std::mutex> guard(r.lock);
+    auto it = r.named.emplace(name, s->site.id).first;
+    r.named_sites.push_back(std::move(s));
+    return it->second;
+}
+
+uint32_t profiler::add_track(const char* name)
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.threads.push_back(std::make_unique<thread_ring>());
+    r.threads.back()->name = name;
+    return r.threads.size() - 1;
+}
+
+void profiler::track_begin(uint32_t track, uint32_t site, uint64_t time)
+{
+    registry& r = get_registry();
+    thread_ring* t;
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        t = r.threads[track].get();
+    }
+    t->push_at(time, site, BEGIN);
+}
+
+void profiler::track_end(uint32_t track, uint32_t site, uint64_t time)
+{
+    registry& r = get_registry();
+    thread_ring* t;
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        t = r.threads[track].get();
+    }
+    t->push_at(time, site, END);
+}
+
+void profiler::set_capture(int frames)
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.capture = std::max(0, frames);
+    r.capture_next = 0;
+    r.captured = 0;
+    r.frame_begin.assign(r.capture, 0);
+    r.frame_end.assign(r.capture, 0);
+    for (auto& t : r.threads) {
+        t->captured.clear();
+        t->captured.resize(r.capture);
+    }
+}
+
+int profiler::capture_frames()
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    return r.capture;
+}
+
+void profiler::set_capture_threshold(float ms, const std::string& path)
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.threshold = ms;
+    r.threshold_path = path;
+    r.last_hitch = 0;
+}
+
+bool profiler::write_trace(const std::string& path)
+{
+    registry& r = get_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    if (r.captured == 0) {
+        LOG_WARNING << "no frames captured, call profiler::set_capture first";
+        return false;
+    }
+    std::ofstream os(path);
+    if (!os) {
+        LOG_ERROR << "can't write trace to " << path;
+        return false;
+    }
+
+    int first = (r.capture_next - r.captured + r.capture) % r.capture;
+    uint64_t origin = r.frame_begin[first];
+    char ts[32];
+    auto time = [&](uint64_t t) {
+        // microseconds, relative to the first captured frame
+        snprintf(ts, sizeof(ts), "%.3f", t >= origin ? (t - origin) / 1000.0 : 0.0);
+        return ts;
+    };
+
+    // frames get a track of their own, after all the threads
+    int frames_tid = r.threads.size();
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"gdt\"}}";
+    for (size_t i = 0; i < r.threads.size(); i++) {
+        os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+           << ",\"args\":{\"name\":";
+        write_name(os, r.threads[i]->name.c_str());
+        os << "}}";
+    }
+    os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << frames_tid
+       << ",\"args\":{\"name\":\"frames\"}}";
+
+    for (int f = 0; f < r.captured; f++) {
+        int slot = (first + f) % r.capture;
+        uint64_t frame = r.frames - r.captured + f;
+        os << ",\n{\"name\":\"frame " << frame << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+           << frames_tid << ",\"ts\":" << time(r.frame_begin[slot]);
+        os << ",\"dur\":" << (r.frame_end[slot] - r.frame_begin[slot]) / 1000.0 << "}";
+    }
+
+    for (size_t i = 0; i < r.threads.size(); i++) {
+        const thread_ring& t = *r.threads[i];
+        if (int(t.captured.size()) != r.capture) continue;
+        // ends of zones that began before the capture are left out
+        int depth = 0;
+        for (int f = 0; f < r.captured; f++) {
+            for (const event& e : t.captured[(first + f) % r.capture]) {
+                if (e.kind == END && depth == 0) continue;
+                depth += e.kind == BEGIN ? 1 : (e.kind == END ? -1 : 0);
+                os << ",\n{\"name\":";
+                write_name(os, r.sites[e.site]->name);
+                os << ",\"pid\":1,\"tid\":" << i << ",\"ts\":" << time(e.time);
+                if (e.kind == COUNTER) {
+                    os << ",\"ph\":\"C\",\"args\":{\"value\":" << e.value << "}}";
+                } else {
+                    os << ",\"ph\":\"" << (e.kind == BEGIN ? 'B' : 'E') << "\"}";
+                }
+            }
+        }
+    }
+    os << "\n]}\n";
+    LOG_INFO << "wrote " << r.captured << " frames of trace to " << path;
+    return bool(os);
+}
+}
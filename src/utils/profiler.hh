@@ -0,0 +1,204 @@
+#ifndef SRC_UTILS_PROFILER_HH_INCLUDED
+#define SRC_UTILS_PROFILER_HH_INCLUDED
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+
+namespace gdt {
+
+/**
+ * GDT comes with a hierarchical, low overhead CPU profiler. You mark the
+ * code you want to measure with scoped zones, using the predefined macro:
+ *
+ *     void update(const my_app::context & ctx) override {
+ *         PROFILE_SCOPE("scene update");
+ *         {
+ *             PROFILE_SCOPE("ai");
+ *             ...
+ *         }
+ *         render(ctx);
+ *     }
+ *
+ * Each zone gets a static site descriptor the first time it runs, so
+ * entering and leaving a zone is just two timestamps pushed to a ring
+ * buffer owned by the current thread. No strings, no lookups, no locks.
+ *
+ * The application calls profiler::frame once per frame. It drains all
+ * thread rings, rebuilds the zone tree, nesting included, and keeps a
+ * sliding window of per-frame times for every zone, which you can see
+ * in core_context::imgui or query with profiler::find.
+ *
+ * Counters, like the number of draw calls, are recorded the same way:
+ *
+ *     PROFILE_COUNTER("visible lights", _lights.size());
+ *
+ * To see what happened inside a hitch, have the profiler keep the events
+ * of the last frames around and write them as a Chrome trace, which you
+ * can open in chrome://tracing or https://ui.perfetto.dev:
+ *
+ *     gdt::profiler::set_capture(120);
+ *     ...
+ *     gdt::profiler::write_trace("hitch.json");
+ *
+ * or let it write one by itself whenever a frame takes too long:
+ *
+ *     gdt::profiler::set_capture_threshold(50, "hitch.json");
+ *
+ * Graphics backends that support timer queries also time every render
+ * pass and pipeline on the GPU. Those zones show on a "gpu" track of
+ * their own, next to the threads, in the zone tree and in traces.
+ *
+ * Zones and counters compile to nothing unless PROFILER_IS_ENABLED is
+ * defined (the PROFILER_IS_ENABLED CMake option).
+ */
+class profiler {
+  public:
+    /**
+     * A zone's static descriptor. You don't normally use this directly,
+     * PROFILE_SCOPE declares one for you.
+     */
+    struct site {
+        const char* name;
+        const char* file;
+        int line;
+        uint32_t id;
+        site(const char* name, const char* file, int line);
+    };
+
+    class scope {
+      public:
+        explicit scope(const site& s) : _id(s.id)
+        {
+            profiler::begin(_id);
+        }
+        ~scope()
+        {
+            profiler::end(_id);
+        }
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+      private:
+        uint32_t _id;
+    };
+
+    /**
+     * Per-frame time of a zone, in milliseconds, over the sliding window.
+     */
+    struct stats {
+        float min = 0;
+        float avg = 0;
+        float p95 = 0;
+        float max = 0;
+        float calls = 0;
+        int frames = 0;
+    };
+
+    static void begin(uint32_t site);
+    static void end(uint32_t site);
+    static void counter(uint32_t site, float value);
+
+    /**
+     * Drain all threads' events and close the current frame.
+     * Called by gdt::application at the end of every frame.
+     */
+    static void frame();
+
+    /** Draw the zone tree with ImGui. */
+    static void imgui();
+
+    /**
+     * Stats of the first zone with the given name, searching all threads.
+     *
+     * @return false if there's no such zone
+     */
+    static bool find(const char* name, stats& out);
+
+    /** Name the calling thread, as shown in the zone tree. */
+    static void set_thread_name(const char* name);
+
+    /** Number of frames the statistics are calculated over. */
+    static void set_window(int frames);
+
+    /**
+     * Keep all events of the last frames around for write_trace.
+     *
+     * @param frames number of frames to keep, 0 to stop capturing
+     */
+    static void set_capture(int frames);
+
+    static int capture_frames();
+
+    /**
+     * Write the captured frames as Chrome Trace Event JSON, including
+     * zones from all threads, frame markers and counters.
+     *
+     * @return false if there's nothing captured or the file can't be written
+     */
+    static bool write_trace(const std::string& path);
+
+    /**
+     * Write a trace to path whenever a frame takes longer than ms,
+     * at most once every captured window. Needs set_capture.
+     *
+     * @param ms frame time threshold, 0 to turn it off
+     */
+    static void set_capture_threshold(float ms, const std::string& path);
+
+    /** Number of events dropped because a thread's ring buffer was full. */
+    static uint64_t dropped();
+
+    /**
+     * The site id of a zone named at run time, like after a shader.
+     * The same name always gets the same id.
+     */
+    static uint32_t site_id(const std::string& name);
+
+    /**
+     * A track for zones timed away from the CPU threads, like on the
+     * GPU. It shows in the zone tree and traces like a thread does.
+     */
+    static uint32_t add_track(const char* name);
+
+    /**
+     * Record a zone boundary on a track. Times are on profiler::now's
+     * clock, and only one thread may record on a track. Zones must nest,
+     * and come in the order they began and ended.
+     */
+    static void track_begin(uint32_t track, uint32_t site, uint64_t time);
+    static void track_end(uint32_t track, uint32_t site, uint64_t time);
+
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+};
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef PROFILER_IS_ENABLED
+#define PROFILE_SCOPE(NAME)                                                  \
+    static const gdt::profiler::site PROFILE_CONCAT(_profile_site_, __LINE__)( \
+        NAME, __FILE__, __LINE__);                                           \
+    gdt::profiler::scope PROFILE_CONCAT(_profile_scope_, __LINE__)(           \
+        PROFILE_CONCAT(_profile_site_, __LINE__))
+#define PROFILE_COUNTER(NAME, VALUE)                                           \
+    do {                                                                       \
+        static const gdt::profiler::site _profile_counter(NAME, __FILE__, __LINE__); \
+        gdt::profiler::counter(_profile_counter.id, float(VALUE));             \
+    } while (0)
+#else
+#define PROFILE_SCOPE(NAME) \
+    do {                    \
+    } while (0)
+#define PROFILE_COUNTER(NAME, VALUE) \
+    do {                             \
+    } while (0)
+#endif
+
+#endif  // SRC_UTILS_PROFILER_HH_INCLUDED
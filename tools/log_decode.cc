@@ -0,0 +1,102 @@
+// Turns a binary log, as written by gdt::binary_file_sink, into text:
+//
+//     gdt_log_decode game.binlog > game.log
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/logger.hh"
+
+namespace {
+
+struct site {
+    gdt::log_site site;
+    std::string file;
+    std::string format;
+    std::string types;
+};
+
+template <typename T>
+bool get(std::FILE* f, T& value)
+{
+    return std::fread(&value, sizeof(value), 1, f) == 1;
+}
+
+bool get_bytes(std::FILE* f, std::string& out, uint32_t n)
+{
+    out.resize(n);
+    return std::fread(&out[0], 1, n, f) == n;
+}
+
+bool get_string(std::FILE* f, std::string& out)
+{
+    uint32_t n;
+    return get(f, n) && get_bytes(f, out, n);
+}
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <binary log>\n", argv[0]);
+        return 1;
+    }
+    std::FILE* f = std::fopen(argv[1], "rb");
+    if (!f) {
+        std::fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    char magic[sizeof(gdt::binary_file_sink::MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+        memcmp(magic, gdt::binary_file_sink::MAGIC, sizeof(magic)) != 0) {
+        std::fprintf(stderr, "%s is not a binary log\n", argv[1]);
+        return 1;
+    }
+    // sites point into themselves, so they don't move
+    std::vector<std::unique_ptr<site>> sites;
+    std::string bytes;
+    std::string line;
+    char kind;
+    while (get(f, kind)) {
+        bool ok = false;
+        if (kind == 'T') {
+            uint32_t n;
+            ok = get(f, n) && get_bytes(f, bytes, n);
+            if (ok) std::fwrite(bytes.data(), 1, bytes.size(), stdout);
+        } else if (kind == 'S') {
+            auto s = std::make_unique<site>();
+            uint32_t id;
+            int32_t severity, line_number;
+            ok = get(f, id) && get(f, severity) && get(f, line_number) && get_string(f, s->file) &&
+                 get_string(f, s->format) && get_string(f, s->types) && id == sites.size() &&
+                 severity >= gdt::logger::DEBUG && severity <= gdt::logger::ERROR;
+            if (ok) {
+                s->site = {gdt::logger::severity(severity), s->file.c_str(), line_number,
+                           s->format.c_str(), s->types.c_str()};
+                sites.push_back(std::move(s));
+            }
+        } else if (kind == 'B') {
+            uint32_t id, n;
+            uint64_t time;
+            ok = get(f, id) && get(f, time) && get(f, n) && get_bytes(f, bytes, n) &&
+                 id < sites.size();
+            if (ok) {
+                const gdt::log_site& s = sites[id]->site;
+                line.clear();
+                gdt::logger::format_prefix(line, time, s.severity, s.file, s.line);
+                gdt::logger::format_args(line, s, bytes.data(), bytes.size());
+                line += '\n';
+                std::fwrite(line.data(), 1, line.size(), stdout);
+            }
+        }
+        if (!ok) {
+            std::fprintf(stderr, "%s is corrupt at byte %ld\n", argv[1], std::ftell(f));
+            return 1;
+        }
+    }
+    std::fclose(f);
+    return 0;
+}